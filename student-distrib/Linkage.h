@@ -4,35 +4,52 @@
 
 #ifndef MP3_LINKAGE_H
 #define MP3_LINKAGE_H
+
+// offsets in the hw_context, for the assembly.
+#define HW_EBX      0
+#define HW_ECX      4
+#define HW_EDX      8
+#define HW_EAX      24
+#define HW_CS       52
+#define HW_SIZE     68
+
+// vectors that enter through a stub: the exceptions, the 16 IRQs and the IPIs.
+#define NR_INTR_STUBS   0x31
+#define REMAP_IPI_VECTOR 0x30           // remap the user video page, see swap_pages.
+
 #ifndef ASM
 
-// Linkage function extern.
-void rtc_intr_linkage();
-void key_intr_linkage();
-void pit_intr_linkage();
-void SB16_intr_linkage();
-
-// Exception function extern.
-void idt_0();
-void idt_1();
-void idt_2();
-void idt_3();
-void idt_4();
-void idt_5();
-void idt_6();
-void idt_7();
-void idt_8();
-void idt_9();
-void idt_10();
-void idt_11();
-void idt_12();
-void idt_13();
-void idt_14();
-void idt_15();
-void idt_16();
-void idt_17();
-void idt_18();
-void idt_19();
+#include "types.h"
+
+// registers saved by every linkage. the last five are pushed by the CPU,
+// esp and ss only when coming from user level.
+typedef struct hw_context{
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+    uint32_t esi;
+    uint32_t edi;
+    uint32_t ebp;
+    uint32_t eax;
+    uint16_t ds;
+    uint16_t ds_pad;
+    uint16_t es;
+    uint16_t es_pad;
+    uint16_t fs;
+    uint16_t fs_pad;
+    uint32_t irq_exp_num;       // vector that got us here.
+    uint32_t err_code;          // pushed by the CPU for some exceptions, 0 otherwise.
+    uint32_t eip;
+    uint32_t cs;
+    uint32_t eflags;
+    uint32_t esp;
+    uint32_t ss;
+}hw_context_t;
+
+// address of the stub of each vector.
+extern uint32_t interrupt_stubs[NR_INTR_STUBS];
+
+void spurious_intr_linkage();
 
 #endif
 #endif //MP3_LINKAGE_H
@@ -6,11 +6,15 @@
 #include "lib.h"
 #include "i8259.h"
 #include "keyboard.h"
+#include "uaccess.h"
+#include "waitq.h"
+#include "irq.h"
 
 #define SUCCESS  0
 #define FAILURE -1
 
-volatile static uint32_t rtc_intr_flag;
+volatile static uint32_t rtc_intr_flag;     // interrupts since boot.
+static wait_queue_t rtc_wq;                 // readers waiting for the next interrupt.
 int rtc_freq_check(int freq);
 // RTC Writable Registers
 /*
@@ -53,6 +57,7 @@ int rtc_init(){
     outb((prev_A & 0xF0)|DEFAULT_RATE, RTC_DATA);
     test = 0;
     // enable irq 8 on PICs.
+    request_irq(RTC_IRQ, rtc_handler, "rtc");
     enable_irq(RTC_IRQ);
     rtc_intr_flag = 0;
     return 0;
@@ -73,6 +78,7 @@ void rtc_handler(){
         test_interrupts();
     }
     rtc_intr_flag += 1;
+    wake_up(&rtc_wq);
     // RESET RC and end interrupt.
     outb(RC, RTC_COMMAND);
     inb(RTC_DATA);
@@ -120,19 +126,43 @@ int rtc_close(int32_t fd){
 
 /*
  *  rtc_read
- *      DESCRIPTION: return success when interrupt happened.
- *      INPUT: None. (not used. )
+ *      DESCRIPTION: return success when interrupt happened. the process sleeps until
+ *                   the next interrupt. in non blocking mode it only checks if an
+ *                   interrupt came since the last read of this fd.
+ *      INPUT: fd: file descriptor, its file_pos keeps the last interrupt seen.
  *      OUTPUT: None.
- *      RETURN: always success.
+ *      RETURN: SUCCESS, FAILURE when no interrupt came in non blocking mode.
  *      SIDE EFFECT: none,
  */
 int rtc_read(int32_t fd, void* buf, int32_t nbytes){
+    file_des_t* cur_fd = &get_fd_array()[fd];
+    uint32_t start = rtc_intr_flag;
 
-    rtc_intr_flag = 0;                      // clear the RTC flag.
-    while(!rtc_intr_flag);                  // wait for interrupt to set the flag.
+    if (fd_nonblock(fd)){
+        if (cur_fd->file_pos == start){
+            return FAILURE;
+        }
+    } else{
+        wait_event(&rtc_wq, rtc_intr_flag != start);    // wait for interrupt to move the counter.
+    }
+    cur_fd->file_pos = rtc_intr_flag;
     return SUCCESS;
 }
 
+/*
+ *  rtc_poll
+ *      DESCRIPTION: report if an interrupt came since the last read of this fd.
+ *      INPUT: fd: file descriptor.
+ *             pt: poll table to wait on the interrupt.
+ *      OUTPUT: None.
+ *      RETURN: POLLIN when an interrupt came.
+ *      SIDE EFFECT: None.
+ */
+int rtc_poll(int32_t fd, poll_table_t* pt){
+    poll_wait(pt, &rtc_wq);
+    return (get_fd_array()[fd].file_pos != rtc_intr_flag) ? POLLIN : 0;
+}
+
 /*
  *  rtc_write
  *      DESCRIPTION: read frequency in HZ that written as uint32_t from the buffer. change the
@@ -152,7 +182,9 @@ int rtc_write(int32_t fd, const void* buf, int32_t nbytes){
         return FAILURE;
     }
 
-    freq = *(int*)buf;                  // copy the value in the buffer.
+    if (copy_from_user(&freq, buf, sizeof(freq))){  // copy the value in the buffer.
+        return FAILURE;
+    }
     if (freq > 1024){
         return FAILURE;
     }
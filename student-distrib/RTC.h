@@ -3,6 +3,7 @@
 //
 
 #include "types.h"
+#include "syscall.h"
 
 #ifndef MP3_RTC_H
 #define MP3_RTC_H
@@ -30,5 +31,6 @@ extern int rtc_open(const uint8_t* filename);
 extern int rtc_close(int32_t fd);
 extern int rtc_write(int32_t fd, const void* buf, int32_t nbytes);
 extern int rtc_read(int32_t fd, void* buf, int32_t nbytes);
+extern int rtc_poll(int32_t fd, poll_table_t* pt);
 
 #endif //MP3_RTC_H
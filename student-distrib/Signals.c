@@ -1,5 +1,262 @@
 //
 // Created by Jordan(qishenz2@illinois.edu) on 2022/4/16.
 //
+// Signals. A signal is a pending bit in the pcb. ret_from_intr calls
+// do_signal before going back to user level, which either takes the
+// default action or builds a frame on the user stack so the iret lands in
+// the handler. The handler returns into a trampoline that calls sigreturn.
+//
+// user stack when the handler starts:
+//  |return addr|signum|hw_context ......|trampoline|old esp
+//   esp
 
 #include "Signals.h"
+#include "syscall.h"
+#include "tasks.h"
+#include "lib.h"
+#include "x86_desc.h"
+#include "uaccess.h"
+#include "smp.h"
+
+#define SUCCESS 0
+#define FAILURE -1
+
+#define USER_EFLAGS     0x0DD5          // CF PF AF ZF SF DF OF, the user may change these.
+#define EFLAGS_IF       0x0200
+
+/*
+ *  signal_default_kill
+ *      DESCRIPTION: tell the default action of the signal.
+ *      INPUT:  signum: the signal.
+ *      OUTPUT: None.
+ *      RETURN: 1 when it kills the process, 0 when it is ignored.
+ *      SIDE EFFECT: None.
+ */
+static int32_t signal_default_kill(int32_t signum){
+    return (signum == DIV_ZERO || signum == SEGFAULT || signum == INTERRUPT);
+}
+
+/*
+ *  setup_frame
+ *      DESCRIPTION: push the trampoline, the saved registers, the signal number and the
+ *                   return address onto the user stack, and point the iret at the handler.
+ *      INPUT:  regs: the hw_context on the kernel stack.
+ *              signum: the signal.
+ *              handler: the user handler.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS, FAILURE when the user stack is bad.
+ *      SIDE EFFECT: regs->eip and regs->esp are changed.
+ */
+static int32_t setup_frame(hw_context_t* regs, int32_t signum, void* handler){
+    uint32_t tramp_size = sigreturn_tramp_end - sigreturn_tramp;
+    uint32_t tramp_addr;
+    uint32_t sp;
+
+    // trampoline first, word aligned.
+    sp = (regs->esp - tramp_size) & ~0x3;
+    tramp_addr = sp;
+    if (copy_to_user((void*)sp, sigreturn_tramp, tramp_size)){
+        return FAILURE;
+    }
+    sp -= sizeof(hw_context_t);
+    if (copy_to_user((void*)sp, regs, sizeof(hw_context_t))){
+        return FAILURE;
+    }
+    sp -= sizeof(int32_t);
+    if (copy_to_user((void*)sp, &signum, sizeof(int32_t))){
+        return FAILURE;
+    }
+    sp -= sizeof(uint32_t);
+    if (copy_to_user((void*)sp, &tramp_addr, sizeof(uint32_t))){
+        return FAILURE;
+    }
+
+    regs->esp = sp;
+    regs->eip = (uint32_t)handler;
+    return SUCCESS;
+}
+
+/*
+ *  do_signal
+ *      DESCRIPTION: handle the pending signals of the current process. the lowest
+ *                   number goes first. no signal is handled while a handler runs.
+ *      INPUT:  regs: the hw_context that will be restored to user level.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: may run the default action and halt the process, or set up a handler.
+ */
+void do_signal(hw_context_t* regs){
+    int32_t pid = get_current_pid();
+    int32_t signum;
+    uint32_t flags;
+    void* handler;
+    pcb_t* pcb;
+
+    if (pid < 0 || pid >= MAX_PROCESS){
+        return;
+    }
+    pcb = get_pcb(pid);
+
+    while (1){
+        cli_and_save(flags);
+        if (pcb->sig_masked || pcb->sig_pending == 0){
+            restore_flags(flags);
+            return;
+        }
+        for (signum = 0; !(pcb->sig_pending & (1 << signum)); signum++);
+        pcb->sig_pending &= ~(1 << signum);
+        handler = pcb->sig_handler[signum];
+        if (handler != NULL){
+            pcb->sig_masked = 1;
+        }
+        restore_flags(flags);
+
+        if (handler == NULL){
+            if (signal_default_kill(signum)){
+                halt_task(SIGNAL_KILL_STATUS);
+            }
+            continue;
+        }
+        if (setup_frame(regs, signum, handler) == FAILURE){
+            // no stack for the handler, nothing sensible left to do.
+            halt_task(SIGNAL_KILL_STATUS);
+        }
+        return;
+    }
+}
+
+/*
+ *  signal_send
+ *      DESCRIPTION: mark a signal pending for the process. it is handled the next time
+ *                   the process goes back to user level.
+ *      INPUT:  pid: the target process.
+ *              signum: the signal.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS, FAILURE for bad input.
+ *      SIDE EFFECT: None.
+ */
+int32_t signal_send(int32_t pid, int32_t signum){
+    uint32_t flags;
+    if (pid < 0 || pid >= MAX_PROCESS || signum < 0 || signum >= NUM_SIGNALS){
+        return FAILURE;
+    }
+    cli_and_save(flags);
+    get_pcb(pid)->sig_pending |= (1 << signum);
+    // a sleeping process wakes up to look at it.
+    wake_up_pid(pid);
+    restore_flags(flags);
+    return SUCCESS;
+}
+
+/*
+ *  signal_fault
+ *      DESCRIPTION: signal for an exception raised by the current process at user level,
+ *                   when the process has a handler for it. a fault inside a handler can
+ *                   not be handled again.
+ *      INPUT:  signum: DIV_ZERO or SEGFAULT.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS when the handler will run, FAILURE when the fault must kill.
+ *      SIDE EFFECT: None.
+ */
+int32_t signal_fault(int32_t signum){
+    int32_t pid = get_current_pid();
+    pcb_t* pcb;
+    if (pid < 0 || pid >= MAX_PROCESS){
+        return FAILURE;
+    }
+    pcb = get_pcb(pid);
+    if (pcb->sig_masked || pcb->sig_handler[signum] == NULL){
+        return FAILURE;
+    }
+    signal_send(pid, signum);
+    return SUCCESS;
+}
+
+/*
+ *  signal_fatal_pending
+ *      DESCRIPTION: check if a pending signal will kill the current process, so a
+ *                   blocking read can give up. signals with a handler wait for the read.
+ *      INPUT:  None.
+ *      OUTPUT: None.
+ *      RETURN: 1 for yes, 0 for no.
+ *      SIDE EFFECT: None.
+ */
+int32_t signal_fatal_pending(){
+    int32_t pid = get_current_pid();
+    int32_t signum;
+    pcb_t* pcb;
+
+    if (pid < 0 || pid >= MAX_PROCESS){
+        return 0;
+    }
+    pcb = get_pcb(pid);
+    for (signum = 0; signum < NUM_SIGNALS; signum++){
+        if ((pcb->sig_pending & (1 << signum)) && pcb->sig_handler[signum] == NULL &&
+            signal_default_kill(signum)){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ *  set_handler
+ *      DESCRIPTION: set the user handler of a signal.
+ *      INPUT:  signum: the signal.
+ *              handler_address: the handler, NULL for the default action.
+ *      OUTPUT: None.
+ *      RETURN: 0 for success, -1 for bad input.
+ *      SIDE EFFECT: None.
+ */
+int32_t set_handler(int32_t signum, void* handler_address){
+    int32_t pid = get_current_pid();
+    if (signum < 0 || signum >= NUM_SIGNALS || pid < 0 || pid >= MAX_PROCESS){
+        return FAILURE;
+    }
+    if (handler_address != NULL && !access_ok(handler_address, 1)){
+        return FAILURE;
+    }
+    get_pcb(pid)->sig_handler[signum] = handler_address;
+    return SUCCESS;
+}
+
+/*
+ *  sigreturn
+ *      DESCRIPTION: called by the trampoline. copy the registers saved by setup_frame
+ *                   back into the hw_context, so the iret goes where the signal came.
+ *      INPUT:  None.
+ *      OUTPUT: None.
+ *      RETURN: the saved eax, so the system call path keeps it.
+ *      SIDE EFFECT: signals are handled again.
+ */
+int32_t sigreturn(void){
+    // the system call came from user level, so its hw_context is at the top of the kernel stack.
+    hw_context_t* regs = (hw_context_t*)this_cpu()->tss->esp0 - 1;
+    hw_context_t saved;
+    int32_t pid = get_current_pid();
+    pcb_t* pcb;
+
+    if (pid < 0 || pid >= MAX_PROCESS){
+        return FAILURE;
+    }
+    pcb = get_pcb(pid);
+    if (!pcb->sig_masked){
+        return FAILURE;
+    }
+    // esp points at the signal number, the handler has taken the return address.
+    if (copy_from_user(&saved, (void*)(regs->esp + sizeof(int32_t)), sizeof(hw_context_t))){
+        halt_task(SIGNAL_KILL_STATUS);
+    }
+
+    // the user may change the general registers, not the privilege.
+    saved.ds = regs->ds;
+    saved.es = regs->es;
+    saved.fs = regs->fs;
+    saved.cs = regs->cs;
+    saved.ss = regs->ss;
+    saved.eflags = (regs->eflags & ~USER_EFLAGS) | (saved.eflags & USER_EFLAGS) | EFLAGS_IF;
+    *regs = saved;
+
+    pcb->sig_masked = 0;
+    return saved.eax;
+}
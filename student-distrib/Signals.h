@@ -5,6 +5,34 @@
 #ifndef MP3_SIGNALS_H
 #define MP3_SIGNALS_H
 
-//#define
+#include "types.h"
+#include "Linkage.h"
+
+// signal numbers, same as the user library.
+#define DIV_ZERO        0
+#define SEGFAULT        1
+#define INTERRUPT       2
+#define ALARM           3
+#define USER1           4
+#define NUM_SIGNALS     5
+
+#define SIGNAL_KILL_STATUS  256         // halt status of a process killed by a signal.
+#define ALARM_PERIOD        10          // seconds between two ALARM signals.
+
+/* deliver the pending signals when going back to user level. called by ret_from_intr. */
+void do_signal(hw_context_t* regs);
+
+/* mark a signal pending for the process. */
+int32_t signal_send(int32_t pid, int32_t signum);
+
+/* signal for an exception raised by the current process, if a handler takes it. */
+int32_t signal_fault(int32_t signum);
+
+/* check if the current process has a pending signal that will kill it. */
+int32_t signal_fatal_pending();
+
+/* the trampoline copied onto the user stack, in syscall_sup.S. */
+extern uint8_t sigreturn_tramp[];
+extern uint8_t sigreturn_tramp_end[];
 
 #endif //MP3_SIGNALS_H
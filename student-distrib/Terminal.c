@@ -3,15 +3,40 @@
 //
 
 #include "Terminal.h"
+#include "uaccess.h"
+#include "Signals.h"
+#include "vga.h"
+#include "apic.h"
+#include "irq.h"
 
 #define SUCCESS 0
 #define FAILURE -1
 
+#define WRITE_CHUNK 128         // user bytes pulled into the kernel at a time.
+
 void clear_buffer();
 void enable_cursor(uint8_t start, uint8_t end);
 void moving_cursor(int pos_x, int pos_y);
+static void set_display_start(terminal_t* term);
+static void remap_ipi_handler(hw_context_t* regs);
+
+// the text ring and the history of a terminal, taken from the pool when it starts.
+typedef struct terminal_buf{
+    uint16_t text[SCREEN_HEIGHT][SCREEN_WIDTH];
+    scrollback_t history;
+}terminal_buf_t;
+#define TERMINAL_BUF_PAGES  ((sizeof(terminal_buf_t) + SIZE_4KB - 1)/SIZE_4KB)
+
+terminal_t terminal_list[MAX_TERMINALS];
+
+// buffers of terminal 0, the boot messages are written to it before the pool is there.
+static terminal_buf_t boot_buf;
 
-terminal_t terminal_list[3];
+// number of terminals, set at boot.
+int terminal_count = 1;
+
+// VGA color of each ANSI color number. the red and blue bits are swapped.
+static const uint8_t ansi_colors[8] = {0, 4, 2, 6, 1, 5, 3, 7};
 
 // current displaying terminal pointer.
 volatile terminal_t* term_ptr = NULL;
@@ -20,88 +45,246 @@ volatile terminal_t* term_ptr = NULL;
 volatile int cur_terminal_id;
 
 // current handle terminal pointer.
-volatile terminal_t* handle_term = NULL;
 
+// cell offset of the displayed page in the text memory, the cursor counts from 0xB8000.
+static uint16_t display_base = 0;
+
+// position last written to the cursor registers, none at boot.
+static uint16_t cursor_pos = 0xFFFF;
+
+
+/*
+ *  terminal_console
+ *      DESCRIPTION: get terminal 0 for the kernel messages. the first call gives it the
+ *                   boot buffers, a color and a scroll region, so printf works before
+ *                   terminal_init.
+ *      INPUT/OUTPUT: None.
+ *      RETURN: terminal 0.
+ *      SIDE EFFECT: None.
+ */
+terminal_t* terminal_console(){
+    terminal_t* term = terminal_list;
+
+    if (term->text == NULL){
+        term->text = boot_buf.text;
+        term->history = &boot_buf.history;
+        scrollback_init(term->history);
+        terminal_reset(term);
+    }
+    return term;
+}
+
+/*
+ *  terminal_start
+ *      DESCRIPTION: give a terminal its text ring and history from the pool, then
+ *                   blank it. terminal 0 keeps the boot buffers.
+ *      INPUT: term: the terminal, not started yet.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS, FAILURE when the pool is empty.
+ *      SIDE EFFECT: the page of the terminal is cleared.
+ */
+static int terminal_start(terminal_t* term){
+    terminal_buf_t* buf;
+
+    if (term->text == NULL){
+        if ((buf = pages_alloc(TERMINAL_BUF_PAGES)) == NULL){
+            return FAILURE;
+        }
+        term->text = buf->text;
+        term->history = &buf->history;
+    }
+    scrollback_init(term->history);                                 // no history yet.
+    terminal_reset(term);                                           // default colors.
+    terminal_clear(term);
+    terminal_flush(term);
+    return SUCCESS;
+}
 
 /*
  *  terminal_init
- *      DESCRIPTION: initialize a terminal and show it on screen after test.
- *      INPUT:       None.
+ *      DESCRIPTION: initialize the terminals and show the first one. the first seven
+ *                   live in the text memory, so showing them only moves the CRTC start.
+ *                   the others get a page from the pool and are swapped into the text
+ *                   memory when shown. only the first terminal runs, the others get
+ *                   their buffers and start their shell when they are shown for the
+ *                   first time.
+ *      INPUT:       count: number of terminals, 1 to MAX_TERMINALS.
  *      OUTPUT:      None.
  *      RETURN:      None.
  *      SIDE EFFECT: Modify the video memory.
  */
-void terminal_init(){
+void terminal_init(int count){
     int i;
+
+    if (count < 1){
+        count = 1;
+    } else if (count > MAX_TERMINALS){
+        count = MAX_TERMINALS;
+    }
     // terminal init:
-    for (i = 0;i<3;i++){
-        terminal_list[i].isem = 0;
+    for (i = 0;i<count;i++){
         terminal_list[i].status = 0;
+        terminal_list[i].read_wq.pids = 0;
         terminal_list[i].terminalID = i;
-        memset(terminal_list[i].input_buffer,0,BUFFER_SIZE);    // clean the input buffer,
-        terminal_list[i].cursor_x = 0;                             // init the cursor location.
-        terminal_list[i].cursor_y = 0;
-        terminal_list[i].video_ptr = (uint8_t*)(VIDEO_ADDR+(i+1)*SIZE_4KB);
+        ldisc_init(&terminal_list[i].ldisc);                        // empty input, cooked mode.
+        if (i+1 < VGA_TEXT_PAGES){
+            terminal_list[i].video_ptr = (uint8_t*)(VIDEO_ADDR+(i+1)*SIZE_4KB);
+        } else if ((terminal_list[i].video_ptr = page_alloc()) == NULL){
+            break;                                                  // the pool is empty, fewer terminals.
+        }
         terminal_list[i].cur_pid = -1;                              // the pid that currently running in the terminal.
-        terminal_list[i].next_tid = (i+1)%3;                        // the next terminal id in the rr loop.
+        terminal_list[i].next_tid = i;                              // not in the rr loop yet.
+        terminal_list[i].active = 0;
+        terminal_list[i].cpu = 0;                                   // the boot CPU starts its shell.
         set_terminal_pages(i,1);                              // init the paging for the terminals.
     }
-    clear();
+    terminal_count = i;
+    set_intr_handler(REMAP_IPI_VECTOR, remap_ipi_handler, "remap ipi");
+    terminal_start(terminal_console());                             // the boot buffers, no pool page.
+    terminal_list[0].active = 1;
     term_ptr = terminal_list;                                       // open the first terminal.
     handle_term = terminal_list;                                    // only one terminal in the RR loop.
     cur_terminal_id = 0;                                            // set the current terminal id to 0;
-    set_terminal_pages(i,1);                                  // set the first terminal page as global.
+    set_display_start(terminal_list);                               // show the page of the first terminal.
     enable_cursor(0,SCREEN_HEIGHT);                            // set the cursor location.
-    term_ptr->cursor_x = screen_x;
-    term_ptr->cursor_y = screen_y;
-    moving_cursor(screen_x,screen_y);
 }
 
-//used when alt F1/2/3 is pressed. About the terminal showing switching, not the execute purpose.
+/*
+ *  in_text_memory
+ *      DESCRIPTION: tell whether the page of the terminal is in the text memory.
+ */
+static int in_text_memory(terminal_t* term){
+    return (uint32_t)term->video_ptr - VIDEO_ADDR < VGA_TEXT_PAGES*SIZE_4KB;
+}
+
+/*
+ *  remap_ipi_handler
+ *      DESCRIPTION: another CPU moved the page of the terminal this CPU runs. the
+ *                   handler gets the kernel lock after the move is done, so the
+ *                   process is back at user level only with the new page mapped.
+ *      INPUT:  regs: unused.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: the user video page of this CPU is remapped.
+ */
+static void remap_ipi_handler(hw_context_t* regs){
+    apic_eoi();
+    if (handle_term != NULL && handle_term->cur_pid != -1){
+        vid_remap((uint8_t*)handle_term->video_ptr);
+    }
+}
+
+/*
+ *  stop_remote_users
+ *      DESCRIPTION: get the other CPUs that run one of the two terminals off user
+ *                   level before their page moves. each gets the remap IPI, and is
+ *                   waited for until it spins for the kernel lock this CPU holds.
+ *                   it remaps in remap_ipi_handler once the lock is free.
+ *      INPUT:  a, b: the terminals whose pages move.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+static void stop_remote_users(terminal_t* a, terminal_t* b){
+    int i;
+    cpu_t* cpu;
+
+    for (i = 0; i < cpu_count; i++){
+        cpu = &cpu_list[i];
+        if (i == smp_processor_id() || !cpu->online || (cpu->term != a && cpu->term != b) ||
+            ((terminal_t*)cpu->term)->cur_pid == -1){
+            continue;
+        }
+        apic_send_ipi(cpu->apic_id, LAPIC_ICR_FIXED | REMAP_IPI_VECTOR);
+        while (!cpu->kernel_waiting){
+            asm volatile("pause");
+        }
+    }
+}
+
+/*
+ *  swap_pages
+ *      DESCRIPTION: give the text memory page of the displayed terminal to a terminal
+ *                   whose page is in the pool, and the other way round. the content
+ *                   moves with the page, it may have been written through vidmap.
+ *      INPUT:  shown: the displayed terminal, in the text memory.
+ *              next: the terminal about to be shown.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: the user video page of the running process is remapped, on
+ *                   every CPU that runs one of the two terminals.
+ */
+static void swap_pages(terminal_t* shown, terminal_t* next){
+    uint32_t* a = (uint32_t*)shown->video_ptr;
+    uint32_t* b = (uint32_t*)next->video_ptr;
+    uint32_t tmp;
+    uint8_t* page;
+    int i;
+
+    stop_remote_users(shown, next);
+
+    for (i = 0; i < SIZE_4KB/sizeof(uint32_t); i++){
+        tmp = a[i];
+        a[i] = b[i];
+        b[i] = tmp;
+    }
+    page = shown->video_ptr;
+    shown->video_ptr = next->video_ptr;
+    next->video_ptr = page;
+    if (handle_term->cur_pid != -1 && (handle_term == shown || handle_term == next)){
+        vid_remap((uint8_t*)handle_term->video_ptr);
+    }
+}
+
+//used when alt F1-F12 is pressed. About the terminal showing switching, not the execute purpose.
 /*
  *  terminal_switch
  *      DESCRIPTION: switch terminal to the desire one. Enable terminals when it is not activated.
  *      INPUT:  int term_id: the given terminal id.
  *      OUTPUT: None.
  *      RETURN: None.
- *      SIDE EFFECT: The vid map of the terminal is changed.
+ *      SIDE EFFECT: The screen shows the page of the new terminal.
  */
 void terminal_switch(int term_id){
-    if (term_id == cur_terminal_id){
+    terminal_t* next_terminal;
+
+    if (term_id == cur_terminal_id || term_id < 0 || term_id >= terminal_count){
         return;
     }
 
     cli();
-    terminal_t* next_terminal = get_terminal(term_id);
-
-
-    // 1. save current status into cur terminal.
-    term_ptr->cursor_x = screen_x;
-    term_ptr->cursor_y = screen_y;
+    next_terminal = get_terminal(term_id);
 
-    // 2. load status from the new terminal.
-    screen_x = next_terminal->cursor_x;
-    screen_y = next_terminal->cursor_y;
-
-    // 3. Save old video memory && load new memory.
-    memcpy((void*)term_ptr->video_ptr,(void*)VIDEO_ADDR, SIZE_4KB);//save ole one
-    memcpy((void*)VIDEO_ADDR, (void*)next_terminal->video_ptr,SIZE_4KB);//load new one
-    // 4. update local variables && cursor.
+    // 0. a terminal shown for the first time gets its buffers and joins the RR loop, the
+    //    scheduler starts its shell. it is not shown when the pool is empty.
+    if (!next_terminal->active){
+        if (terminal_start(next_terminal) == FAILURE){
+            sti();
+            return;
+        }
+        next_terminal->active = 1;
+        next_terminal->next_tid = terminal_list[0].next_tid;
+        terminal_list[0].next_tid = term_id;
+    }
+    // 1. the cursor is kept in each terminal. go back to the live screen of the old one.
+    terminal_view_scroll((terminal_t*)term_ptr, -(int)term_ptr->history->view);
+    // 2. the terminals in the text memory are shown by moving the CRTC start. the others
+    //    take the page of the old one, the text memory must be in text mode for the copy.
+    if (!in_text_memory(next_terminal)){
+        if (gfx_active()){
+            gfx_switch(term_id);
+        }
+        swap_pages((terminal_t*)term_ptr, next_terminal);
+    }
+    set_display_start(next_terminal);
+    // 3. update local variables && cursor.
     term_ptr = next_terminal;//term_ptr always point to the terminal showing
     cur_terminal_id = term_ptr->terminalID;
 
-    moving_cursor(screen_x,screen_y);
-    // 5. remap the video memory.
-    // the terminal has running programs on it. check whether it is being handled.
-
-    // if the terminal is currently being handled:
-    if (cur_terminal_id == handle_term->terminalID) {
-        // 1. remap it to the video map.
-        vid_remap((uint8_t*)VIDEO_ADDR);
-    } else {
-        // map the handled terminal to the buffer.
-        vid_remap((uint8_t*)term_ptr->video_ptr);
-    }
+    term_ptr->cursor_dirty = 1;
+    // 4. the terminal of the graphics owner is shown in mode 13h.
+    gfx_switch(cur_terminal_id);
+    // 5. the user video memory of each process is its own page, nothing to remap.
     sti();
     return;
 }
@@ -133,51 +316,109 @@ int terminal_close(int32_t fd){
 //use from syscall.c sys_read, every time read input characters to the terminal call terminal_read
 /*
  *  terminal_read
- *      DESCRIPTION: Copy the content in the input buffer to the target buffer.
+ *      DESCRIPTION: Copy the input from the line discipline to the target buffer. a line
+ *                   at most in cooked mode, the keys typed so far in raw mode.
  *      INPUT: buffer: pointer to the target buffer.
  *      OUTPUT: number of the
  *      RETURN: Numbers of chars that being copied.
- *      SIDE EFFECT: clear the key board buffer.
+ *      SIDE EFFECT: the rest of the buffer is filled with NULL.
  */
 int terminal_read(int32_t fd, void* buf, int32_t nbytes){
     //printf("enter terminal read");
     // Check if the input is valid.
-    int i;
-    int num_read = 0;
-    char* buffer = (char*)buf;
+    uint8_t line[LDISC_LINE_MAX];
+    int num_read;
+    terminal_t* terminal = (terminal_t*)handle_term;
 
-    if (buf == NULL || nbytes == 0){
+    if (buf == NULL || nbytes <= 0){
         return FAILURE;
     }
-    term_ptr->status = 0;
-    // wait until the terminal is free.
-    while(!handle_term->status){}
-    handle_term->status = 0;
-    for (i = 0; (i < nbytes)&&(i<BUFFER_SIZE);i++) {
-        if (buffer[i] != '\n') {
-            if (i < handle_term->isem) {
-                num_read++;
-                buffer[i] = handle_term->input_buffer[i];
-            }
-        }else {
-                // read until the \n and then break the loop.
-                buffer[i] = handle_term->input_buffer[i];
-                num_read++;
-                break;
+    // sleep until there is input. a signal that kills the reader ends the wait.
+    if (!ldisc_ready(&terminal->ldisc)){
+        if (fd_nonblock(fd)){
+            return FAILURE;
+        }
+        wait_event(&terminal->read_wq, ldisc_ready(&terminal->ldisc) || signal_fatal_pending());
+        if (!ldisc_ready(&terminal->ldisc)){
+            return FAILURE;
         }
     }
 
-    // fill the buffer fully with NULL.
-    if (nbytes > handle_term->isem){
-        for (;i<nbytes;i++){
-            buffer[i] = 0;
-        }
+    num_read = ldisc_read(&terminal->ldisc, line, (nbytes < LDISC_LINE_MAX) ? nbytes : LDISC_LINE_MAX);
+
+    // copy the input, then fill the buffer fully with NULL.
+    if (copy_to_user(buf, line, num_read) ||
+        clear_user((char*)buf + num_read, nbytes - num_read)){
+        return FAILURE;
     }
-    // clean key board buffer.
-    clear_buffer();
     return num_read;
 }
 
+/*
+ *  terminal_ioctl
+ *      DESCRIPTION: get or set the mode of the line discipline.
+ *      INPUT: fd: the file descriptor.
+ *             cmd: TCGETMODE or TCSETMODE.
+ *             arg: TTY_COOKED or TTY_RAW for TCSETMODE.
+ *      OUTPUT: None.
+ *      RETURN: the mode for TCGETMODE, 0 for TCSETMODE, FAILURE for bad command.
+ *      SIDE EFFECT: the line being edited is dropped on a mode change.
+ */
+int terminal_ioctl(int32_t fd, int32_t cmd, int32_t arg){
+    terminal_t* terminal = (terminal_t*)handle_term;
+    switch (cmd){
+        case TCGETMODE:
+            return terminal->ldisc.mode;
+        case TCSETMODE:
+            return ldisc_set_mode(&terminal->ldisc, arg);
+        default:
+            return FAILURE;
+    }
+}
+
+/*
+ *  terminal_poll
+ *      DESCRIPTION: report if input is ready. stdout never blocks.
+ *      INPUT: fd: the file descriptor.
+ *             pt: poll table to wait on the input.
+ *      OUTPUT: None.
+ *      RETURN: POLLIN when read would not wait, POLLOUT always.
+ *      SIDE EFFECT: None.
+ */
+int terminal_poll(int32_t fd, poll_table_t* pt){
+    terminal_t* terminal = (terminal_t*)handle_term;
+    poll_wait(pt, &terminal->read_wq);
+    return (ldisc_ready(&terminal->ldisc) ? POLLIN : 0) | POLLOUT;
+}
+
+/*
+ *  terminal_put_user
+ *      DESCRIPTION: pull a user buffer into the kernel piece by piece and put the chars.
+ *                   each piece is rendered in one batch, the caller flushes the screen.
+ *      INPUT:       buffer: the user buffer.
+ *                   nbytes: the number of chars.
+ *      OUTPUT: the content in the buffer.
+ *      RETURN: SUCCESS, or FAILURE when the buffer is bad.
+ *      SIDE EFFECT: the video memory was modified.
+ */
+static int terminal_put_user(const uint8_t* buffer, int nbytes){
+    uint8_t chunk[WRITE_CHUNK];
+    int n, done;
+
+    for (done = 0; done < nbytes; done += n) {
+        n = nbytes - done;
+        if (n > WRITE_CHUNK) {
+            n = WRITE_CHUNK;
+        }
+        if (copy_from_user(chunk, buffer + done, n)) {
+            return FAILURE;
+        }
+        // the whole chunk goes to the screen in one batch, null chars are skipped.
+        terminal_putn(chunk, n);
+    }
+    return SUCCESS;
+}
+
 
 
 //use from syscall.c sys_write, every time write to the terminal call terminal_write
@@ -187,46 +428,477 @@ int terminal_read(int32_t fd, void* buf, int32_t nbytes){
  *      INPUT:       buffer: the pointer to the given buffer.
  *                   count:  the number of chars that should be put.
  *      OUTPUT: the contend in the buffer.
- *      RETURN: number of char written.
+ *      RETURN: number of char written, FAILURE for a bad buffer.
  *      SIDE EFFECT: the video memory was modified.
  */
 int terminal_write(int32_t fd, const void* buffer, int nbytes){
     //printf("enter terminal Write");
-    int i;
-    // help change the pointer type.
-    cli();
-    uint8_t* buffpointer;
-    int num_print = 0;
+    int ret;
+    uint32_t flags;
+    terminal_t* term = (terminal_t*)handle_term;
 
     // check if the input is valid.
     if (buffer == NULL || nbytes == 0){
         return FAILURE;
     }
-    buffpointer = (uint8_t* )buffer;
+    spin_lock_irqsave(&term->lock, flags);
+    ret = terminal_put_user((const uint8_t*)buffer, nbytes);
+    // the video memory and the cursor are updated once for the whole write.
+    terminal_flush(term);
+    spin_unlock_irqrestore(&term->lock, flags);
+    return (ret == FAILURE) ? FAILURE : nbytes;
+}
 
-    for (i = 0; i<nbytes;i++) {
-        if (buffpointer[i] != '\0') {            // Skip null
-            terminal_putc(buffpointer[i]);      //new version of puts!(change VM when handle_term==showing term| change term_buffer when handle_term!=showing_term)
-            num_print++;
+/*
+ *  terminal_writev
+ *      DESCRIPTION: write several buffers to the terminal with the terminal locked only once,
+ *                   so a line built from pieces comes out in one batch.
+ *      INPUT:       iov: the segment array, checked by the syscall.
+ *                   iovcnt: number of segments.
+ *      OUTPUT: the content in the buffers.
+ *      RETURN: number of bytes in all segments.
+ *      SIDE EFFECT: the video memory was modified.
+ */
+int terminal_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt){
+    int i;
+    int total = 0;
+    uint32_t flags;
+    terminal_t* term = (terminal_t*)handle_term;
+
+    spin_lock_irqsave(&term->lock, flags);
+    for (i = 0; i < iovcnt; i++) {
+        if (terminal_put_user((const uint8_t*)iov[i].iov_base, iov[i].iov_len) == FAILURE) {
+            terminal_flush(term);
+            spin_unlock_irqrestore(&term->lock, flags);
+            return (total == 0) ? FAILURE : total;
         }
+        total += iov[i].iov_len;
     }
-    sti();
-    return 0;
+    terminal_flush(term);
+    spin_unlock_irqrestore(&term->lock, flags);
+    return total;
+}
+
+/*
+ *  region_mask
+ *      DESCRIPTION: dirty bits of the lines in the scroll region.
+ */
+static uint32_t region_mask(terminal_t* term){
+    return ((1 << (term->scroll_bottom + 1)) - 1) & ~((1 << term->scroll_top) - 1);
+}
+
+/*
+ *  terminal_scroll
+ *      DESCRIPTION: move the text one line up. the top line goes to the history, only
+ *                   the ring start moves and the line that comes in at the bottom is blanked.
+ *                   with a smaller scroll region only its lines are moved, without history.
+ *      INPUT: term: the terminal.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: every line of the region is dirty. a scrolled back view stays on its lines.
+ */
+void terminal_scroll(terminal_t* term){
+    int y;
+
+    if (term->scroll_top != 0 || term->scroll_bottom != SCREEN_HEIGHT-1){
+        for (y = term->scroll_top; y < term->scroll_bottom; y++){
+            memcpy(TERM_ROW(term, y), TERM_ROW(term, y+1), SCREEN_WIDTH*sizeof(uint16_t));
+        }
+        memset_word(TERM_ROW(term, term->scroll_bottom), ERASE_CELL(term), SCREEN_WIDTH);
+        term->dirty_rows |= region_mask(term);
+        return;
+    }
+    scrollback_push(term->history, TERM_ROW(term, 0));
+    if (term->history->view != 0 && term->history->view < term->history->count){
+        term->history->view++;
+    }
+    term->top_row = (term->top_row + 1) % SCREEN_HEIGHT;
+    memset_word(TERM_ROW(term, SCREEN_HEIGHT-1), ERASE_CELL(term), SCREEN_WIDTH);
+    term->dirty_rows = ALL_ROWS_DIRTY;
+}
+
+/*
+ *  scroll_down
+ *      DESCRIPTION: move the lines of the scroll region one line down and blank its top.
+ *      INPUT: term: the terminal.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: every line of the region is dirty.
+ */
+static void scroll_down(terminal_t* term){
+    int y;
+    for (y = term->scroll_bottom; y > term->scroll_top; y--){
+        memcpy(TERM_ROW(term, y), TERM_ROW(term, y-1), SCREEN_WIDTH*sizeof(uint16_t));
+    }
+    memset_word(TERM_ROW(term, term->scroll_top), ERASE_CELL(term), SCREEN_WIDTH);
+    term->dirty_rows |= region_mask(term);
+}
+
+/*
+ *  terminal_line_feed
+ *      DESCRIPTION: move the cursor down a line. at the bottom of the scroll region the
+ *                   region scrolls instead, below it the cursor stops at the last line.
+ *      INPUT: term: the terminal.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: may scroll the text.
+ */
+void terminal_line_feed(terminal_t* term){
+    if (term->cursor_y == term->scroll_bottom){
+        terminal_scroll(term);
+    } else if (term->cursor_y < SCREEN_HEIGHT-1){
+        term->cursor_y++;
+    }
+}
+
+/*
+ *  erase
+ *      DESCRIPTION: blank the cells [from, to) of the screen, counted row by row.
+ *      INPUT: term: the terminal.
+ *             from, to: cell numbers, y * SCREEN_WIDTH + x.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: the lines touched are dirty.
+ */
+static void erase(terminal_t* term, int from, int to){
+    int y, x0, x1;
+    for (y = from / SCREEN_WIDTH; y < SCREEN_HEIGHT && y * SCREEN_WIDTH < to; y++){
+        x0 = (y == from / SCREEN_WIDTH) ? from % SCREEN_WIDTH : 0;
+        x1 = (to - y * SCREEN_WIDTH < SCREEN_WIDTH) ? to - y * SCREEN_WIDTH : SCREEN_WIDTH;
+        memset_word(TERM_ROW(term, y) + x0, ERASE_CELL(term), x1 - x0);
+        term->dirty_rows |= 1 << y;
+    }
+}
+
+/*
+ *  set_colors
+ *      DESCRIPTION: carry out ESC [ ... m, the color and intensity numbers.
+ *                   30-37 and 90-97 set the text color, 40-47 and 100-107 the background.
+ *      INPUT: term: the terminal.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: the chars written after have the new colors.
+ */
+static void set_colors(terminal_t* term){
+    int i, p;
+    int n = (term->esc.nparams == 0) ? 1 : term->esc.nparams;
+
+    for (i = 0; i < n; i++){
+        p = ansi_param(&term->esc, i, 0);
+        if (p == 0){
+            term->attrib = TEXT_ATTRIB;
+            term->reverse = 0;
+        } else if (p == 1){
+            term->attrib |= 0x08;
+        } else if (p == 22){
+            term->attrib &= ~0x08;
+        } else if ((p == 7 && !term->reverse) || (p == 27 && term->reverse)){
+            term->attrib = (term->attrib << 4) | (term->attrib >> 4);
+            term->reverse = !term->reverse;
+        } else if (p >= 30 && p <= 37){
+            term->attrib = (term->attrib & ~0x07) | ansi_colors[p-30];
+        } else if (p == 39){
+            term->attrib = (term->attrib & ~0x07) | (TEXT_ATTRIB & 0x07);
+        } else if (p >= 40 && p <= 47){
+            term->attrib = (term->attrib & ~0x70) | (ansi_colors[p-40] << 4);
+        } else if (p == 49){
+            term->attrib &= ~0xF0;
+        } else if (p >= 90 && p <= 97){
+            term->attrib = (term->attrib & ~0x07) | ansi_colors[p-90] | 0x08;
+        } else if (p >= 100 && p <= 107){
+            // the bright bit of the background blinks in the default text mode.
+            term->attrib = (term->attrib & ~0x70) | (ansi_colors[p-100] << 4) | 0x80;
+        }
+    }
+}
+
+/*
+ *  clamp
+ *      DESCRIPTION: keep v in [lo, hi].
+ */
+static int clamp(int v, int lo, int hi){
+    return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+/*
+ *  terminal_escape
+ *      DESCRIPTION: carry out the escape sequence just read into term->esc.
+ *                   supported: cursor moves (A B C D E F G d H f), erase in display
+ *                   and line (J K X), colors (m), scroll region (r), scroll (S T),
+ *                   save and restore of the cursor (s u, ESC 7 ESC 8), ESC D, E, M and c.
+ *                   the others are dropped.
+ *      INPUT: term: the terminal.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: may move the cursor and change the text.
+ */
+void terminal_escape(terminal_t* term){
+    ansi_t* esc = &term->esc;
+    int pos = term->cursor_y * SCREEN_WIDTH + term->cursor_x;
+    int n = ansi_param(esc, 0, 1);
+    int top, bottom;
+
+    if (!esc->csi){
+        switch (esc->final){
+            case '7':
+                term->saved_x = term->cursor_x;
+                term->saved_y = term->cursor_y;
+                break;
+            case '8':
+                term->cursor_x = term->saved_x;
+                term->cursor_y = term->saved_y;
+                break;
+            case 'E':
+                term->cursor_x = 0;
+                terminal_line_feed(term);
+                break;
+            case 'D':
+                terminal_line_feed(term);
+                break;
+            case 'M':
+                if (term->cursor_y == term->scroll_top){
+                    scroll_down(term);
+                } else if (term->cursor_y > 0){
+                    term->cursor_y--;
+                }
+                break;
+            case 'c':
+                terminal_reset(term);
+                terminal_clear(term);
+                break;
+        }
+        return;
+    }
+    // the DEC private modes, like hiding the cursor, are not supported.
+    if (esc->private){
+        return;
+    }
+    switch (esc->final){
+        case 'A':
+            term->cursor_y = clamp(term->cursor_y - n, 0, SCREEN_HEIGHT-1);
+            break;
+        case 'B':
+            term->cursor_y = clamp(term->cursor_y + n, 0, SCREEN_HEIGHT-1);
+            break;
+        case 'C':
+            term->cursor_x = clamp(term->cursor_x + n, 0, SCREEN_WIDTH-1);
+            break;
+        case 'D':
+            term->cursor_x = clamp(term->cursor_x - n, 0, SCREEN_WIDTH-1);
+            break;
+        case 'E':
+            term->cursor_x = 0;
+            term->cursor_y = clamp(term->cursor_y + n, 0, SCREEN_HEIGHT-1);
+            break;
+        case 'F':
+            term->cursor_x = 0;
+            term->cursor_y = clamp(term->cursor_y - n, 0, SCREEN_HEIGHT-1);
+            break;
+        case 'G':
+            term->cursor_x = clamp(n - 1, 0, SCREEN_WIDTH-1);
+            break;
+        case 'd':
+            term->cursor_y = clamp(n - 1, 0, SCREEN_HEIGHT-1);
+            break;
+        case 'H':
+        case 'f':
+            term->cursor_y = clamp(n - 1, 0, SCREEN_HEIGHT-1);
+            term->cursor_x = clamp(ansi_param(esc, 1, 1) - 1, 0, SCREEN_WIDTH-1);
+            break;
+        case 'J':
+            switch (ansi_param(esc, 0, 0)){
+                case 0: erase(term, pos, SCREEN_HEIGHT*SCREEN_WIDTH); break;
+                case 1: erase(term, 0, pos + 1); break;
+                case 2: erase(term, 0, SCREEN_HEIGHT*SCREEN_WIDTH); break;
+            }
+            break;
+        case 'K':
+            switch (ansi_param(esc, 0, 0)){
+                case 0: erase(term, pos, (term->cursor_y + 1) * SCREEN_WIDTH); break;
+                case 1: erase(term, term->cursor_y * SCREEN_WIDTH, pos + 1); break;
+                case 2: erase(term, term->cursor_y * SCREEN_WIDTH, (term->cursor_y + 1) * SCREEN_WIDTH); break;
+            }
+            break;
+        case 'X':
+            erase(term, pos, term->cursor_y * SCREEN_WIDTH + clamp(term->cursor_x + n, 0, SCREEN_WIDTH));
+            break;
+        case 'm':
+            set_colors(term);
+            break;
+        case 'r':
+            top = ansi_param(esc, 0, 1) - 1;
+            bottom = ansi_param(esc, 1, SCREEN_HEIGHT) - 1;
+            if (top < bottom && bottom < SCREEN_HEIGHT){
+                term->scroll_top = top;
+                term->scroll_bottom = bottom;
+                term->cursor_x = 0;
+                term->cursor_y = 0;
+            }
+            break;
+        case 'S':
+            for (n = clamp(n, 0, SCREEN_HEIGHT); n > 0; n--){
+                terminal_scroll(term);
+            }
+            break;
+        case 'T':
+            for (n = clamp(n, 0, SCREEN_HEIGHT); n > 0; n--){
+                scroll_down(term);
+            }
+            break;
+        case 's':
+            term->saved_x = term->cursor_x;
+            term->saved_y = term->cursor_y;
+            break;
+        case 'u':
+            term->cursor_x = term->saved_x;
+            term->cursor_y = term->saved_y;
+            break;
+    }
+}
+
+/*
+ *  terminal_reset
+ *      DESCRIPTION: forget what a program set with escape sequences: default colors,
+ *                   the whole screen as scroll region, no sequence half written.
+ *      INPUT: term: the terminal.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: the text already written keeps its colors.
+ */
+void terminal_reset(terminal_t* term){
+    ansi_init(&term->esc);
+    term->attrib = TEXT_ATTRIB;
+    term->reverse = 0;
+    term->scroll_top = 0;
+    term->scroll_bottom = SCREEN_HEIGHT-1;
+    term->saved_x = 0;
+    term->saved_y = 0;
+}
+
+/*
+ *  terminal_clear
+ *      DESCRIPTION: blank the text of the terminal and move the cursor home.
+ *      INPUT: term: the terminal.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: every screen line is dirty.
+ */
+void terminal_clear(terminal_t* term){
+    memset_word(term->text, BLANK_CELL, SCREEN_HEIGHT*SCREEN_WIDTH);
+    term->top_row = 0;
+    term->cursor_x = 0;
+    term->cursor_y = 0;
+    term->dirty_rows = ALL_ROWS_DIRTY;
+    term->history->view = 0;
+}
+
+/*
+ *  terminal_flush
+ *      DESCRIPTION: copy the dirty lines to the page of the terminal in the text memory.
+ *                   the cursor is only marked, terminal_cursor_sync moves it. nothing is
+ *                   copied while the history is shown.
+ *      INPUT: term: the terminal.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: the video memory was modified.
+ */
+void terminal_flush(terminal_t* term){
+    uint16_t* video;
+    uint32_t dirty = term->dirty_rows;
+    int y;
+
+    if (term->history->view != 0){
+        return;
+    }
+    // before terminal_init the boot messages go to the first page.
+    video = (term->video_ptr != NULL) ? (uint16_t*)term->video_ptr : (uint16_t*)VIDEO_ADDR;
+    for (y = 0; dirty != 0; y++, dirty >>= 1){
+        if (dirty & 1){
+            memcpy(video + y*SCREEN_WIDTH, TERM_ROW(term, y), SCREEN_WIDTH*sizeof(uint16_t));
+        }
+    }
+    term->dirty_rows = 0;
+    // the cursor follows at the next tick.
+    term->cursor_dirty = 1;
+}
+
+/*
+ *  terminal_redraw
+ *      DESCRIPTION: rebuild the text screen after it was used by the graphics mode.
+ *                   the registers were reloaded and the text memory overwritten, so
+ *                   every terminal is copied again from its text model.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: the video memory and the CRTC registers are modified.
+ */
+void terminal_redraw(){
+    int i;
+
+    terminal_view_scroll((terminal_t*)term_ptr, -(int)term_ptr->history->view);
+    set_display_start((terminal_t*)term_ptr);
+    enable_cursor(0,SCREEN_HEIGHT);
+    cursor_pos = 0xFFFF;
+    for (i = 0;i<terminal_count;i++){
+        if (!terminal_list[i].active){
+            continue;                                               // no text yet.
+        }
+        terminal_list[i].dirty_rows = ALL_ROWS_DIRTY;
+        terminal_flush(terminal_list+i);
+    }
+}
+
+/*
+ *  terminal_view_scroll
+ *      DESCRIPTION: move the window of the displayed terminal through the history.
+ *                   only the 25 visible lines are decoded to the screen. at 0 the live
+ *                   text comes back.
+ *      INPUT: term: the displayed terminal.
+ *             lines: lines to go back, negative to go forward.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: the screen is redrawn, the cursor is hidden while in the history.
+ */
+void terminal_view_scroll(terminal_t* term, int lines){
+    uint16_t* video = (uint16_t*)term->video_ptr;
+    int view = term->history->view + lines;
+    uint32_t idx;
+    int y;
+
+    if (view < 0){
+        view = 0;
+    }
+    if (view > term->history->count){
+        view = term->history->count;
+    }
+    if (view == term->history->view || term->terminalID != cur_terminal_id){
+        return;
+    }
+    term->history->view = view;
+    if (view == 0){
+        term->dirty_rows = ALL_ROWS_DIRTY;
+        terminal_flush(term);
+        return;
+    }
+    // line idx of history + screen is shown on screen line y.
+    for (y = 0; y < SCREEN_HEIGHT; y++){
+        idx = term->history->count - view + y;
+        if (idx < term->history->count){
+            scrollback_get(term->history, idx, video + y*SCREEN_WIDTH);
+        } else{
+            memcpy(video + y*SCREEN_WIDTH, TERM_ROW(term, idx - term->history->count), SCREEN_WIDTH*sizeof(uint16_t));
+        }
+    }
+    moving_cursor(0, SCREEN_HEIGHT);                // off the screen.
 }
 
 /*
  *  clear_buffer
- *      DESCRIPTION: clean the current terminal buffer of the given terminal.
+ *      DESCRIPTION: clean the input buffer of the terminal of the running process.
  *      INPUT/OUTPUT: None.
  *      RETURN: None,
  *      SIDE EFFECT: clear the buffer for the terminal.
  */
 void clear_buffer(){
-    if (term_ptr == NULL){
+    if (handle_term == NULL){
         return;
     }
-    memset((void*)term_ptr->input_buffer,0,BUFFER_SIZE);
-    term_ptr->isem = 0;
+    ldisc_flush((ldisc_t*)&handle_term->ldisc);
+    handle_term->status = 0;
 }
 
 /*
@@ -247,11 +919,11 @@ terminal_t* get_terminal(int term_id){
  *      INPUT: terminal_id: the id of the terminal.
  *      OUTPUT: None.
  *      RETURN: None.
- *      SIDE EFFECT: the pages at 8 to 16 KB.
+ *      SIDE EFFECT: the page in the text memory. pool pages are mapped by page_alloc.
  */
 void set_terminal_pages(int terminal_num, int global){
     int index;
-    if (terminal_num > 3 || terminal_num < 0){
+    if (terminal_num >= MAX_TERMINALS || terminal_num < 0 || !in_text_memory(terminal_list+terminal_num)){
         return;
     }
 
@@ -306,7 +978,7 @@ void disable_cursor(){
 
 /*
  *  moving_cursor
- *      DESCRIPTION: update the cursor position with the given X and Y.
+ *      DESCRIPTION: update the cursor position with the given X and Y on the displayed page.
  *      INPUT:  pos_x, pos_y: the desire cursor location on the screen.
  *      OUTPUT: the cursor position update.
  *      RETURN: None.
@@ -314,11 +986,49 @@ void disable_cursor(){
  */
 void moving_cursor(int pos_x, int pos_y){
 
-    uint16_t pos = pos_y*SCREEN_WIDTH + pos_x;
+    uint16_t pos = display_base + pos_y*SCREEN_WIDTH + pos_x;
 
+    // the port writes are slow, skip them when the cursor stays.
+    if (pos == cursor_pos){
+        return;
+    }
+    cursor_pos = pos;
     outb(0x0F, CURSOR_COMMAND);
     outb((uint8_t)(pos&0xFF), CURSOR_DATA);
     outb(0x0E, CURSOR_COMMAND);
     outb((uint8_t)((pos>>8)&0xFF),CURSOR_DATA);
 }
 
+/*
+ *  terminal_cursor_sync
+ *      DESCRIPTION: move the hardware cursor to the displayed terminal once per PIT tick,
+ *                   so a burst of output costs one update. the other terminals keep
+ *                   their mark until they are shown.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: cursor position register may be modified.
+ */
+void terminal_cursor_sync(){
+    terminal_t* term = (terminal_t*)term_ptr;
+    if (term == NULL || !term->cursor_dirty || term->history->view != 0){
+        return;
+    }
+    term->cursor_dirty = 0;
+    moving_cursor(term->cursor_x, term->cursor_y);
+}
+
+/*
+ *  set_display_start
+ *      DESCRIPTION: show the page of the given terminal by moving the CRTC start address.
+ *      INPUT:  term: the terminal to show.
+ *      OUTPUT: the screen shows the page.
+ *      RETURN: None.
+ *      SIDE EFFECT: start address register was modified.
+ */
+static void set_display_start(terminal_t* term){
+    display_base = ((uint32_t)term->video_ptr - VIDEO_ADDR) / sizeof(uint16_t);
+
+    outb(CRTC_START_HIGH, CURSOR_COMMAND);
+    outb((uint8_t)((display_base>>8)&0xFF), CURSOR_DATA);
+    outb(CRTC_START_LOW, CURSOR_COMMAND);
+    outb((uint8_t)(display_base&0xFF), CURSOR_DATA);
+}
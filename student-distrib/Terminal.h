@@ -10,43 +10,91 @@
 #include "keyboard.h"
 #include "lib.h"
 #include "syscall.h"
+#include "scrollback.h"
+#include "ldisc.h"
+#include "ansi.h"
+#include "smp.h"
 
 
 #define BUFFER_SIZE     128         // one page can contain 128 line.
+
+// ioctl commands of the terminal, the mode is TTY_COOKED or TTY_RAW.
+#define TCGETMODE       0x5401
+#define TCSETMODE       0x5402
+#define TTY_COOKED      LDISC_COOKED
+#define TTY_RAW         LDISC_RAW
 #define OUTPUT_SIZE     512         // one page can contain 512 bytes.
 #define OBMINSP         64          // not being used.
 
 #define CURSOR_COMMAND  0x3D4
 #define CURSOR_DATA     0x3D5
 
+// CRTC start address, the word in the 32KB text memory shown first.
+#define CRTC_START_HIGH 0x0C
+#define CRTC_START_LOW  0x0D
+
+#define MAX_TERMINALS   12          // one for each of F1-F12.
+#define DEFAULT_TERMINALS 3         // when the boot command line gives no "terminals=N".
+#define VGA_TEXT_PAGES  8           // 4KB pages in the 32KB text memory, the first is not used.
+
 #define SCREEN_WIDTH    80
 #define SCREEN_HEIGHT   25
 
+#define TEXT_ATTRIB     0x07        // light grey on black.
+#define BLANK_CELL      ((TEXT_ATTRIB << 8) | ' ')
+#define ERASE_CELL(term)    (((term)->attrib << 8) | ' ')    // erased cells keep the current colors.
+#define ALL_ROWS_DIRTY  ((1 << SCREEN_HEIGHT) - 1)
+#define SCROLL_PAGE     (SCREEN_HEIGHT - 1)     // lines moved by Shift+PgUp/PgDn.
+
+// screen row y of the terminal inside its ring of rows.
+#define TERM_ROW(term, y)   ((term)->text[((term)->top_row + (y)) % SCREEN_HEIGHT])
+
 // Terminal structure
 typedef struct terminal_t{
     int  terminalID;                // terminal id.
     int  cur_pid;                  // terminal current process id.
     int  next_tid;                  // next terminal id. (the RR loop.)
-    uint8_t* video_ptr;             // video mapper location.
-    char input_buffer[BUFFER_SIZE]; // terminal input buffer.
-    int  isem;                      // terminal input buffer location.
-    int  status;                    // terminal status for terminal read.
+    int  active;                    // joined the RR loop, it was shown at least once.
+    int  cpu;                       // the CPU whose run queue has it.
+    spinlock_t lock;                // held while a write puts its text in.
+    uint8_t* video_ptr;             // page of the text memory the terminal lives in.
+    ldisc_t ldisc;                  // keyboard input, edited and waiting for read.
+    int  status;                    // set when input goes to the reader.
+    wait_queue_t read_wq;           // readers sleeping until there is input.
     int  cursor_x;                  // cursor location for current terminal.
     int  cursor_y;
+    volatile int cursor_dirty;      // the hardware cursor is not at cursor_x/y yet.
+    uint16_t (*text)[SCREEN_WIDTH]; // ring of SCREEN_HEIGHT rows, the content of the terminal.
+    int  top_row;                   // row of text shown on the first screen line.
+    uint32_t dirty_rows;            // bit y set when screen line y is not in the video memory yet.
+    scrollback_t* history;          // lines that scrolled off the top.
+    ansi_t esc;                     // escape sequence being written.
+    uint8_t attrib;                 // color of the chars written, TEXT_ATTRIB by default.
+    int  reverse;                   // the colors of attrib are swapped.
+    int  scroll_top;                // lines moved by a line feed at scroll_bottom, both included.
+    int  scroll_bottom;
+    int  saved_x;                   // cursor kept by ESC 7 or ESC [ s.
+    int  saved_y;
 
 }terminal_t;
 
 // current displaying terminal pointer.
 extern volatile terminal_t* term_ptr;
 
-// currently handling terminal ptr.
-extern volatile terminal_t* handle_term;
+// currently handling terminal ptr, one for each CPU.
+#define handle_term     (this_cpu()->term)
 
 // currently displaying terminal ptr.
 extern volatile int cur_terminal_id;
 
+// number of terminals, set at boot.
+extern int terminal_count;
+
 /* initialize a terminal. */
-void terminal_init();
+void terminal_init(int count);
+
+/* terminal 0, for the kernel messages. usable before terminal_init. */
+terminal_t* terminal_console();
 
 /* switch the terminals. */
 void terminal_switch(int term_id);
@@ -56,12 +104,38 @@ int terminal_open(const uint8_t* filename);
 int terminal_close(int32_t fd);
 int terminal_read(int32_t fd, void* buffer, int32_t nbytes);
 int terminal_write(int32_t fd, const void* buffer, int32_t nbytes);
+int terminal_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+int terminal_poll(int32_t fd, poll_table_t* pt);
+int terminal_ioctl(int32_t fd, int32_t cmd, int32_t arg);
+
+/* text model of the terminal, copied to the video memory by terminal_flush. */
+void terminal_scroll(terminal_t* term);
+void terminal_clear(terminal_t* term);
+void terminal_flush(terminal_t* term);
+
+/* move down a line, scrolling at the bottom of the scroll region. */
+void terminal_line_feed(terminal_t* term);
+
+/* carry out the escape sequence in term->esc. */
+void terminal_escape(terminal_t* term);
+
+/* default colors, whole screen scroll region, no sequence pending. */
+void terminal_reset(terminal_t* term);
+
+/* copy every terminal to the screen again, after the graphics mode. */
+void terminal_redraw();
+
+/* page the displayed terminal through its history, positive goes back. */
+void terminal_view_scroll(terminal_t* term, int lines);
 
 /* cursor handle for terminal in text mode. */
 void enable_cursor(uint8_t start, uint8_t end);
 void disable_cursor();
 void moving_cursor(int pos_x, int pos_y);
 
+/* move the hardware cursor of the displayed terminal if it changed, called by the PIT. */
+void terminal_cursor_sync();
+
 /* helper function to clean the terminal buffer. */
 void clear_buffer();
 
@@ -0,0 +1,113 @@
+//
+// ansi.c - parser for the ANSI/VT100 escape sequences in terminal output.
+//
+
+#include "ansi.h"
+
+/*
+ *  ansi_init
+ *      DESCRIPTION: drop the sequence being read.
+ *      INPUT:  esc: the parser.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void ansi_init(ansi_t* esc){
+    esc->state = ANSI_GROUND;
+    esc->csi = 0;
+    esc->private = 0;
+    esc->nparams = 0;
+    esc->final = 0;
+}
+
+/*
+ *  ansi_feed
+ *      DESCRIPTION: take one output char. in plain text only ESC starts a sequence.
+ *                   a control char inside a sequence cancels it and is printed as usual.
+ *      INPUT:  esc: the parser.
+ *              c: the char.
+ *      OUTPUT: None.
+ *      RETURN: ANSI_PRINT when the caller prints c, ANSI_MORE when it was taken,
+ *              ANSI_DONE when esc holds a complete sequence.
+ *      SIDE EFFECT: None.
+ */
+int32_t ansi_feed(ansi_t* esc, uint8_t c){
+    int32_t* param;
+
+    if (c == ANSI_ESC_CHAR){
+        // a new ESC starts over, even in the middle of a sequence.
+        ansi_init(esc);
+        esc->state = ANSI_ESCAPE;
+        return ANSI_MORE;
+    }
+    if (esc->state == ANSI_GROUND){
+        return ANSI_PRINT;
+    }
+    if (c < ' ' || c == 0x7F){
+        ansi_init(esc);
+        return ANSI_PRINT;
+    }
+
+    if (esc->state == ANSI_ESCAPE){
+        if (c == '['){
+            esc->state = ANSI_CSI;
+            esc->csi = 1;
+            return ANSI_MORE;
+        }
+        if (c < 0x30){
+            // intermediate, like the '(' of a charset choice.
+            return ANSI_MORE;
+        }
+        esc->final = c;
+        esc->state = ANSI_GROUND;
+        return ANSI_DONE;
+    }
+
+    // ESC [ numbers.
+    if (c >= '0' && c <= '9'){
+        if (esc->nparams == 0){
+            esc->params[esc->nparams++] = 0;
+        }
+        param = &esc->params[esc->nparams-1];
+        *param = *param * 10 + (c - '0');
+        if (*param > ANSI_MAX_VALUE){
+            *param = ANSI_MAX_VALUE;
+        }
+        return ANSI_MORE;
+    }
+    if (c == ';'){
+        if (esc->nparams == 0){
+            esc->params[esc->nparams++] = 0;
+        }
+        if (esc->nparams < ANSI_MAX_PARAMS){
+            esc->params[esc->nparams++] = 0;
+        }
+        return ANSI_MORE;
+    }
+    if (c == '?'){
+        esc->private = 1;
+        return ANSI_MORE;
+    }
+    if (c < 0x40){
+        return ANSI_MORE;
+    }
+    esc->final = c;
+    esc->state = ANSI_GROUND;
+    return ANSI_DONE;
+}
+
+/*
+ *  ansi_param
+ *      DESCRIPTION: read a number of the sequence.
+ *      INPUT:  esc: the parser, holding a complete sequence.
+ *              i: index of the number.
+ *              def: value for a missing number. 0 counts as missing too.
+ *      OUTPUT: None.
+ *      RETURN: the number.
+ *      SIDE EFFECT: None.
+ */
+int32_t ansi_param(const ansi_t* esc, int32_t i, int32_t def){
+    if (i >= esc->nparams || esc->params[i] == 0){
+        return def;
+    }
+    return esc->params[i];
+}
@@ -0,0 +1,46 @@
+//
+// ansi.h - parser for the ANSI/VT100 escape sequences in terminal output.
+//
+// The parser only collects a sequence. ESC followed by one final char, or
+// ESC [ with up to ANSI_MAX_PARAMS numbers separated by ';' and a final
+// char. When the sequence is complete the terminal carries it out.
+//
+
+#ifndef MP3_ANSI_H
+#define MP3_ANSI_H
+
+#include "types.h"
+
+#define ANSI_ESC_CHAR       0x1B
+#define ANSI_MAX_PARAMS     8           // numbers kept from one sequence, the rest are dropped.
+#define ANSI_MAX_VALUE      9999        // numbers are capped, the screen is much smaller.
+
+// parser states.
+#define ANSI_GROUND         0           // plain text.
+#define ANSI_ESCAPE         1           // ESC seen.
+#define ANSI_CSI            2           // ESC [ seen, reading the numbers.
+
+// results of ansi_feed.
+#define ANSI_PRINT          -1          // the char is not part of a sequence.
+#define ANSI_MORE           0           // taken, the sequence goes on.
+#define ANSI_DONE           1           // the sequence is complete.
+
+typedef struct ansi{
+    int32_t state;
+    int32_t csi;                        // 1 for ESC [ sequences, 0 for ESC + one char.
+    int32_t private;                    // '?' after ESC [, the DEC private modes.
+    int32_t params[ANSI_MAX_PARAMS];
+    int32_t nparams;
+    uint8_t final;                      // the char that ended the sequence.
+}ansi_t;
+
+/* back to plain text. */
+void ansi_init(ansi_t* esc);
+
+/* give one output char to the parser. */
+int32_t ansi_feed(ansi_t* esc, uint8_t c);
+
+/* number i of the sequence, def when missing or 0. */
+int32_t ansi_param(const ansi_t* esc, int32_t i, int32_t def);
+
+#endif //MP3_ANSI_H
@@ -0,0 +1,463 @@
+//
+// apic.c - local APIC and IO-APIC, used instead of the 8259 when present.
+//
+// The IO-APIC and the routing of the ISA IRQs come from the MADT of the
+// ACPI tables. Without it the 8259 stays in charge. Both APICs are mapped
+// with one uncached 4MB page each, kernel only.
+//
+// referred from:
+// APIC. APIC - OSDev Wiki. (n.d.). Retrieved from https://wiki.osdev.org/APIC
+// IOAPIC. IOAPIC - OSDev Wiki. (n.d.). Retrieved from https://wiki.osdev.org/IOAPIC
+//
+
+#include "apic.h"
+#include "lib.h"
+#include "paging.h"
+#include "i8259.h"
+
+#define SUCCESS 0
+#define FAILURE -1
+
+#define CPUID_APIC      (1 << 9)            // edx of cpuid 1.
+
+// where the BIOS may keep the RSDP.
+#define EBDA_SEG_PTR    0x40E
+#define BIOS_ROM_START  0xE0000
+#define BIOS_ROM_END    0x100000
+#define EBDA_SCAN_SIZE  1024
+
+#define ACPI_HEADER     36                  // bytes before the content of a table.
+#define MADT_ENTRIES    44                  // header, local APIC address and flags.
+#define MADT_LAPIC      0
+#define MADT_IOAPIC     1
+#define MADT_OVERRIDE   2
+
+// PIT channel 2 counts 10 ms while the local APIC timer is measured.
+#define PIT_GATE_PORT   0x61
+#define PIT_CH2_DATA    0x42
+#define PIT_CMD_PORT    0x43
+#define PIT_CH2_ONESHOT 0xB0                // channel 2, lo/hi byte, mode 0.
+#define PIT_CH2_OUT     0x20
+#define PIT_HZ          1193180
+#define CALIBRATE_HZ    100
+#define CALIBRATE_COUNT (PIT_HZ / CALIBRATE_HZ)
+#define DELAY_MAX_USEC  50000               // the 16 bit count lasts 54 ms.
+
+volatile int apic_active = 0;
+
+static volatile uint32_t* lapic = (uint32_t*)LAPIC_DEFAULT_BASE;
+static volatile uint32_t* ioapic = (uint32_t*)IOAPIC_DEFAULT_BASE;
+static uint32_t ioapic_gsi_base = 0;        // first GSI of the IO-APIC.
+static uint32_t ioapic_pins = 0;
+static uint32_t lapic_id = 0;               // where the IRQs are sent.
+static uint32_t timer_count = 0;            // initial count of the periodic timer.
+
+uint32_t apic_cpu_ids[NR_CPUS];
+int apic_cpu_count = 0;
+
+// GSI and polarity/trigger bits of each ISA IRQ. the MADT overrides some of them.
+static uint32_t irq_gsi[ISA_IRQS];
+static uint32_t irq_flags[ISA_IRQS];
+
+static uint32_t lapic_read(uint32_t reg){
+    return lapic[reg/sizeof(uint32_t)];
+}
+
+static void lapic_write(uint32_t reg, uint32_t value){
+    lapic[reg/sizeof(uint32_t)] = value;
+}
+
+static uint32_t ioapic_read(uint32_t reg){
+    ioapic[IOAPIC_REGSEL/sizeof(uint32_t)] = reg;
+    return ioapic[IOAPIC_WIN/sizeof(uint32_t)];
+}
+
+static void ioapic_write(uint32_t reg, uint32_t value){
+    ioapic[IOAPIC_REGSEL/sizeof(uint32_t)] = reg;
+    ioapic[IOAPIC_WIN/sizeof(uint32_t)] = value;
+}
+
+/*
+ *  map_region
+ *      DESCRIPTION: map the 4MB around a physical address one to one, uncached.
+ *      INPUT:  addr: the physical address.
+ *      OUTPUT: None.
+ *      RETURN: 1 when this call mapped it, 0 when it was already mapped there,
+ *              FAILURE when the slot is used by something else.
+ *      SIDE EFFECT: the caller flushes the TLB.
+ */
+static int map_region(uint32_t addr){
+    uint32_t index = addr / SIZE_4MB;
+
+    if (page_directory[index].P){
+        return (page_directory[index].PS && page_directory[index].Page_addr == index*SIZE_4MB/SIZE_4KB) ? 0 : FAILURE;
+    }
+    page_directory[index].RW = 1;
+    page_directory[index].US = 0;
+    page_directory[index].PWT = 1;
+    page_directory[index].PCD = 1;
+    page_directory[index].PS = 1;
+    page_directory[index].G = 0;
+    page_directory[index].Page_addr = index*SIZE_4MB/SIZE_4KB;
+    page_directory[index].P = 1;
+    return 1;
+}
+
+/*
+ *  map_low
+ *      DESCRIPTION: make the pages of [start, end) in the first 1MB present or not.
+ */
+static void map_low(uint32_t start, uint32_t end, int present){
+    uint32_t i;
+    for (i = start/SIZE_4KB; i < (end + SIZE_4KB - 1)/SIZE_4KB; i++){
+        page_table[i].P = present;
+    }
+    tlb_flush();
+}
+
+/*
+ *  checksum
+ *      DESCRIPTION: the bytes of an ACPI structure add up to 0.
+ */
+static int checksum(const uint8_t* p, uint32_t len){
+    uint8_t sum = 0;
+    while (len-- > 0){
+        sum += *p++;
+    }
+    return sum == 0;
+}
+
+/*
+ *  scan_rsdp
+ *      DESCRIPTION: look for the RSDP on the 16 byte boundaries of [start, end).
+ *      RETURN: the RSDT address, 0 when not found.
+ */
+static uint32_t scan_rsdp(uint32_t start, uint32_t end){
+    uint32_t p;
+    for (p = start; p + 20 <= end; p += 16){
+        if (!strncmp((int8_t*)p, "RSD PTR ", 8) && checksum((uint8_t*)p, 20)){
+            return *(uint32_t*)(p + 16);
+        }
+    }
+    return 0;
+}
+
+/*
+ *  parse_madt
+ *      DESCRIPTION: read the local APIC, the enabled processors, the first IO-APIC
+ *                   and the IRQ overrides.
+ *      INPUT:  madt: the table.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS, FAILURE when there is no IO-APIC.
+ *      SIDE EFFECT: None.
+ */
+static int parse_madt(const uint8_t* madt){
+    uint32_t len = *(uint32_t*)(madt + 4);
+    const uint8_t* entry;
+    int found = 0;
+    uint32_t irq, flags;
+
+    lapic = (uint32_t*)*(uint32_t*)(madt + ACPI_HEADER);
+    for (entry = madt + MADT_ENTRIES; entry + 2 <= madt + len && entry[1] != 0; entry += entry[1]){
+        if (entry[0] == MADT_LAPIC && (entry[4] & 0x1) && apic_cpu_count < NR_CPUS){
+            apic_cpu_ids[apic_cpu_count++] = entry[3];
+        } else if (entry[0] == MADT_IOAPIC && !found){
+            ioapic = (uint32_t*)*(uint32_t*)(entry + 4);
+            ioapic_gsi_base = *(uint32_t*)(entry + 8);
+            found = 1;
+        } else if (entry[0] == MADT_OVERRIDE && entry[3] < ISA_IRQS){
+            irq = entry[3];
+            flags = *(uint16_t*)(entry + 8);
+            irq_gsi[irq] = *(uint32_t*)(entry + 4);
+            irq_flags[irq] = 0;
+            if ((flags & 0x3) == 0x3){
+                irq_flags[irq] |= IOAPIC_ACTIVE_LOW;
+            }
+            if (((flags >> 2) & 0x3) == 0x3){
+                irq_flags[irq] |= IOAPIC_LEVEL;
+            }
+        }
+    }
+    return found ? SUCCESS : FAILURE;
+}
+
+/*
+ *  find_madt
+ *      DESCRIPTION: follow the RSDP and the RSDT to the MADT and parse it.
+ *                   the BIOS area and the tables are mapped only while they are read.
+ *      INPUT/OUTPUT: None.
+ *      RETURN: SUCCESS, FAILURE when there is no usable MADT.
+ *      SIDE EFFECT: None.
+ */
+static int find_madt(){
+    uint32_t rsdt, table, ebda;
+    uint32_t i, n;
+    int mapped, result = FAILURE;
+
+    map_low(0, SIZE_4KB, 1);
+    ebda = (uint32_t)(*(uint16_t*)EBDA_SEG_PTR) << 4;
+    map_low(0, SIZE_4KB, 0);
+    rsdt = 0;
+    if (ebda >= SIZE_4KB && ebda < BIOS_ROM_START){
+        map_low(ebda, ebda + EBDA_SCAN_SIZE, 1);
+        rsdt = scan_rsdp(ebda, ebda + EBDA_SCAN_SIZE);
+        map_low(ebda, ebda + EBDA_SCAN_SIZE, 0);
+    }
+    if (rsdt == 0){
+        map_low(BIOS_ROM_START, BIOS_ROM_END, 1);
+        rsdt = scan_rsdp(BIOS_ROM_START, BIOS_ROM_END);
+        map_low(BIOS_ROM_START, BIOS_ROM_END, 0);
+    }
+    // the tables sit together near the top of the memory.
+    if (rsdt == 0 || (mapped = map_region(rsdt)) == FAILURE){
+        return FAILURE;
+    }
+    tlb_flush();
+    if (!strncmp((int8_t*)rsdt, "RSDT", 4)){
+        n = (*(uint32_t*)(rsdt + 4) - ACPI_HEADER) / sizeof(uint32_t);
+        for (i = 0; i < n; i++){
+            table = ((uint32_t*)(rsdt + ACPI_HEADER))[i];
+            if (table / SIZE_4MB == rsdt / SIZE_4MB && !strncmp((int8_t*)table, "APIC", 4)){
+                result = parse_madt((uint8_t*)table);
+                break;
+            }
+        }
+    }
+    if (mapped == 1){
+        page_directory[rsdt / SIZE_4MB].P = 0;
+        tlb_flush();
+    }
+    return result;
+}
+
+/*
+ *  apic_init
+ *      DESCRIPTION: switch from the 8259 to the APICs when the CPU has a local APIC
+ *                   and the ACPI tables list an IO-APIC. every IO-APIC pin starts
+ *                   masked, enable_irq routes them.
+ *      INPUT: None.
+ *      OUTPUT: None.
+ *      RETURN: 1 when the APICs are used, 0 when the 8259 stays.
+ *      SIDE EFFECT: the 8259 is masked.
+ */
+int apic_init(){
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t i;
+
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    if (!(edx & CPUID_APIC)){
+        return 0;
+    }
+    for (i = 0; i < ISA_IRQS; i++){
+        irq_gsi[i] = i;
+        irq_flags[i] = 0;                   // ISA default, edge and active high.
+    }
+    if (find_madt() != SUCCESS || map_region((uint32_t)lapic) == FAILURE ||
+        map_region((uint32_t)ioapic) == FAILURE){
+        return 0;
+    }
+    tlb_flush();
+
+    // the 8259 keeps its vectors, masked, for a stray interrupt.
+    outb(0xFF, PIC1_DATA);
+    outb(0xFF, PIC2_DATA);
+
+    ioapic_pins = ((ioapic_read(IOAPIC_VER) >> 16) & 0xFF) + 1;
+    for (i = 0; i < ioapic_pins; i++){
+        ioapic_write(IOAPIC_REDTBL + 2*i, IOAPIC_MASKED);
+    }
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+    lapic_id = lapic_read(LAPIC_ID) >> 24;
+    apic_active = 1;
+    return 1;
+}
+
+/*
+ *  irq_pin
+ *      DESCRIPTION: the IO-APIC pin of an ISA IRQ, FAILURE when it has none.
+ */
+static int irq_pin(uint32_t irq_num){
+    uint32_t gsi;
+    if (irq_num >= ISA_IRQS){
+        return FAILURE;
+    }
+    gsi = irq_gsi[irq_num];
+    if (gsi < ioapic_gsi_base || gsi - ioapic_gsi_base >= ioapic_pins){
+        return FAILURE;
+    }
+    return gsi - ioapic_gsi_base;
+}
+
+/*
+ *  apic_enable_irq
+ *      DESCRIPTION: send an ISA IRQ to this CPU at the vector the 8259 would use.
+ *      INPUT:  irq_num: 0 to 15.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: the redirection entry is unmasked.
+ */
+void apic_enable_irq(uint32_t irq_num){
+    int pin = irq_pin(irq_num);
+    if (pin == FAILURE){
+        return;
+    }
+    ioapic_write(IOAPIC_REDTBL + 2*pin + 1, lapic_id << 24);
+    ioapic_write(IOAPIC_REDTBL + 2*pin, (IRQ_VECTOR_BASE + irq_num) | irq_flags[irq_num]);
+}
+
+/*
+ *  apic_disable_irq
+ *      DESCRIPTION: mask an ISA IRQ at the IO-APIC.
+ *      INPUT:  irq_num: 0 to 15.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void apic_disable_irq(uint32_t irq_num){
+    int pin = irq_pin(irq_num);
+    if (pin == FAILURE){
+        return;
+    }
+    ioapic_write(IOAPIC_REDTBL + 2*pin, ioapic_read(IOAPIC_REDTBL + 2*pin) | IOAPIC_MASKED);
+}
+
+/*
+ *  apic_irq_entry
+ *      DESCRIPTION: the low word of the redirection entry of an IRQ, for the tests.
+ *      INPUT:  irq_num: 0 to 15.
+ *      OUTPUT: None.
+ *      RETURN: the entry, IOAPIC_MASKED when the IRQ has no pin.
+ *      SIDE EFFECT: None.
+ */
+uint32_t apic_irq_entry(uint32_t irq_num){
+    int pin = irq_pin(irq_num);
+    if (pin == FAILURE){
+        return IOAPIC_MASKED;
+    }
+    return ioapic_read(IOAPIC_REDTBL + 2*pin);
+}
+
+/*
+ *  apic_eoi
+ *      DESCRIPTION: end the interrupt in service. one store, no port I/O.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void apic_eoi(){
+    lapic_write(LAPIC_EOI, 0);
+}
+
+/*
+ *  pit_oneshot
+ *      DESCRIPTION: gate PIT channel 2 on with the speaker off and start counting down.
+ *                   PIT_CH2_OUT goes up at the end.
+ */
+static void pit_oneshot(uint16_t count){
+    outb((inb(PIT_GATE_PORT) & ~0x02) | 0x01, PIT_GATE_PORT);
+    outb(PIT_CH2_ONESHOT, PIT_CMD_PORT);
+    outb(count & 0xFF, PIT_CH2_DATA);
+    outb(count >> 8, PIT_CH2_DATA);
+}
+
+/*
+ *  pit_oneshot_wait
+ *      DESCRIPTION: wait for the end of the count and gate channel 2 off.
+ */
+static void pit_oneshot_wait(){
+    while (!(inb(PIT_GATE_PORT) & PIT_CH2_OUT));
+    outb(inb(PIT_GATE_PORT) & ~0x01, PIT_GATE_PORT);
+}
+
+/*
+ *  apic_delay
+ *      DESCRIPTION: busy wait, counted by PIT channel 2.
+ *      INPUT:  usec: micro seconds.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void apic_delay(uint32_t usec){
+    uint32_t part;
+    while (usec > 0){
+        part = (usec > DELAY_MAX_USEC) ? DELAY_MAX_USEC : usec;
+        usec -= part;
+        pit_oneshot(part * (PIT_HZ/1000) / 1000 + 1);
+        pit_oneshot_wait();
+    }
+}
+
+/*
+ *  apic_timer_start
+ *      DESCRIPTION: run the local APIC timer of this CPU in periodic mode on the
+ *                   vector of IRQ 0, so pit_handler keeps running the scheduler.
+ */
+static void apic_timer_start(){
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_PERIODIC | IRQ_VECTOR_BASE);
+    lapic_write(LAPIC_TIMER_INIT, timer_count);
+}
+
+/*
+ *  apic_timer_init
+ *      DESCRIPTION: measure the local APIC timer against 10 ms of PIT channel 2 and
+ *                   start it. the APs use the same count, their timers run at the
+ *                   same bus clock.
+ *      INPUT:  freq: ticks per second.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: PIT channel 2 and the speaker gate are used during the measure.
+ */
+void apic_timer_init(uint32_t freq){
+    uint32_t elapsed;
+
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+
+    pit_oneshot(CALIBRATE_COUNT);
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    pit_oneshot_wait();
+    elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CUR);
+
+    timer_count = elapsed * CALIBRATE_HZ / freq;
+    apic_timer_start();
+}
+
+/*
+ *  apic_id
+ *      DESCRIPTION: the local APIC id of the CPU running this.
+ *      INPUT/OUTPUT: None.
+ *      RETURN: the id.
+ *      SIDE EFFECT: None.
+ */
+uint32_t apic_id(){
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+/*
+ *  apic_send_ipi
+ *      DESCRIPTION: send an inter processor interrupt and wait until it is delivered.
+ *      INPUT:  dest: local APIC id of the target.
+ *              icr: LAPIC_ICR_INIT, or LAPIC_ICR_STARTUP with the start page.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void apic_send_ipi(uint32_t dest, uint32_t icr){
+    lapic_write(LAPIC_ICR_HIGH, dest << 24);
+    lapic_write(LAPIC_ICR_LOW, icr);
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING);
+}
+
+/*
+ *  apic_ap_init
+ *      DESCRIPTION: enable the local APIC of the AP running this and start its timer.
+ *                   the IO-APIC still sends every IRQ to the boot CPU.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: the timer interrupt of this CPU comes.
+ */
+void apic_ap_init(){
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+    apic_timer_start();
+}
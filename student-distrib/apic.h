@@ -0,0 +1,89 @@
+//
+// apic.h - local APIC and IO-APIC, used instead of the 8259 when present.
+//
+// The IO-APIC sends the ISA IRQs to the same vectors the 8259 used, so the
+// IDT does not change. The EOI is one store to the local APIC, and the
+// local APIC timer replaces the PIT for the scheduler tick.
+//
+
+#ifndef MP3_APIC_H
+#define MP3_APIC_H
+
+#include "types.h"
+#include "x86_desc.h"
+
+#define LAPIC_DEFAULT_BASE      0xFEE00000
+#define IOAPIC_DEFAULT_BASE     0xFEC00000
+
+// local APIC registers, byte offsets.
+#define LAPIC_ID                0x020
+#define LAPIC_TPR               0x080
+#define LAPIC_EOI               0x0B0
+#define LAPIC_SVR               0x0F0
+#define LAPIC_ICR_LOW           0x300
+#define LAPIC_ICR_HIGH          0x310
+#define LAPIC_LVT_TIMER         0x320
+#define LAPIC_TIMER_INIT        0x380
+#define LAPIC_TIMER_CUR         0x390
+#define LAPIC_TIMER_DIV         0x3E0
+
+#define LAPIC_SVR_ENABLE        0x100
+#define LAPIC_TIMER_PERIODIC    0x20000
+#define LAPIC_LVT_MASKED        0x10000
+#define LAPIC_DIV_16            0x3
+#define LAPIC_ICR_INIT          0x4500      // INIT, level assert.
+#define LAPIC_ICR_STARTUP       0x4600      // the vector is the start page.
+#define LAPIC_ICR_PENDING       0x1000
+#define LAPIC_ICR_NMI_OTHERS    0xC4400     // NMI to every CPU but this one.
+#define LAPIC_ICR_FIXED         0x4000      // the vector in the low byte, level assert.
+
+// IO-APIC registers, reached through the select and window registers.
+#define IOAPIC_REGSEL           0x00
+#define IOAPIC_WIN              0x10
+#define IOAPIC_VER              0x01
+#define IOAPIC_REDTBL           0x10        // two registers for each pin.
+
+#define IOAPIC_ACTIVE_LOW       0x2000
+#define IOAPIC_LEVEL            0x8000
+#define IOAPIC_MASKED           0x10000
+
+#define APIC_SPURIOUS_VECTOR    0xFF
+#define ISA_IRQS                16
+#define IRQ_VECTOR_BASE         0x20        // same vectors as the 8259.
+
+/* 1 once the APICs took over from the 8259. */
+extern volatile int apic_active;
+
+/* local APIC ids of the enabled processors, from the MADT. */
+extern uint32_t apic_cpu_ids[NR_CPUS];
+extern int apic_cpu_count;
+
+/* find and start the APICs. returns 0 when the 8259 has to stay. */
+int apic_init();
+
+/* route an ISA IRQ through the IO-APIC, or mask it. */
+void apic_enable_irq(uint32_t irq_num);
+void apic_disable_irq(uint32_t irq_num);
+
+/* redirection entry of an IRQ, for the tests. */
+uint32_t apic_irq_entry(uint32_t irq_num);
+
+/* end the interrupt at the local APIC. */
+void apic_eoi();
+
+/* periodic local APIC timer at freq Hz on the vector of the PIT. */
+void apic_timer_init(uint32_t freq);
+
+/* local APIC id of this CPU. */
+uint32_t apic_id();
+
+/* send an INIT or STARTUP to another CPU. */
+void apic_send_ipi(uint32_t dest, uint32_t icr);
+
+/* wait with PIT channel 2, the timer interrupt does not need to run. */
+void apic_delay(uint32_t usec);
+
+/* enable the local APIC of an AP, its timer ticks like the one of the boot CPU. */
+void apic_ap_init();
+
+#endif //MP3_APIC_H
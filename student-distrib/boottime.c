@@ -0,0 +1,115 @@
+//
+// boottime.c - TSC stamps of the boot phases.
+//
+// The stamps are raw cycles, so the phases before clock_init can be
+// marked too. They are turned into us when the file is read.
+//
+
+#include "boottime.h"
+#include "lib.h"
+#include "proc.h"
+#include "clock.h"
+
+static uint64_t boot_start;
+static boot_phase_t boot_phases[BOOT_MAX_PHASES];
+static int boot_phase_count = 0;
+
+void boot_time_show(proc_buf_t* out);
+
+/*
+ *  boot_time_init
+ *      DESCRIPTION: take the TSC at the start of entry and register the kernel file
+ *                   "boottime".
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void boot_time_init(){
+    boot_start = rdtsc();
+    proc_register("boottime", boot_time_show, NULL);
+}
+
+/*
+ *  boot_mark
+ *      DESCRIPTION: keep the TSC at the end of a phase. marks past BOOT_MAX_PHASES
+ *                   are dropped.
+ *      INPUT:  name: the phase.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void boot_mark(const int8_t* name){
+    if (boot_phase_count >= BOOT_MAX_PHASES){
+        return;
+    }
+    boot_phases[boot_phase_count].name = name;
+    boot_phases[boot_phase_count].tsc = rdtsc();
+    boot_phase_count++;
+}
+
+/*
+ *  boot_phase
+ *      DESCRIPTION: the mark with the index.
+ *      INPUT:  i: the index, in boot order.
+ *      OUTPUT: None.
+ *      RETURN: the mark, NULL past the last one.
+ *      SIDE EFFECT: None.
+ */
+const boot_phase_t* boot_phase(int i){
+    if (i < 0 || i >= boot_phase_count){
+        return NULL;
+    }
+    return &boot_phases[i];
+}
+
+/*
+ *  cycles_to_us
+ *      DESCRIPTION: turn TSC cycles into us, 0 before clock_init.
+ */
+static uint32_t cycles_to_us(uint64_t cycles){
+    if (tsc_khz == 0){
+        return 0;
+    }
+    cycles *= 1000;
+    do_div64(&cycles, tsc_khz);
+    return (uint32_t)cycles;
+}
+
+/*
+ *  boot_time_us
+ *      DESCRIPTION: the time of the whole boot so far.
+ *      INPUT:  None.
+ *      OUTPUT: None.
+ *      RETURN: us from boot_time_init to the last mark.
+ *      SIDE EFFECT: None.
+ */
+uint32_t boot_time_us(){
+    if (boot_phase_count == 0){
+        return 0;
+    }
+    return cycles_to_us(boot_phases[boot_phase_count-1].tsc - boot_start);
+}
+
+/*
+ *  boot_time_show
+ *      DESCRIPTION: fill the kernel file "boottime", the us and cycles of every phase.
+ *      INPUT:  out: the output buffer.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void boot_time_show(proc_buf_t* out){
+    int i;
+    uint64_t last = boot_start;
+
+    proc_puts(out, "phase              us          cycles\n");
+    for (i = 0; i < boot_phase_count; i++){
+        proc_puts(out, boot_phases[i].name);
+        proc_putnum(out, cycles_to_us(boot_phases[i].tsc - last), 10, 21 - strlen(boot_phases[i].name));
+        proc_putnum64(out, boot_phases[i].tsc - last, 16);
+        proc_puts(out, "\n");
+        last = boot_phases[i].tsc;
+    }
+    proc_puts(out, "total");
+    proc_putnum(out, boot_time_us(), 10, 16);
+    proc_putnum64(out, last - boot_start, 16);
+    proc_puts(out, "\n");
+}
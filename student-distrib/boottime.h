@@ -0,0 +1,33 @@
+//
+// boottime.h - TSC stamps of the boot phases.
+//
+// entry calls boot_mark at the end of each phase. The kernel file
+// "boottime" shows how long each phase took, in us once the clock is
+// calibrated.
+//
+
+#ifndef MP3_BOOTTIME_H
+#define MP3_BOOTTIME_H
+
+#include "types.h"
+
+#define BOOT_MAX_PHASES 24
+
+typedef struct boot_phase{
+    const int8_t* name;
+    uint64_t tsc;                       // TSC at the end of the phase.
+}boot_phase_t;
+
+/* take the TSC at the start of the boot. */
+void boot_time_init();
+
+/* a phase ended. the name must stay valid. */
+void boot_mark(const int8_t* name);
+
+/* the phase with the index, NULL past the last one. */
+const boot_phase_t* boot_phase(int i);
+
+/* us from boot_time_init to the last mark, 0 before clock_init. */
+uint32_t boot_time_us();
+
+#endif //MP3_BOOTTIME_H
@@ -0,0 +1,84 @@
+//
+// clock.c - monotonic clock counted by the TSC.
+//
+// A cycle count becomes ns by a multiply with clock_mult, the ns per cycle
+// in fixed point with clock_shift fraction bits, so no 64 bit division is
+// done per read. The shift is 32 unless the TSC is slower than 1 GHz.
+// The TSCs of the CPUs may not agree, so the last value given out is a
+// floor for the next one.
+//
+
+#include "clock.h"
+#include "lib.h"
+#include "apic.h"
+#include "spinlock.h"
+#include "scheduler.h"
+
+uint32_t tsc_khz = 0;
+
+static uint64_t tsc_base;               // TSC at clock_init.
+static uint32_t clock_mult;             // ns per cycle << clock_shift.
+static uint32_t clock_shift;
+static uint64_t clock_last = 0;
+static spinlock_t clock_lock = SPIN_LOCK_UNLOCKED;
+
+/*
+ *  clock_init
+ *      DESCRIPTION: count the TSC cycles in CLOCK_CALIBRATE_MS of PIT channel 2.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: takes CLOCK_CALIBRATE_MS. the clock starts at 0.
+ */
+void clock_init(){
+    uint32_t eax, ebx, ecx, edx;
+    uint64_t cycles;
+
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    if (!(edx & CPUID_TSC)){
+        return;
+    }
+    tsc_base = rdtsc();
+    apic_delay(CLOCK_CALIBRATE_MS * 1000);
+    cycles = rdtsc() - tsc_base;
+    do_div64(&cycles, CLOCK_CALIBRATE_MS);
+    tsc_khz = (uint32_t)cycles;
+    if (tsc_khz == 0){
+        return;
+    }
+    // (10^6 ns per ms << shift) / cycles per ms, the largest shift that fits 32 bits.
+    for (clock_shift = 32; clock_shift > 0; clock_shift--){
+        cycles = (uint64_t)1000000 << clock_shift;
+        do_div64(&cycles, tsc_khz);
+        if ((cycles >> 32) == 0){
+            break;
+        }
+    }
+    clock_mult = (uint32_t)cycles;
+}
+
+/*
+ *  clock_ns
+ *      DESCRIPTION: the time since clock_init.
+ *      INPUT: None.
+ *      OUTPUT: None.
+ *      RETURN: ns. with the PIT it moves in steps of one tick.
+ *      SIDE EFFECT: None.
+ */
+uint64_t clock_ns(){
+    uint32_t flags;
+    uint64_t cycles, ns;
+
+    if (tsc_khz == 0){
+        return (uint64_t)pit_ticks * (NSEC_PER_SEC / PIT_FREQ);
+    }
+    spin_lock_irqsave(&clock_lock, flags);
+    cycles = rdtsc() - tsc_base;
+    // (hi*2^32 + lo) * mult >> shift, in two 32x32 multiplies.
+    ns = (((uint64_t)(uint32_t)(cycles >> 32) * clock_mult) << (32 - clock_shift)) +
+         (((uint64_t)(uint32_t)cycles * clock_mult) >> clock_shift);
+    if (ns < clock_last){
+        ns = clock_last;
+    }
+    clock_last = ns;
+    spin_unlock_irqrestore(&clock_lock, flags);
+    return ns;
+}
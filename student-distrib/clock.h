@@ -0,0 +1,26 @@
+//
+// clock.h - monotonic clock counted by the TSC.
+//
+// clock_init measures the TSC against PIT channel 2 at boot. clock_ns is
+// the time since then in ns. Without a TSC it falls back to the PIT ticks.
+//
+
+#ifndef MP3_CLOCK_H
+#define MP3_CLOCK_H
+
+#include "types.h"
+
+#define NSEC_PER_SEC        1000000000
+#define CLOCK_CALIBRATE_MS  10          // one PIT count off is 0.01%, short for the boot.
+#define CPUID_TSC           (1 << 4)    // edx of cpuid 1.
+
+// TSC cycles per ms, 0 when the clock uses the PIT.
+extern uint32_t tsc_khz;
+
+/* measure the TSC. */
+void clock_init();
+
+/* ns since clock_init. never goes back, on any CPU. */
+uint64_t clock_ns();
+
+#endif //MP3_CLOCK_H
@@ -4,6 +4,8 @@
 
 #include "filesystem.h"
 #include "syscall.h"
+#include "proc.h"
+#include "uaccess.h"
 
 // why dont call it SSE FS?
 // SSE is for SuperSimpleExt.
@@ -101,7 +103,8 @@ int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry){
             return SUCCESS;
         }
     }
-    return FAILURE;
+    // not in the image, try the files generated by the kernel.
+    return proc_lookup(fname, dentry);
 }
 
 /*
@@ -127,21 +130,20 @@ int32_t read_dentry_by_index(uint32_t idx, dentry_t* dentry){
 }
 
 /*
- *  read_data
- *      DESCRIPTION: read the data from the given inodes in to the buffer and return
- *                   the number of bytes read.
+ *  read_data_copy
+ *      DESCRIPTION: read the data from the given inodes in to the buffer, one block
+ *                   piece at a time, and return the number of bytes read.
  *      INPUT:  index_idx: the index of the node.
  *              offset: byte offset from the start of the files.
  *              buff:   the target buffer pointer.
  *              nbytes: number of bytes should be copied.
+ *              to_user: the buffer belongs to the user, copy with copy_to_user.
  *      OUTPUT: None.
  *      RETURN: Number of bytes being copied. FAILURE for error.
  */
-int32_t read_data(uint32_t inode_idx, uint32_t offset, uint8_t* buff, uint32_t nbytes){
-    int i,j;
-    int read_count = 0;
-    int data_block_start,data_block_end,data_block_id;
-    int left_bytes;
+static int32_t read_data_copy(uint32_t inode_idx, uint32_t offset, uint8_t* buff, uint32_t nbytes, int to_user){
+    uint32_t read_count = 0;
+    uint32_t block_offset, chunk, left;
     inode_t* target_node;
     block_t* target_block;
 
@@ -152,77 +154,62 @@ int32_t read_data(uint32_t inode_idx, uint32_t offset, uint8_t* buff, uint32_t n
     // look up the target inodes.
     target_node = (inode_t*)(inode_start+inode_idx);
 
+    if (offset >= target_node->length){
+        return 0; // no need to read
+    }
     if (offset+nbytes > target_node->length){
-
-        //printf("TOO MANY CHARS: %d \n", offset+nbytes);
-        //return 0;
         nbytes = target_node->length - offset;
-        if(nbytes ==0){
-            return 0; // no need to read
-        }
-    };
-
-    // find out the start block we should read.
-    data_block_start = offset/(BLOCK_SIZE);
-    data_block_end   = (offset+nbytes)/(BLOCK_SIZE);
-
-    // check if the start point and end point is out of the target node.
-    
-    left_bytes = nbytes;//all need to copy nbyte characters
-
-    // read all the data block.
-    //printf("the data copy from the file is:");
-    for (i = data_block_start; i <= data_block_end; i++){
-
-        data_block_id = target_node->blocks_num[i];
-        target_block = (block_start+data_block_id);
-
-        if (/*left_bytes > (BLOCK_SIZE) ||*/ ((offset+ read_count)/(BLOCK_SIZE) < (offset+nbytes)/(BLOCK_SIZE)  ) ){
-            // current block should copy all the bytes into the buffer.
-            
-            if (i == data_block_start) {
-                // calculate the start offset.
-                j = offset % (BLOCK_SIZE);//j in the start index of the data block
-            } else{
-                j = 0;
-            }
-            // copy in progress.
+    }
 
-            for (;j<BLOCK_SIZE;j++) {
-                //printf("%d",target_block->data[j]);
-                buff[read_count]= target_block->data[j];
-                read_count++;
+    // copy the part of each data block in one go.
+    while (read_count < nbytes){
+        block_offset = (offset + read_count) % BLOCK_SIZE;
+        target_block = block_start + target_node->blocks_num[(offset + read_count)/BLOCK_SIZE];
+        chunk = BLOCK_SIZE - block_offset;
+        if (chunk > nbytes - read_count){
+            chunk = nbytes - read_count;
+        }
+        if (to_user){
+            left = copy_to_user(buff + read_count, &target_block->data[block_offset], chunk);
+            if (left != 0){
+                // bad user buffer, report what made it.
+                read_count += chunk - left;
+                return (read_count == 0) ? FAILURE : read_count;
             }
-            left_bytes  = nbytes - read_count;
         } else{
-            // current at the end of the data block.
-            if (i == data_block_start)  {
-                // calculate the start offset.
-                j = offset % (BLOCK_SIZE);
-                for(;j<(offset%BLOCK_SIZE) + left_bytes;j++){
-                //printf("%d",target_block->data[j]);
-                    buff[read_count] = target_block->data[j];
-                    read_count++;
-                } 
-                left_bytes  = nbytes - read_count;
-            }
-            else{
-                j = 0;
-                for(;j<left_bytes;j++){
-                //printf("%d",target_block->data[j]);
-                    buff[read_count] = target_block->data[j];
-                    read_count++;
-                }
-                left_bytes  = nbytes - read_count;
-            }
-            // copy the data.
-            
+            memcpy(buff + read_count, &target_block->data[block_offset], chunk);
         }
+        read_count += chunk;
     }
 
     return read_count;
 }
 
+/*
+ *  read_data
+ *      DESCRIPTION: read the data from the given inodes in to a kernel buffer.
+ *      INPUT:  index_idx: the index of the node.
+ *              offset: byte offset from the start of the files.
+ *              buff:   the target buffer pointer.
+ *              nbytes: number of bytes should be copied.
+ *      OUTPUT: None.
+ *      RETURN: Number of bytes being copied. FAILURE for error.
+ */
+int32_t read_data(uint32_t inode_idx, uint32_t offset, uint8_t* buff, uint32_t nbytes){
+    return read_data_copy(inode_idx, offset, buff, nbytes, 0);
+}
+
+/*
+ *  read_data_user
+ *      DESCRIPTION: read the data from the given inodes in to a user buffer.
+ *      INPUT:  same as read_data.
+ *      OUTPUT: None.
+ *      RETURN: Number of bytes being copied. FAILURE for error or bad buffer.
+ */
+int32_t read_data_user(uint32_t inode_idx, uint32_t offset, uint8_t* buff, uint32_t nbytes){
+    return read_data_copy(inode_idx, offset, buff, nbytes, 1);
+}
+
 
 
 // directory system call function.
@@ -315,10 +302,13 @@ int directory_read(int32_t fd, void* buf, int32_t nbytes){
     for (i = 0;i<NAME_LENGTH;i++){
         buffer[i] = boot_ptr->dentries[cur_fd_array[fd].file_pos].filename[i];
     }
-    strcpy((int8_t*)buf, buffer);
-
     length = strlen(buffer);
 
+    // copy the name with its NULL if there is room.
+    if (copy_to_user(buf, buffer, (length+1 <= nbytes) ? length+1 : nbytes)){
+        return FAILURE;
+    }
+
     // update position
     cur_fd_array[fd].file_pos += 1;
 
@@ -413,7 +403,7 @@ int file_read(int32_t fd, void* buffer, int32_t nbytes){
         return FAILURE;
     }
     //printf("the input offset is:%d\n",offset);
-    read_count = read_data(cur_fd_array[fd].inode_num,offset,buffer,nbytes);
+    read_count = read_data_user(cur_fd_array[fd].inode_num,offset,buffer,nbytes);
 
     if (read_count != -1){
         cur_fd_array[fd].file_pos += read_count;
@@ -422,6 +412,46 @@ int file_read(int32_t fd, void* buffer, int32_t nbytes){
     return read_count;
 }
 
+/*
+ *  file_readv
+ *      DESCRIPTION: read the current opened file into several buffers in one go.
+ *                   the fd is looked up once and the file position moves across segments.
+ *      INPUT:  fd: file descriptor.
+ *              iov: the segment array, checked by the syscall.
+ *              iovcnt: number of segments.
+ *      OUTPUT: None.
+ *      RETURN: total numbers of bytes that read, or -1 for FAIL.
+ *      SIDE EFFECT: the file position is moved forward.
+ */
+int file_readv(int32_t fd, const iovec_t* iov, int32_t iovcnt){
+    int i;
+    int read_count;
+    int total = 0;
+    file_des_t* cur_fd;
+
+    cur_fd = &get_fd_array()[fd];
+    if (cur_fd->flag == 0 || dir_loc > boot_ptr->dir_count){
+        return FAILURE;
+    }
+
+    for (i = 0; i < iovcnt; i++){
+        if (iov[i].iov_len == 0){
+            continue;
+        }
+        read_count = read_data_user(cur_fd->inode_num, cur_fd->file_pos, iov[i].iov_base, iov[i].iov_len);
+        if (read_count == FAILURE){
+            return (total == 0) ? FAILURE : total;
+        }
+        cur_fd->file_pos += read_count;
+        total += read_count;
+        // end of file, the rest segments get nothing.
+        if (read_count < iov[i].iov_len){
+            break;
+        }
+    }
+    return total;
+}
+
 /*
  *  file_write
  *      DESCRIPTION: not used in read only fs.
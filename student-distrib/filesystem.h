@@ -7,6 +7,7 @@
 
 #include "types.h"
 #include "lib.h"
+#include "syscall.h"
 
 // Constant define by the definition of SSE FS.
 #define BOOT_RESERVE    52
@@ -52,6 +53,7 @@ int32_t read_dentry_by_index(uint32_t idx, dentry_t* dentry);
 
 /* read data block function. */
 int32_t read_data(uint32_t inode_idx, uint32_t offset, uint8_t* buf, uint32_t nbytes);
+int32_t read_data_user(uint32_t inode_idx, uint32_t offset, uint8_t* buf, uint32_t nbytes);
 
 /* directory system call function. */
 int directory_open(const uint8_t* filename);
@@ -64,6 +66,7 @@ int file_open(const uint8_t* filename);
 int file_close(int32_t fd);
 int file_read(int32_t fd, void* buffer, int32_t nbytes);
 int file_write(int32_t fd, const void* buffer, int32_t nbytes);
+int file_readv(int32_t fd, const iovec_t* iov, int32_t iovcnt);
 
 /* helper functions. */
 int get_file_length(dentry_t* dptr);
@@ -0,0 +1,122 @@
+//
+// fpu.c - lazy x87/SSE state of the user programs.
+//
+// The state is saved when a CPU leaves a process that used the FPU in its
+// time slice (TS clear), and loaded back at its first FPU instruction after
+// it runs again, which may be on another CPU. A process uses the FPU for
+// the first time with the state fninit gives, taken at boot.
+//
+
+#include "fpu.h"
+#include "lib.h"
+#include "smp.h"
+#include "syscall.h"
+
+static int fpu_has_fxsr = 0;
+static fpu_state_t fpu_init_state;
+
+/*
+ *  fpu_save / fpu_restore
+ *      DESCRIPTION: FXSAVE/FXRSTOR when the CPU has them, FNSAVE/FRSTOR otherwise.
+ *                   FNSAVE also resets the FPU, which is fine since TS is set after.
+ */
+static void fpu_save(fpu_state_t* state){
+    if (fpu_has_fxsr){
+        asm volatile("fxsave (%0)" : : "r"(state->area) : "memory");
+    } else{
+        asm volatile("fnsave (%0)" : : "r"(state->area) : "memory");
+    }
+}
+
+static void fpu_restore(fpu_state_t* state){
+    if (fpu_has_fxsr){
+        asm volatile("fxrstor (%0)" : : "r"(state->area) : "memory");
+    } else{
+        asm volatile("frstor (%0)" : : "r"(state->area) : "memory");
+    }
+}
+
+static inline uint32_t read_cr0(){
+    uint32_t cr0;
+    asm volatile("movl %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+static inline void stts(){
+    asm volatile("movl %0, %%cr0" : : "r"(read_cr0() | CR0_TS) : "memory");
+}
+
+/*
+ *  fpu_init
+ *      DESCRIPTION: turn on the x87 with native error reporting, and FXSAVE and SSE
+ *                   when the CPU has them. the first call keeps the reset state for
+ *                   the processes. called by every CPU.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: CR0 and CR4 modified, TS is set.
+ */
+void fpu_init(){
+    uint32_t eax, ebx, ecx, edx, cr4;
+    uint32_t mxcsr = MXCSR_DEFAULT;
+
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    asm volatile("movl %0, %%cr0" : : "r"((read_cr0() & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE));
+    if (edx & CPUID_FXSR){
+        asm volatile("movl %%cr4, %0" : "=r"(cr4));
+        cr4 |= CR4_OSFXSR;
+        if (edx & CPUID_SSE){
+            cr4 |= CR4_OSXMMEXCPT;
+        }
+        asm volatile("movl %0, %%cr4" : : "r"(cr4));
+        fpu_has_fxsr = 1;
+    }
+    asm volatile("fninit");
+    if (!fpu_init_state.valid){
+        if (edx & CPUID_SSE){
+            asm volatile("ldmxcsr %0" : : "m"(mxcsr));
+        }
+        fpu_save(&fpu_init_state);
+        fpu_init_state.valid = 1;
+    }
+    stts();
+}
+
+/*
+ *  fpu_switch_out
+ *      DESCRIPTION: save the FPU state of the current process if it used the FPU
+ *                   since it got the CPU, then set TS for the next one.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: TS is set.
+ */
+void fpu_switch_out(){
+    pcb_t* pcb = (pcb_t*)this_cpu()->pcb;
+
+    if (read_cr0() & CR0_TS){
+        return;
+    }
+    if (pcb != NULL){
+        fpu_save(&pcb->fpu);
+        pcb->fpu.valid = 1;
+    }
+    stts();
+}
+
+/*
+ *  fpu_trap
+ *      DESCRIPTION: the current process used the FPU with TS set. clear TS and load
+ *                   its state, or the boot state for its first use.
+ *      INPUT:  regs: registers saved by the stub, unused.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: TS is clear until the CPU leaves the process.
+ */
+void fpu_trap(hw_context_t* regs){
+    uint32_t flags;
+    pcb_t* pcb = (pcb_t*)this_cpu()->pcb;
+
+    // #NM comes in by a trap gate. a switch between clts and the load would save
+    // the registers of the last process as this one's.
+    cli_and_save(flags);
+    asm volatile("clts");
+    fpu_restore((pcb != NULL && pcb->fpu.valid) ? &pcb->fpu : &fpu_init_state);
+    restore_flags(flags);
+}
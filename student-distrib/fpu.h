@@ -0,0 +1,45 @@
+//
+// fpu.h - lazy x87/SSE state of the user programs.
+//
+// CR0.TS is set whenever a CPU changes process, so the first FPU or SSE
+// instruction of the next one traps with #NM. fpu_trap then loads the
+// state of that process. A process that did not touch the FPU since the
+// last change leaves TS set, and nothing is saved for it.
+//
+
+#ifndef MP3_FPU_H
+#define MP3_FPU_H
+
+#include "types.h"
+#include "Linkage.h"
+
+#define FPU_STATE_SIZE  512             // FXSAVE area, FNSAVE needs 108.
+
+#define CR0_MP          0x00000002
+#define CR0_EM          0x00000004
+#define CR0_TS          0x00000008
+#define CR0_NE          0x00000020
+#define CR4_OSFXSR      0x00000200
+#define CR4_OSXMMEXCPT  0x00000400
+
+#define CPUID_FXSR      (1 << 24)       // edx of cpuid 1.
+#define CPUID_SSE       (1 << 25)
+
+#define MXCSR_DEFAULT   0x1F80          // all SSE exceptions masked.
+
+// FPU state of one process, kept in its pcb.
+typedef struct fpu_state{
+    uint8_t  area[FPU_STATE_SIZE] __attribute__((aligned(16)));
+    uint32_t valid;                     // 0 until the process used the FPU once.
+}fpu_state_t;
+
+/* turn on the FPU (and SSE when present) on this CPU. */
+void fpu_init();
+
+/* called before a CPU leaves the current process. */
+void fpu_switch_out();
+
+/* #NM handler. */
+void fpu_trap(hw_context_t* regs);
+
+#endif //MP3_FPU_H
@@ -3,6 +3,7 @@
  */
 
 #include "i8259.h"
+#include "apic.h"
 #include "lib.h"
 
 /* Interrupt masks to determine which interrupts are enabled and disabled */
@@ -50,25 +51,26 @@ void i8259_init(void) {
  *      INPUT:  irq: the interrupt num from 0 to 15.
  *      OUTPUT: None.
  *      RETURN: None.
- *      SIDE EFFECT: Enable one specific interrupt port on PIC.
+ *      SIDE EFFECT: Enable one specific interrupt port on PIC, or on the IO-APIC.
  */
 void enable_irq(uint32_t irq_num) {
-    unsigned int port,value;
     // check if the number is valid.
     if (irq_num > Max_Device || irq_num< 0){
         return;
     }
+    if (apic_active){
+        apic_enable_irq(irq_num);
+        return;
+    }
 
-    // Check for Master and Slave port.
+    // Check for Master and Slave port. the cached mask saves reading the port back.
     if (irq_num  < 8) {
-        port = PIC1_DATA;
+        master_mask &= ~(1 << irq_num);
+        outb(master_mask, PIC1_DATA);
     } else {
-        port = PIC2_DATA;
-        irq_num -= 8;
+        slave_mask &= ~(1 << (irq_num - 8));
+        outb(slave_mask, PIC2_DATA);
     }
-
-    value = inb(port) & ~(1 << irq_num);
-    outb(value, port);
     return;
 }
 
@@ -80,26 +82,26 @@ void enable_irq(uint32_t irq_num) {
  *      INPUT: urq: the given irq port.
  *      OUTPUT: None.
  *      RETURN: None.
- *      SIDE EFFECT: Disable specific port n PIC.
+ *      SIDE EFFECT: Disable specific port n PIC, or on the IO-APIC.
  */
 void disable_irq(uint32_t irq_num) {
-
-    unsigned int port, value;
     // check if the irq value is valid.
     if (irq_num > Max_Device || irq_num<0){
         return;
     }
+    if (apic_active){
+        apic_disable_irq(irq_num);
+        return;
+    }
 
     // check for master and slave port.
     if (irq_num < 8){
-        port = PIC1_DATA;
+        master_mask |= 1 << irq_num;
+        outb(master_mask, PIC1_DATA);
     } else{
-        port = PIC2_DATA;
-        irq_num -= 8;
+        slave_mask |= 1 << (irq_num - 8);
+        outb(slave_mask, PIC2_DATA);
     }
-
-    value = inb(port) | (1 << irq_num);
-    outb(value, port);
     return;
 }
 
@@ -112,12 +114,17 @@ void disable_irq(uint32_t irq_num) {
  *      OUTPUT: None.
  *      RETURN: None.
  *      SIDE EFFECT: Send EOI signal to the bus, the interrupt will end.
+ *                   with the APIC it is one store to the local APIC.
  */
 void send_eoi(uint32_t irq_num) {
     // check if the irq value is valid.
     if (irq_num > Max_Device || irq_num<0){
         return;
     }
+    if (apic_active){
+        apic_eoi();
+        return;
+    }
 
     if (irq_num < 8){
         // send EOI to master PIC only.
@@ -32,6 +32,10 @@
  * to declare the interrupt finished */
 #define EOI                 0x60
 
+/* cached masks, the ports are only written. */
+extern uint8_t master_mask;
+extern uint8_t slave_mask;
+
 /* Externally-visible functions */
 
 /* Initialize both PICs */
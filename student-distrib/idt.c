@@ -10,36 +10,40 @@
 #include "syscall.h"
 #include "tasks.h"
 #include "sb16.h"
+#include "uaccess.h"
+#include "Signals.h"
+#include "irq.h"
+#include "apic.h"
+#include "fpu.h"
+#include "proc.h"
+#include "scheduler.h"
+#include "smp.h"
+
+#define SUCCESS 0
+#define FAILURE -1
+
+#define EFLAGS_TF   0x0100              // single step.
 
 // programming used. TODO: delete it when ready compile.
 //extern idt;
 
-void raise_except_info(int num);
-
-// *****  Checkpoint 1 only ***** //
-// Define Chars to Print out When receive IRQ.
-char* except_table[20]={
-        "0x00: Divide By Zero Error.",
-        "0x01: Debug Error. ",
-        "0x02: NMI Exception",
-        "0x03: ",
-        "0x04: ",
-        "0x05: ",
-        "0x06: ",
-        "0x07: ",
-        "0x08: ",
-        "0x09: ",
-        "0x0A: ",
-        "0x0B: Segment not present Error. ",
-        "0x0C: ",
-        "0x0D: ",
-        "0x0E: Page Fault",
-        "0x0F: ",
-        "0x10: ",
-        "0x11: ",
-        "0x12: ",
-        "0x13: "
-        // TODO: Fill the text when free.
+void crash_show(proc_buf_t* out);
+
+static crash_record_t crash_records[MAX_PROCESS];
+static volatile int panicking = 0;          // set by the CPU that stops the kernel.
+
+// handler and name of each exception, set in do_IRQ's table by init_idt.
+static irq_handler_t except_handlers[Exception_range] = {
+        divide_error, debug, nmi, breakpoint, overflow, bounds, invalid_op,
+        device_not_available, doublefault_fn, coprocessor_segment_overrun, invalid_TSS,
+        segment_not_present, stack_segment, general_protection, page_fault, intel_reserved,
+        coprocessor_error, alignment_check, machine_check, simd_coprocessor_error
+};
+static const int8_t* except_names[Exception_range] = {
+        "divide error", "debug", "nmi", "breakpoint", "overflow", "bounds", "invalid op",
+        "no math", "double fault", "coproc overrun", "invalid TSS", "no segment",
+        "stack segment", "general prot", "page fault", "reserved", "x87 error",
+        "alignment", "machine check", "simd error"
 };
 
 // ***** Check point 1 only ***** //
@@ -57,23 +61,179 @@ void syscall_handle(){
 }
 
 /*
- *  raise_except_info
- *      DESCRIPTION: The exception handler for CP1. Raise Exception info
- *                  using while loop to freeze the machine.
- *      INPUT:  except_num: the exception vector. up to 0xFF.
- *      OUTPUT: PRINT OUT the exception information.
+ *  crash_save
+ *      DESCRIPTION: keep the registers of the current process in its crash record.
+ *      INPUT:  regs: registers saved by the linkage.
+ *              except_num: the exception vector.
+ *      OUTPUT: None.
  *      RETURN: None.
- *      SIDE EFFECT: Freeze the system using while loop.
+ *      SIDE EFFECT: the last record of the pid is replaced.
+ */
+static void crash_save(hw_context_t* regs, int except_num){
+    int32_t pid = get_current_pid();
+    crash_record_t* rec;
+
+    if (pid < 0 || pid >= MAX_PROCESS){
+        return;
+    }
+    rec = &crash_records[pid];
+    rec->vector = except_num;
+    asm volatile("movl %%cr2, %0" : "=r"(rec->cr2));
+    rec->tick = pit_ticks;
+    rec->regs = *regs;
+    rec->valid = 1;
+}
+
+/*
+ *  crash_record
+ *      DESCRIPTION: the crash record of a pid. it stays until the next crash of a
+ *                   process with the same pid.
+ *      INPUT:  pid: the process.
+ *      OUTPUT: None.
+ *      RETURN: the record, NULL for a bad pid.
+ *      SIDE EFFECT: None.
+ */
+const crash_record_t* crash_record(int32_t pid){
+    if (pid < 0 || pid >= MAX_PROCESS){
+        return NULL;
+    }
+    return &crash_records[pid];
+}
+
+/*
+ *  crash_show
+ *      DESCRIPTION: fill the kernel file "crashes", the record of every pid that crashed.
+ *      INPUT:  out: the output buffer.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void crash_show(proc_buf_t* out){
+    int32_t pid;
+    crash_record_t* rec;
+
+    for (pid = 0; pid < MAX_PROCESS; pid++){
+        rec = &crash_records[pid];
+        if (!rec->valid){
+            continue;
+        }
+        proc_puts(out, "pid ");
+        proc_putnum(out, pid, 10, 0);
+        proc_puts(out, " tick ");
+        proc_putnum(out, rec->tick, 10, 0);
+        proc_puts(out, " ");
+        proc_puts(out, except_names[rec->vector]);
+        proc_puts(out, " err ");
+        proc_putnum(out, rec->regs.err_code, 16, 0);
+        if (rec->vector == 0x0E){
+            proc_puts(out, " addr ");
+            proc_putnum(out, rec->cr2, 16, 0);
+        }
+        proc_puts(out, "\n eip ");
+        proc_putnum(out, rec->regs.eip, 16, 8);
+        proc_puts(out, " esp ");
+        proc_putnum(out, rec->regs.esp, 16, 8);
+        proc_puts(out, " ebp ");
+        proc_putnum(out, rec->regs.ebp, 16, 8);
+        proc_puts(out, " eflags ");
+        proc_putnum(out, rec->regs.eflags, 16, 8);
+        proc_puts(out, "\n eax ");
+        proc_putnum(out, rec->regs.eax, 16, 8);
+        proc_puts(out, " ebx ");
+        proc_putnum(out, rec->regs.ebx, 16, 8);
+        proc_puts(out, " ecx ");
+        proc_putnum(out, rec->regs.ecx, 16, 8);
+        proc_puts(out, " edx ");
+        proc_putnum(out, rec->regs.edx, 16, 8);
+        proc_puts(out, "\n esi ");
+        proc_putnum(out, rec->regs.esi, 16, 8);
+        proc_puts(out, " edi ");
+        proc_putnum(out, rec->regs.edi, 16, 8);
+        proc_puts(out, "\n");
+    }
+}
+
+/*
+ *  kernel_panic
+ *      DESCRIPTION: stop the kernel after an exception at kernel level. the other CPUs
+ *                   get an NMI. its linkage calls kernel_enter first, and this CPU never
+ *                   gives the kernel lock up, so they spin there for good.
+ *      INPUT:  regs: registers saved by the linkage.
+ *              except_num: the exception vector.
+ *      OUTPUT: the exception and the registers on the screen.
+ *      RETURN: never.
+ *      SIDE EFFECT: the machine stops.
  */
-void raise_except_info (int except_num){
+static void kernel_panic(hw_context_t* regs, int except_num){
+    uint32_t cr2;
+
     cli();
-    printf("\n");
-    printf(" EXCEPTION: %s", except_table[except_num]);
-    printf("\n");
+    if (!panicking){
+        panicking = 1;
+        if (apic_active){
+            apic_send_ipi(0, LAPIC_ICR_NMI_OTHERS);
+        }
+        asm volatile("movl %%cr2, %0" : "=r"(cr2));
+        printf("\n EXCEPTION: %s in the kernel, cpu %d, err %x, cr2 %x\n",
+               except_names[except_num], smp_processor_id(), regs->err_code, cr2);
+        printf(" eip %x esp %x ebp %x eflags %x\n", regs->eip, regs->esp, regs->ebp, regs->eflags);
+        printf(" eax %x ebx %x ecx %x edx %x esi %x edi %x\n",
+               regs->eax, regs->ebx, regs->ecx, regs->edx, regs->esi, regs->edi);
+    }
+    while (1){
+        asm volatile("hlt");
+    }
+}
+
+/*
+ *  debug_trap
+ *      DESCRIPTION: vectors 1 to 3 are no faults of the code that ran. an NMI is
+ *                   ignored. a user #DB or #BP is ignored as well, there is no debugger
+ *                   to take it: the int3 is already passed, and a single step is turned
+ *                   off so it does not trap again.
+ *      INPUT:  regs: registers saved by the linkage.
+ *              except_num: 1, 2 or 3.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS when it is handled, FAILURE for a #DB or #BP in the kernel.
+ *      SIDE EFFECT: the saved TF may be cleared.
+ */
+static int debug_trap(hw_context_t* regs, int except_num){
+    if (except_num == 0x02){
+        return SUCCESS;
+    }
+    if ((regs->cs & 0x3) != 0x3){
+        return FAILURE;
+    }
+    if (except_num == 0x01){
+        regs->eflags &= ~EFLAGS_TF;
+    }
+    return SUCCESS;
+}
 
-    // restore from errors.
-    halt(1);
-    sti();
+/*
+ *  raise_except_info
+ *      DESCRIPTION: The exception handler. An exception in a user program becomes a
+ *                  signal when the program has a handler for it, DIV_ZERO for divide
+ *                  error and SEGFAULT for the others. Otherwise its registers go to
+ *                  the crash record and it halts with 256. In the kernel it is fatal.
+ *                  The NMI and the debug traps are no faults, see debug_trap.
+ *      INPUT:  regs: registers saved by the linkage.
+ *              except_num: the exception vector. up to 0xFF.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: signal the process, halt it, or stop the kernel.
+ */
+void raise_except_info (hw_context_t* regs, int except_num){
+    if (except_num >= 0x01 && except_num <= 0x03 && debug_trap(regs, except_num) == SUCCESS){
+        return;
+    }
+    if ((regs->cs & 0x3) != 0x3){
+        kernel_panic(regs, except_num);
+    }
+    if (signal_fault(except_num == 0x00 ? DIV_ZERO : SEGFAULT) == SUCCESS){
+        return;
+    }
+    crash_save(regs, except_num);
+    halt_task(SIGNAL_KILL_STATUS);
 }
 
 /*
@@ -118,72 +278,88 @@ void init_idt(void){
         idt[i].reserved0 = 0;
     }
 
-    // Fill the interrupt into the IDT.
-    SET_IDT_ENTRY(idt[0], idt_0);
-    SET_IDT_ENTRY(idt[1], idt_1);
-    SET_IDT_ENTRY(idt[2], idt_2);
-    SET_IDT_ENTRY(idt[3], idt_3);
-    SET_IDT_ENTRY(idt[4], idt_4);
-    SET_IDT_ENTRY(idt[5], idt_5);
-    SET_IDT_ENTRY(idt[6], idt_6);
-    SET_IDT_ENTRY(idt[7], idt_7);
-    SET_IDT_ENTRY(idt[8], idt_8);
-    SET_IDT_ENTRY(idt[9], idt_9);
-    SET_IDT_ENTRY(idt[10], idt_10);
-    SET_IDT_ENTRY(idt[11], idt_11);
-    SET_IDT_ENTRY(idt[12], idt_12);
-    SET_IDT_ENTRY(idt[13], idt_13);
-    SET_IDT_ENTRY(idt[14], idt_14);
-    SET_IDT_ENTRY(idt[15], idt_15);
-    SET_IDT_ENTRY(idt[16], idt_16);
-    SET_IDT_ENTRY(idt[17], idt_17);
-    SET_IDT_ENTRY(idt[18], idt_18);
-    SET_IDT_ENTRY(idt[19], idt_19);
+    // Fill the stubs into the IDT. the exceptions keep the trap gate, the IRQs
+    // use interrupt gates (reserved3 clear) so a handler is not nested. do_IRQ
+    // finds the handler.
+    for (i = 0; i < NR_INTR_STUBS; i++){
+        SET_IDT_ENTRY(idt[i], interrupt_stubs[i]);
+        if (i >= IRQ_VECTOR_BASE){
+            idt[i].reserved3 = 0;
+        }
+    }
+    for (i = 0; i < Exception_range; i++){
+        set_intr_handler(i, except_handlers[i], except_names[i]);
+    }
+    proc_register("crashes", crash_show, NULL);
 
     // system call handle.
     SET_IDT_ENTRY(idt[System_Call_Vector], syscall_handler);
     idt[System_Call_Vector].reserved0 = 0;              // set the gate to interrupt gate.
     idt[System_Call_Vector].dpl = 3;                    // Allow user space to use sys call.
 
-    // key board handle.
-    SET_IDT_ENTRY(idt[KEYBOARD_VECTOR],key_intr_linkage);
-    idt[KEYBOARD_VECTOR].reserved0 = 0;                 // Set the gate into Interrupt gate.
-
-    // RTC handle
-    SET_IDT_ENTRY(idt[RTC_VECTOR],rtc_intr_linkage);
-    idt[RTC_VECTOR].reserved0 = 0;                      // SET the gate into inr gate.
-    idt[RTC_VECTOR].dpl = 3;
+    // spurious interrupt of the local APIC, needs no EOI.
+    SET_IDT_ENTRY(idt[SPURIOUS_VECTOR],spurious_intr_linkage);
+    idt[SPURIOUS_VECTOR].reserved0 = 0;
 
-    // PIT handle
-    SET_IDT_ENTRY(idt[PIT_VECTOR],pit_intr_linkage);
-    idt[PIT_VECTOR].reserved0 = 0;
-    idt[PIT_VECTOR].dpl = 3;
+}
 
-    SET_IDT_ENTRY(idt[SB16_VECTOR],SB16_intr_linkage);
-    idt[SB16_VECTOR].reserved0 = 0;
-    idt[SB16_VECTOR].dpl = 3;
 
+/*
+ *  page_fault
+ *      DESCRIPTION: page fault handler. a fault inside copy_to_user/copy_from_user
+ *                   resumes at the fixup of the exception table, so the copy returns short.
+ *                   any other fault is raised as before.
+ *      INPUT:  regs: registers saved by the stub of vector 14.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: the saved eip may be changed.
+ */
+void page_fault(hw_context_t* regs){
+    uint32_t fixup;
+    if ((regs->cs & 0x3) == 0){
+        fixup = search_exception_table(regs->eip);
+        if (fixup != 0){
+            regs->eip = fixup;
+            return;
+        }
+    }
+    raise_except_info(regs, 0x0E);
 }
 
+/*
+ *  device_not_available
+ *      DESCRIPTION: #NM handler. a user program used the FPU for the first time since
+ *                   it got the CPU, fpu_trap loads its state. the kernel never uses it.
+ *      INPUT:  regs: registers saved by the stub of vector 7.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: CR0.TS is cleared.
+ */
+void device_not_available(hw_context_t* regs){
+    // a user program touched the FPU after a process switch, the kernel never does.
+    if ((regs->cs & 0x3) == 0x3){
+        fpu_trap(regs);
+        return;
+    }
+    raise_except_info(regs, 0x07);
+}
 
 // Fill the exception handler with specific exception.
-void divide_error()         { raise_except_info(0x00);}
-void debug()                { raise_except_info( 0x01);}
-void nmi()                  { raise_except_info(0x02);}
-void breakpoint()           { raise_except_info(0x03);}
-void overflow()             { raise_except_info(0x04);}
-void bounds()               { raise_except_info( 0x05);}
-void invalid_op()           { raise_except_info(0x06);}
-void device_not_available() { raise_except_info(0x07);}
-void doublefault_fn()       { raise_except_info(0x08);}
-void coprocessor_segment_overrun() { raise_except_info(0x09);}
-void invalid_TSS()          { raise_except_info(0x0A);}
-void segment_not_present()  { raise_except_info(0x0B);}
-void stack_segment()        { raise_except_info(0x0C);}
-void general_protection()   { raise_except_info(0x0D);}
-void page_fault()           { raise_except_info(0x0E);}
-void intel_reserved()       { raise_except_info(0x0F);}
-void coprocessor_error()    { raise_except_info(0x10);}
-void alignment_check()      { raise_except_info(0x11);}
-void machine_check()        { raise_except_info(0x12);}
-void simd_coprocessor_error() { raise_except_info(0x13);}
+void divide_error(hw_context_t* regs)                { raise_except_info(regs, 0x00);}
+void debug(hw_context_t* regs)                       { raise_except_info(regs, 0x01);}
+void nmi(hw_context_t* regs)                         { raise_except_info(regs, 0x02);}
+void breakpoint(hw_context_t* regs)                  { raise_except_info(regs, 0x03);}
+void overflow(hw_context_t* regs)                    { raise_except_info(regs, 0x04);}
+void bounds(hw_context_t* regs)                      { raise_except_info(regs, 0x05);}
+void invalid_op(hw_context_t* regs)                  { raise_except_info(regs, 0x06);}
+void doublefault_fn(hw_context_t* regs)              { raise_except_info(regs, 0x08);}
+void coprocessor_segment_overrun(hw_context_t* regs) { raise_except_info(regs, 0x09);}
+void invalid_TSS(hw_context_t* regs)                 { raise_except_info(regs, 0x0A);}
+void segment_not_present(hw_context_t* regs)         { raise_except_info(regs, 0x0B);}
+void stack_segment(hw_context_t* regs)               { raise_except_info(regs, 0x0C);}
+void general_protection(hw_context_t* regs)          { raise_except_info(regs, 0x0D);}
+void intel_reserved(hw_context_t* regs)              { raise_except_info(regs, 0x0F);}
+void coprocessor_error(hw_context_t* regs)           { raise_except_info(regs, 0x10);}
+void alignment_check(hw_context_t* regs)             { raise_except_info(regs, 0x11);}
+void machine_check(hw_context_t* regs)               { raise_except_info(regs, 0x12);}
+void simd_coprocessor_error(hw_context_t* regs)      { raise_except_info(regs, 0x13);}
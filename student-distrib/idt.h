@@ -7,6 +7,9 @@
 #ifndef MP3_IDT_H
 #define MP3_IDT_H
 
+#include "types.h"
+#include "Linkage.h"
+
 // Define some Constant.
 #define idt_size 255       // 0x00 to 0xFF
 #define Exception_range 20  // 0x14
@@ -18,30 +21,46 @@
 #define SB16_VECTOR         0x25
 #define RTC_VECTOR          0x28
 #define MOUSE_VECTOR        0x2C
+#define SPURIOUS_VECTOR     0xFF
+
+// registers of the last exception that killed the process with a pid.
+typedef struct crash_record{
+    uint32_t valid;             // 0 until a process with the pid crashed.
+    uint32_t vector;
+    uint32_t cr2;               // the address of a page fault.
+    uint32_t tick;              // pit_ticks of the crash.
+    hw_context_t regs;
+}crash_record_t;
 
 // Define IDT function.
 void init_idt(void);
 
+// the handler of the exceptions that are not taken by their own handler.
+void raise_except_info(hw_context_t* regs, int except_num);
+
+// the crash record of a pid, NULL for a bad pid.
+const crash_record_t* crash_record(int32_t pid);
+
 // handler extern
-void divide_error();
-void debug();
-void nmi();
-void breakpoint();
-void overflow();
-void bounds();
-void invalid_op();
-void device_not_available();
-void doublefault_fn();
-void coprocessor_segment_overrun();
-void invalid_TSS();
-void segment_not_present();
-void stack_segment();
-void general_protection();
-void page_fault();
-void intel_reserved();
-void coprocessor_error();
-void alignment_check();
-void machine_check();
-void simd_coprocessor_error();
+void divide_error(hw_context_t* regs);
+void debug(hw_context_t* regs);
+void nmi(hw_context_t* regs);
+void breakpoint(hw_context_t* regs);
+void overflow(hw_context_t* regs);
+void bounds(hw_context_t* regs);
+void invalid_op(hw_context_t* regs);
+void device_not_available(hw_context_t* regs);
+void doublefault_fn(hw_context_t* regs);
+void coprocessor_segment_overrun(hw_context_t* regs);
+void invalid_TSS(hw_context_t* regs);
+void segment_not_present(hw_context_t* regs);
+void stack_segment(hw_context_t* regs);
+void general_protection(hw_context_t* regs);
+void page_fault(hw_context_t* regs);
+void intel_reserved(hw_context_t* regs);
+void coprocessor_error(hw_context_t* regs);
+void alignment_check(hw_context_t* regs);
+void machine_check(hw_context_t* regs);
+void simd_coprocessor_error(hw_context_t* regs);
 
 #endif //MP3_IDT_H
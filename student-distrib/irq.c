@@ -0,0 +1,164 @@
+//
+// irq.c - dispatch of the exceptions and hardware interrupts.
+//
+// do_IRQ runs the handler of the vector and adds the time to the vector.
+// For the hardware interrupts it then runs the tasklets and, after a
+// timer tick, switches the process. Both are left out of the time of the
+// handler, so a switch does not count the time of the other process.
+//
+
+#include "irq.h"
+#include "lib.h"
+#include "proc.h"
+#include "apic.h"
+#include "softirq.h"
+#include "scheduler.h"
+
+#define SUCCESS 0
+#define FAILURE -1
+
+static irq_desc_t irq_desc[NR_INTR_STUBS];
+
+void irq_show(proc_buf_t* out);
+
+/*
+ *  irq_init
+ *      DESCRIPTION: register the kernel file "interrupts".
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void irq_init(){
+    proc_register("interrupts", irq_show, NULL);
+}
+
+/*
+ *  set_intr_handler
+ *      DESCRIPTION: set the handler called by do_IRQ for a vector. the counts are kept.
+ *      INPUT:  vector: vector below NR_INTR_STUBS.
+ *              handler: the handler, NULL to remove it.
+ *              name: shown in "interrupts", cut at IRQ_NAME_LENGTH.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS, FAILURE for a bad vector.
+ *      SIDE EFFECT: None.
+ */
+int set_intr_handler(uint32_t vector, irq_handler_t handler, const int8_t* name){
+    uint32_t flags;
+    if (vector >= NR_INTR_STUBS){
+        return FAILURE;
+    }
+    cli_and_save(flags);
+    irq_desc[vector].handler = handler;
+    memset(irq_desc[vector].name, 0, sizeof(irq_desc[vector].name));
+    if (name != NULL){
+        strncpy(irq_desc[vector].name, name, IRQ_NAME_LENGTH);
+    }
+    restore_flags(flags);
+    return SUCCESS;
+}
+
+/*
+ *  request_irq
+ *      DESCRIPTION: set the handler of an IRQ line. the line keeps the 8259 vector
+ *                   with the IO-APIC too.
+ *      INPUT:  irq: the line, 0 to 15.
+ *              handler: the handler.
+ *              name: the device name.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS, FAILURE for a bad line or no handler.
+ *      SIDE EFFECT: None.
+ */
+int request_irq(uint32_t irq, irq_handler_t handler, const int8_t* name){
+    if (irq >= NR_IRQS || handler == NULL){
+        return FAILURE;
+    }
+    return set_intr_handler(IRQ_VECTOR_BASE + irq, handler, name);
+}
+
+/*
+ *  do_IRQ
+ *      DESCRIPTION: run the handler of the vector saved by the stub and count it.
+ *      INPUT:  regs: the hw_context built by the stub.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: may switch the process after a timer tick.
+ */
+void do_IRQ(hw_context_t* regs){
+    uint32_t vector = regs->irq_exp_num;
+    int cpu = smp_processor_id();
+    irq_desc_t* desc;
+    uint64_t start;
+
+    if (vector >= NR_INTR_STUBS){
+        return;
+    }
+    desc = &irq_desc[vector];
+    // counted first, an exception that kills the process does not return.
+    desc->count[cpu]++;
+    start = rdtsc();
+    if (desc->handler != NULL){
+        desc->handler(regs);
+    }
+    desc->cycles[cpu] += rdtsc() - start;
+
+    if (vector >= IRQ_VECTOR_BASE){
+        do_softirq();
+        resched_check();
+    }
+}
+
+/*
+ *  irq_stat
+ *      DESCRIPTION: get the handler and counts of a vector.
+ *      INPUT:  vector: the vector.
+ *      OUTPUT: None.
+ *      RETURN: the entry, NULL for out of range.
+ *      SIDE EFFECT: None.
+ */
+const irq_desc_t* irq_stat(uint32_t vector){
+    if (vector >= NR_INTR_STUBS){
+        return NULL;
+    }
+    return &irq_desc[vector];
+}
+
+/*
+ *  irq_show
+ *      DESCRIPTION: print the calls on each CPU and the total cycles of every vector
+ *                   that has a handler or was hit.
+ *      INPUT:  out: the output buffer.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void irq_show(proc_buf_t* out){
+    int i, vector;
+    uint32_t total;
+    uint64_t cycles;
+    irq_desc_t* desc;
+
+    proc_puts(out, "vec");
+    for (i = 0; i < cpu_count; i++){
+        proc_puts(out, "       cpu");
+        proc_putnum(out, i, 10, 0);
+    }
+    proc_puts(out, "          cycles name\n");
+    for (vector = 0; vector < NR_INTR_STUBS; vector++){
+        desc = &irq_desc[vector];
+        total = 0;
+        cycles = 0;
+        for (i = 0; i < cpu_count; i++){
+            total += desc->count[i];
+            cycles += desc->cycles[i];
+        }
+        if (desc->handler == NULL && total == 0){
+            continue;
+        }
+        proc_putnum(out, vector, 10, 3);
+        for (i = 0; i < cpu_count; i++){
+            proc_putnum(out, desc->count[i], 10, 11);
+        }
+        proc_putnum64(out, cycles, 16);
+        proc_puts(out, " ");
+        proc_puts(out, desc->name);
+        proc_puts(out, "\n");
+    }
+}
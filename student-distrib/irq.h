@@ -0,0 +1,45 @@
+//
+// irq.h - dispatch of the exceptions and hardware interrupts.
+//
+// Vectors 0 to NR_INTR_STUBS-1 enter through one stub each in Linkage.S.
+// The stubs save a hw_context and call do_IRQ, which looks up the handler
+// of the vector and counts the calls and cycles spent in it per CPU. The
+// counts are shown by the kernel file "interrupts".
+//
+
+#ifndef MP3_IRQ_H
+#define MP3_IRQ_H
+
+#include "types.h"
+#include "Linkage.h"
+#include "smp.h"
+
+#define NR_IRQS             16          // lines of the two 8259s.
+#define IRQ_NAME_LENGTH     15
+
+// handler of one vector. the IRQ handlers may leave out the argument.
+typedef void (*irq_handler_t)(hw_context_t* regs);
+
+typedef struct irq_desc{
+    irq_handler_t handler;
+    int8_t   name[IRQ_NAME_LENGTH+1];
+    uint32_t count[NR_CPUS];
+    uint64_t cycles[NR_CPUS];           // spent in the handler, tasklets not counted.
+}irq_desc_t;
+
+/* register the kernel file. */
+void irq_init();
+
+/* set the handler of a vector, exceptions included. */
+int set_intr_handler(uint32_t vector, irq_handler_t handler, const int8_t* name);
+
+/* set the handler of IRQ line irq. the line is enabled by the driver. */
+int request_irq(uint32_t irq, irq_handler_t handler, const int8_t* name);
+
+/* called by every stub. */
+void do_IRQ(hw_context_t* regs);
+
+/* statistics of one vector, NULL for out of range. */
+const irq_desc_t* irq_stat(uint32_t vector);
+
+#endif //MP3_IRQ_H
@@ -16,6 +16,15 @@
 #include "filesystem.h"
 #include "scheduler.h"
 #include "syscall.h"
+#include "trace.h"
+#include "vga.h"
+#include "apic.h"
+#include "smp.h"
+#include "irq.h"
+#include "fpu.h"
+#include "clock.h"
+#include "sb16.h"
+#include "boottime.h"
 
 #define RUN_TESTS
 
@@ -23,25 +32,67 @@
 /* Check if the bit BIT in FLAGS is set. */
 #define CHECK_FLAG(flags, bit)   ((flags) & (1 << (bit)))
 
-/* Check if MAGIC is valid and print the Multiboot information structure
-   pointed by ADDR. */
-void entry(unsigned long magic, unsigned long addr) {
+/*
+ *  boot_terminals
+ *      DESCRIPTION: read the number of terminals from "terminals=N" on the boot command line.
+ *      INPUT: mbi: the multiboot information.
+ *      OUTPUT: None.
+ *      RETURN: N, or DEFAULT_TERMINALS when it is not given.
+ *      SIDE EFFECT: None.
+ */
+static int boot_terminals(multiboot_info_t* mbi){
+    const int8_t* key = "terminals=";
+    const int8_t* arg;
+    int count = 0;
 
-    multiboot_info_t *mbi;
+    if (!CHECK_FLAG(mbi->flags, 2)){
+        return DEFAULT_TERMINALS;
+    }
+    for (arg = (const int8_t*)mbi->cmdline; *arg != '\0'; arg++){
+        if (!strncmp(arg, key, strlen(key))){
+            for (arg += strlen(key); *arg >= '0' && *arg <= '9'; arg++){
+                count = count * 10 + (*arg - '0');
+            }
+            return (count > 0) ? count : DEFAULT_TERMINALS;
+        }
+    }
+    return DEFAULT_TERMINALS;
+}
 
-    void* filesys_ptr;
-    /* Clear the screen. */
-    clear();
+/*
+ *  boot_flag
+ *      DESCRIPTION: check for a word on the boot command line, like "noapic".
+ *      INPUT: mbi: the multiboot information.
+ *             flag: the word.
+ *      OUTPUT: None.
+ *      RETURN: 1 when it is given, 0 otherwise.
+ *      SIDE EFFECT: None.
+ */
+static int boot_flag(multiboot_info_t* mbi, const int8_t* flag){
+    const int8_t* arg;
+    uint32_t len = strlen(flag);
 
-    /* Am I booted by a Multiboot-compliant boot loader? */
-    if (magic != MULTIBOOT_BOOTLOADER_MAGIC) {
-        printf("Invalid magic number: 0x%#x\n", (unsigned)magic);
-        return;
+    if (!CHECK_FLAG(mbi->flags, 2)){
+        return 0;
     }
+    for (arg = (const int8_t*)mbi->cmdline; *arg != '\0'; arg++){
+        if ((arg == (const int8_t*)mbi->cmdline || arg[-1] == ' ') && !strncmp(arg, flag, len) &&
+            (arg[len] == ' ' || arg[len] == '\0')){
+            return 1;
+        }
+    }
+    return 0;
+}
 
-    /* Set MBI to the address of the Multiboot information structure. */
-    mbi = (multiboot_info_t *) addr;
-
+/*
+ *  print_multiboot
+ *      DESCRIPTION: print the Multiboot information structure, left out with "quiet".
+ *      INPUT: mbi: the multiboot information.
+ *      OUTPUT: the fields on the screen.
+ *      RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+static void print_multiboot(multiboot_info_t* mbi){
     /* Print out the flags. */
     printf("flags = 0x%#x\n", (unsigned)mbi->flags);
 
@@ -62,8 +113,6 @@ void entry(unsigned long magic, unsigned long addr) {
         int i;
         module_t* mod = (module_t*)mbi->mods_addr;
 
-        filesys_ptr = (void* )mod->mod_start;
-
         while (mod_count < mbi->mods_count) {
             printf("Module %d loaded at address: 0x%#x\n", mod_count, (unsigned int)mod->mod_start);
             printf("Module %d ends at address: 0x%#x\n", mod_count, (unsigned int)mod->mod_end);
@@ -76,11 +125,6 @@ void entry(unsigned long magic, unsigned long addr) {
             mod++;
         }
     }
-    /* Bits 4 and 5 are mutually exclusive! */
-    if (CHECK_FLAG(mbi->flags, 4) && CHECK_FLAG(mbi->flags, 5)) {
-        printf("Both bits 4 and 5 are set.\n");
-        return;
-    }
 
     /* Is the section header table of ELF valid? */
     if (CHECK_FLAG(mbi->flags, 5)) {
@@ -106,6 +150,49 @@ void entry(unsigned long magic, unsigned long addr) {
                     (unsigned)mmap->length_high,
                     (unsigned)mmap->length_low);
     }
+}
+
+/* Check if MAGIC is valid and print the Multiboot information structure
+   pointed by ADDR. */
+void entry(unsigned long magic, unsigned long addr) {
+
+    multiboot_info_t *mbi;
+
+    void* filesys_ptr;
+    int quiet;
+
+    /* every phase below is stamped, see the kernel file "boottime". */
+    boot_time_init();
+
+    /* Clear the screen. */
+    clear();
+
+    /* Am I booted by a Multiboot-compliant boot loader? */
+    if (magic != MULTIBOOT_BOOTLOADER_MAGIC) {
+        printf("Invalid magic number: 0x%#x\n", (unsigned)magic);
+        return;
+    }
+
+    /* Set MBI to the address of the Multiboot information structure. */
+    mbi = (multiboot_info_t *) addr;
+
+    /* Bits 4 and 5 are mutually exclusive! */
+    if (CHECK_FLAG(mbi->flags, 4) && CHECK_FLAG(mbi->flags, 5)) {
+        printf("Both bits 4 and 5 are set.\n");
+        return;
+    }
+
+    /* the file system image is the first module. */
+    filesys_ptr = NULL;
+    if (CHECK_FLAG(mbi->flags, 3) && mbi->mods_count > 0) {
+        filesys_ptr = (void*)((module_t*)mbi->mods_addr)->mod_start;
+    }
+
+    quiet = boot_flag(mbi, "quiet");
+    if (!quiet) {
+        print_multiboot(mbi);
+    }
+    boot_mark("multiboot");
 
     /* Construct an LDT entry in the GDT */
     {
@@ -147,14 +234,24 @@ void entry(unsigned long magic, unsigned long addr) {
         tss.esp0 = 0x800000;
         ltr(KERNEL_TSS);
     }
+    boot_mark("gdt");
 
 
     /* INIT the IDT. */
     init_idt();
+    boot_mark("idt");
 
     /* Init the PIC */
     i8259_init();
     paging_init();
+    fpu_init();
+    boot_mark("pic+paging");
+
+    // the APICs take over from the 8259 when the machine has them.
+    if (!boot_flag(mbi, "noapic")){
+        apic_init();
+    }
+    boot_mark("apic");
     
 
     /* Initialize devices, memory, filesystem, enable device interrupts on the
@@ -165,30 +262,49 @@ void entry(unsigned long magic, unsigned long addr) {
     /* INIT the RTC. */
     rtc_init();
     key_board_init();
+    boot_mark("devices");
 
 
-    // init fop table.
+    // init fop table, all the operation tables at once.
     init_fop_table();
-    terminal_init();
+    terminal_init(boot_terminals(mbi));
+
+    // frame buffer of the graphics mode.
+    gfx_init();
+    boot_mark("terminals");
+
+    // kernel files for the syscall trace and the interrupt counts.
+    trace_init();
+    irq_init();
 
-    init_File_operations_table();
-    init_Rtc_operations_table();
-    init_Directory_operations_table();
+    // the TSC is measured on PIT channel 2, before channel 0 ticks.
+    clock_init();
+    boot_mark("clock");
 
     // finally init the PIT to reduce time.
     PIT_init();
 
+    // the other processors wait for terminals to run.
+    if (!boot_flag(mbi, "nosmp")){
+        smp_init();
+    }
+    boot_mark("smp");
+
     //-------------------------------------------------------------------------------------------------
-    /* init SB16 */
+    /* init SB16. the card is only touched by the music, after the shell runs. */
     sb16_init();
+    if (!boot_flag(mbi, "nosound")){
+        sb16_play_later("audio.wav", SB16_BOOT_DELAY);
+    }
 
     /* Enable interrupts */
     /* Do not enable the following until after you have set up your
      * IDT correctly otherwise QEMU will triple fault and simple close
      * without showing you any output */
-    printf("Enabling Interrupts\n");
+    if (!quiet){
+        printf("Enabling Interrupts\n");
+    }
     //-------------------------------------------------------------------------------------------------
-    play_music("audio.wav");
     sti();
     
 #ifdef RUN_TESTS
@@ -197,6 +313,11 @@ void entry(unsigned long magic, unsigned long addr) {
 
     
 #endif
+    boot_mark("shell");
+    if (!quiet){
+        printf("Boot took %u us\n", boot_time_us());
+    }
+
     /* Execute the first program ("shell") ... */
     /* launch shell...*/
     execute((uint8_t*)"shell");
@@ -8,20 +8,51 @@
 #include "lib.h"
 #include "tests.h"
 #include "Terminal.h"
+#include "syscall.h"
+#include "softirq.h"
+#include "irq.h"
+
+#define KB_QUEUE_SIZE   64              // scancodes waiting for the tasklet, power of 2.
+#define KB_NR_KEYS      0x80            // make codes. the break code has KB_BREAK set.
+#define KB_BREAK        0x80
+#define KB_KEYPAD_FIRST 0x47            // keypad 7, the keypad goes on to '.' at 0x53.
+#define KB_KEYPAD_COUNT 13
 
 int test;
 void set_buffer(terminal_t* ptr, uint8_t value);
 void handle_function_key(int keycode);
+static void key_board_tasklet(uint32_t data);
+static void key_board_scancode(uint8_t scancode);
+
+// scancodes read by the handler and not handled yet. the handler is the only
+// writer of the head and the tasklet the only writer of the tail, so the ring
+// needs no lock.
+static volatile uint8_t  kb_queue[KB_QUEUE_SIZE];
+static volatile uint32_t kb_head = 0;
+static volatile uint32_t kb_tail = 0;
+static DECLARE_TASKLET(kb_tasklet, key_board_tasklet, 0);
+
+// KB_* modifier bits that are down or locked. only the tasklet changes it.
+static uint8_t kb_mods = 0;
 
-// key board buffer
-char* kb_buffer;
+// char of each key for every combination of shift, caps lock and num lock.
+// 0 for the keys that give no char.
+static uint8_t kb_keymap[KB_NR_MAPS][KB_NR_KEYS];
 
-// SPECIAL KEYs
-volatile int numlock =   0;
-volatile int capslock =  0;
-volatile int shiftlock = 0;
-volatile int ctrl =      0;
-volatile int alt  =      0;
+// modifier bit of each make code.
+static const uint8_t kb_modifier[KB_NR_KEYS] = {
+        [KEY_LEFTSHIFT]  = KB_SHIFT,
+        [KEY_RIGHTSHIFT] = KB_SHIFT,
+        [KEY_LEFTCTRL]   = KB_CTRL,
+        [KEY_LEFTALT]    = KB_ALT,
+        [KEY_CAPSLOCK]   = KB_CAPS,
+        [KEY_NUMLOCK]    = KB_NUM,
+};
+
+// keypad chars with num lock on, from KB_KEYPAD_FIRST. minus and plus give none.
+static const uint8_t keypad_list[KB_KEYPAD_COUNT] = {
+        '7', '8', '9', 0, '4', '5', '6', 0, '1', '2', '3', '0', '.'
+};
 
 // scan code list.
 
@@ -93,149 +124,172 @@ unsigned char scancode_list[58][2] =
             [KEY_SPACE]={ ' ',' ' } ,
         };
 
-// handle special keys here.
+/*
+ *  key_map_init
+ *      DESCRIPTION: build the key maps from scancode_list and keypad_list. shift picks
+ *                   the second char, caps lock flips it for the letters, num lock
+ *                   turns on the keypad.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: kb_keymap is filled.
+ */
+static void key_map_init(){
+    int map, key, shifted;
 
+    memset(kb_keymap, 0, sizeof(kb_keymap));
+    for (map = 0; map < KB_NR_MAPS; map++){
+        for (key = 0; key <= KEY_SPACE; key++){
+            shifted = (map & KB_SHIFT) != 0;
+            if ((key >= KEY_Q && key <= KEY_P) || (key >= KEY_A && key <= KEY_L) ||
+                (key >= KEY_Z && key <= KEY_M)){
+                shifted ^= (map & KB_CAPS) != 0;
+            }
+            kb_keymap[map][key] = scancode_list[key][shifted];
+        }
+        if (map & KB_NUM){
+            for (key = 0; key < KB_KEYPAD_COUNT; key++){
+                kb_keymap[map][KB_KEYPAD_FIRST + key] = keypad_list[key];
+            }
+        }
+    }
+}
 
 /*
  *  key_board_init
- *      DESCRIPTION: Enable the interrupt on keyboard.
+ *      DESCRIPTION: build the key maps and enable the interrupt on keyboard.
  *      INPUT/OUTPUT/RETURN: None.
  *      SIDE EFFECT: the PIC status modified.
  */
 void key_board_init(){
+    key_map_init();
+    request_irq(KB_IRQ, key_board_handler, "keyboard");
     enable_irq(KB_IRQ);
 }
 
+/*
+ *  key_translate
+ *      DESCRIPTION: look up the char of a scancode.
+ *      INPUT:  mods: KB_* modifier bits. ctrl and alt do not change the char.
+ *              scancode: the scancode.
+ *      OUTPUT: None.
+ *      RETURN: the char, 0 for none and for the break codes.
+ *      SIDE EFFECT: None.
+ */
+uint8_t key_translate(uint8_t mods, uint8_t scancode){
+    if (scancode & KB_BREAK){
+        return 0;
+    }
+    return kb_keymap[mods & (KB_NR_MAPS-1)][scancode];
+}
+
 //use by linkage when keyboard interrupt occur
 /*
  *  key_board_handler
- *      DESCRIPTION: do the keyboard handler
+ *      DESCRIPTION: do the keyboard handler. move every byte the controller has into
+ *                   the queue and leave the keys to the tasklet. a scancode that finds
+ *                   the queue full is dropped.
  *      INPUT/OUTPUT/RETURN: None.
- *      SIDE EFFECT: do the key press check
+ *      SIDE EFFECT: kb_tasklet is queued.
  */
 void key_board_handler(){
-    unsigned int scancode = 0;
-    int i;
-    uint8_t     key_trans;
-    uint8_t     numpad;
+    uint8_t scancode;
     // Quit irq to let other interrupt on.
     send_eoi(KB_IRQ);
 
-    // init key buffer.
+    // bytes from the mouse port are left alone.
+    while ((inb(KB_COMMAND) & (KB_STATUS_OBF | KB_STATUS_AUX)) == KB_STATUS_OBF){
+        scancode = inb(KB_DATA);
+        if (kb_head - kb_tail < KB_QUEUE_SIZE){
+            kb_queue[kb_head & (KB_QUEUE_SIZE-1)] = scancode;
+            kb_head++;
+        }
+    }
+    tasklet_schedule(&kb_tasklet);
+}
+
+/*
+ *  key_board_tasklet
+ *      DESCRIPTION: bottom half of the keyboard interrupt. handle the queued scancodes
+ *                   in order, with interrupts on.
+ *      INPUT:  data: unused.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: see key_board_scancode.
+ */
+static void key_board_tasklet(uint32_t data){
+    uint8_t scancode;
+    while (kb_tail != kb_head){
+        scancode = kb_queue[kb_tail & (KB_QUEUE_SIZE-1)];
+        kb_tail++;
+        key_board_scancode(scancode);
+    }
+}
+
+/*
+ *  key_board_scancode
+ *      DESCRIPTION: handle one scancode. the modifiers update kb_mods, the lock keys
+ *                   on press only. the ctrl and shift combinations of the kernel are
+ *                   checked, any other key goes through the key map.
+ *      INPUT: scancode: the scancode read by the handler.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: the key goes to the terminal in the front, or switches the terminal.
+ */
+static void key_board_scancode(uint8_t scancode){
+    uint8_t key = scancode & ~KB_BREAK;
+    uint8_t mod = kb_modifier[key];
+    uint8_t key_trans;
+
+    // keys go to the terminal in the front.
     terminal_t* terminal= term_ptr;
-    kb_buffer = terminal->input_buffer;
-
-    // read scan code
-    while(!inb(KB_DATA));
-    scancode = inb(KB_DATA);
-    // handle F1 to F3.
-    handle_function_key(scancode);
-    // handle special scancode.
-    switch (scancode) {
-        case KEY_CAPSLOCK:
-            capslock = ~capslock;
-            break;
-        case KEY_LEFTSHIFT:
-            if (!shiftlock){
-                shiftlock = 1;
-            }
-            break;
-        case KEY_RIGHTSHIFT:
-            if (!shiftlock){
-                shiftlock = 1;
-            }
-            break;
-        case KEY_LEFTALT:
-            alt = 1;
-            break;
-        case KEY_LEFTCTRL:
-            ctrl = 1;
-            break;
-        case KEY_CTRL_RELEASE:
-            ctrl = 0;
-            break;
-        case KEY_ALT_RELEASE:
-            alt = 0;
-            break;
-        case KEY_LSHIFT_RELEASE:
-            if (shiftlock){
-                shiftlock = 0;
-            }
-            break;
-        case KEY_RSHIFT_RELEASE:
-            if (shiftlock){
-                shiftlock = 0;
-            }
-            break;
-        case KEY_BACKSPACE:
-            if (terminal->isem == 0){                               // empty terminal buffer...
-                break;
-            }
-            if (terminal->isem ==128){
-                putc('\b');
-            }
-            else if (terminal->input_buffer[terminal->isem - 1] == '\t'){
-                putc('\t');
-            } else{
-                putc('\b');
-            }
-            terminal->input_buffer[terminal->isem - 1] = 0;
-            terminal->isem--;
-            break;
-        case KEY_NUMLOCK:
-            numlock = ~numlock;
-            printf("\nNUMLOCK STAT: %d\n", (0-numlock));
-            break;
-        case KEY_TAB:
-            for (i=0;i<4;i++){
-                putc(' ');
-            }
-            set_buffer(terminal, '\t');
-            break;
-        case KEY_ENTER:
-            putc('\n');
-            set_buffer(terminal,'\n');
-            terminal->status = 1;// only the enter is pressed, the status is 1.
-            break;
-        case KEY_L:
-            if (ctrl) {
-                clear();
-                break;
-            }
-        default:
-            // we only add look up table until space.
-            if (scancode > KEY_SPACE){
-                // numpad may be found here.
-                numpad = handle_keypad(scancode);
-                if (numpad){
-                    key_print(numpad);
-                    set_buffer(terminal,numpad);
-                }
-                break;
+
+    if (mod & (KB_CAPS | KB_NUM)){
+        if (!(scancode & KB_BREAK)){
+            kb_mods ^= mod;
+            if (mod == KB_NUM){
+                printf("\nNUMLOCK STAT: %d\n", (kb_mods & KB_NUM) != 0);
             }
-            if ((scancode >= KEY_Q && scancode <= KEY_P)||(scancode >= KEY_A && scancode <= KEY_L) ||
-                    (scancode >= KEY_Z && scancode <= KEY_M)){
-                // handle words use XOR gate.
-                if (!capslock != !shiftlock){                   // since the words should consider differ from the symbols.
-                    key_trans = scancode_list[scancode][1];
-                } else{
-                    key_trans = scancode_list[scancode][0];
-                }
-            } else{
-                // handle symbols.
-                if (shiftlock){
-                    key_trans = scancode_list[scancode][1];
-                } else{
-                    key_trans = scancode_list[scancode][0];
-                }
+        }
+        return;
+    }
+    if (mod){
+        if (scancode & KB_BREAK){
+            kb_mods &= ~mod;
+        } else{
+            kb_mods |= mod;
+        }
+        return;
+    }
+    if (scancode & KB_BREAK){
+        return;
+    }
+
+    // handle F1 to F12.
+    handle_function_key(key);
+    if (kb_mods & KB_CTRL){
+        if (key == KEY_L){
+            clear();
+            return;
+        }
+        // Ctrl-C stops the program in the front. the base shell is left alone.
+        if (key == KEY_C){
+            if (terminal->cur_pid >= 0 && get_pcb(terminal->cur_pid)->parent_pid != -1) {
+                signal_send(terminal->cur_pid, INTERRUPT);
             }
+            return;
+        }
+    }
+    // Shift+PgUp/PgDn pages through the history of the terminal in the front.
+    if ((kb_mods & KB_SHIFT) && (key == KEY_PAGEUP || key == KEY_PAGEDOWN)){
+        terminal_view_scroll(terminal, (key == KEY_PAGEUP) ? SCROLL_PAGE : -SCROLL_PAGE);
+        return;
+    }
 
-            key_print(key_trans);
-            set_buffer(terminal, key_trans);
-            break;
+    key_trans = key_translate(kb_mods, key);
+    if (key_trans == 0){
+        return;
     }
-    moving_cursor(screen_x,screen_y);
-    return;
+    if (test && key >= KB_KEYPAD_FIRST){
+        exception = (int)key_trans;
+    }
+    set_buffer(terminal, key_trans);
 }
 
 
@@ -255,90 +309,24 @@ int key_print(int key_ascii){
 
 /*
  *  set_buffer
- *      DESCRIPTION: set the keyboard buffer with the given value and
- *                   handle overflow in the buffer.
+ *      DESCRIPTION: hand a key to the line discipline of the terminal and wake the
+ *                   readers when it has input for them.
  *      INPUT:      ptr: pointer to the terminal itself.
- *                  value: the char value to be put in the buffer.
+ *                  value: the char value of the key.
  *      OUTPUT:     None.
  *      RETURN:     None.
- *      SIDE EFFECT: None.
+ *      SIDE EFFECT: the key may be echoed.
  */
 void set_buffer(terminal_t* ptr, uint8_t value){
     terminal_t* terminal = ptr;
 
-    if (terminal->isem <(BUFFER_SIZE-1)){
-        terminal->input_buffer[terminal->isem]=value;
-        terminal->isem++;
-    }
-    else{
-        terminal->input_buffer[BUFFER_SIZE-1] = '\n';
-        terminal->isem = BUFFER_SIZE;
+    if (ldisc_input(&terminal->ldisc, value)){
+        terminal->status = 1;
+        wake_up(&terminal->read_wq);
     }
     return;
 }
 
-/*
- *  handle_keypad
- *      DESCRIPTION: TRY to handle keypad and use it to run functions.
- *      INPUT: keycode UNKNOWN scancode.
- *      OUTPUT: None.
- *      RETURN: None.
- *      SIDE EFFECT: modify some global variable related to test.
- */
-uint8_t handle_keypad(int keycode){
-    // trial.
-    uint8_t num;
-    if (numlock){
-        // the num pad is enable.
-        keycode += 22;
-    }else{
-        return 0;
-    }
-
-    switch (keycode) {
-        case KEY_KP0:
-            num = '0';
-            break;
-        case KEY_KP9:
-            num = '9';
-            break;
-        case KEY_KP8:
-            num = '8';
-            break;
-        case KEY_KP7:
-            num = '7';
-            break;
-        case KEY_KP6:
-            num = '6';
-            break;
-        case KEY_KP5:
-            num = '5';
-            break;
-        case KEY_KP4:
-            num = '4';
-            break;
-        case KEY_KP3:
-            num = '3';
-            break;
-        case KEY_KP2:
-            num = '2';
-            break;
-        case KEY_KP1:
-            num = '1';
-            break;
-        case KEY_KPDOT:
-            num = '.';
-            break;
-        default:
-            num = 0;
-            break;
-    }
-    if (test){
-        exception = (int)num;
-    }
-    return num;
-}
-
 /*
  *  handle_function_key
  *      DESCRIPTION: switch terminals when ALT + Fn is pressed. in the GUI we should press ctrl, alt and Fn.
@@ -348,21 +336,14 @@ uint8_t handle_keypad(int keycode){
  *      SIDE EFFECT: the displaying terminal will switch.
  */
 void handle_function_key(int keycode){
-    if (alt == 0){
+    if (!(kb_mods & KB_ALT)){
         return;
     }
-    switch (keycode) {
-        case KEY_F1:
-            terminal_switch(0);
-            break;
-        case KEY_F2:
-            terminal_switch(1);
-            break;
-        case KEY_F3:
-            terminal_switch(2);
-            break;
-        default:
-            break;
+    // terminal_switch skips the terminals that were not set up at boot.
+    if (keycode >= KEY_F1 && keycode <= KEY_F10){
+        terminal_switch(keycode - KEY_F1);
+    } else if (keycode == KEY_F11 || keycode == KEY_F12){
+        terminal_switch(10 + keycode - KEY_F11);
     }
     return;
 }
@@ -20,6 +20,18 @@
 #define KB_COMMAND              0x64
 #define KB_DATA                 0x60
 
+// status bits read from KB_COMMAND.
+#define KB_STATUS_OBF           0x01        // a byte waits in KB_DATA.
+#define KB_STATUS_AUX           0x20        // the byte is from the mouse.
+
+// modifier state. shift, caps and num lock pick one of the KB_NR_MAPS key maps.
+#define KB_SHIFT                0x01
+#define KB_CAPS                 0x02
+#define KB_NUM                  0x04
+#define KB_CTRL                 0x08
+#define KB_ALT                  0x10
+#define KB_NR_MAPS              8
+
 // KEY RELEASE SCANCODE.
 #define KEY_LSHIFT_RELEASE          0xAA
 #define KEY_RSHIFT_RELEASE          0xB6
@@ -27,6 +39,14 @@
 #define KEY_CAPSLOCK_RELEASE        0xBA
 #define KEY_CTRL_RELEASE            0x9D
 
+// PAGE KEYS SCANCODE. same as keypad 9 and 3.
+#define KEY_PAGEUP                  0x49
+#define KEY_PAGEDOWN                0x51
+
+// F11 and F12 are not next to F1-F10.
+#define KEY_F11                     0x57
+#define KEY_F12                     0x58
+
 
 extern int test;
 
@@ -39,8 +59,8 @@ void key_board_handler();
 /* read data from the key board buffer. */
 int key_print(int key_ascii);
 
-/* helper function to handle keypad. */
- uint8_t handle_keypad(int keycode);
+/* char of a scancode under the KB_* modifiers, 0 for none. */
+uint8_t key_translate(uint8_t mods, uint8_t scancode);
 
 /*
  *  Key Board Scancode
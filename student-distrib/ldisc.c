@@ -0,0 +1,167 @@
+//
+// ldisc.c - line discipline between the keyboard and terminal_read.
+//
+
+#include "ldisc.h"
+#include "lib.h"
+
+#define SUCCESS 0
+#define FAILURE -1
+
+#define TAB_WIDTH   4                   // a tab is echoed as spaces.
+
+/*
+ *  ldisc_init
+ *      DESCRIPTION: empty the discipline and set it to cooked mode.
+ *      INPUT:  ld: the line discipline.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void ldisc_init(ldisc_t* ld){
+    ldisc_flush(ld);
+    ld->mode = LDISC_COOKED;
+}
+
+/*
+ *  ldisc_flush
+ *      DESCRIPTION: drop the input in the ring and the line being edited.
+ *      INPUT:  ld: the line discipline.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void ldisc_flush(ldisc_t* ld){
+    uint32_t flags;
+    cli_and_save(flags);
+    ld->head = 0;
+    ld->tail = 0;
+    ld->line_len = 0;
+    restore_flags(flags);
+}
+
+/*
+ *  ldisc_set_mode
+ *      DESCRIPTION: switch between cooked and raw mode.
+ *      INPUT:  ld: the line discipline.
+ *              mode: LDISC_COOKED or LDISC_RAW.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS, FAILURE for unknown mode.
+ *      SIDE EFFECT: the line being edited is dropped.
+ */
+int32_t ldisc_set_mode(ldisc_t* ld, int32_t mode){
+    if (mode != LDISC_COOKED && mode != LDISC_RAW){
+        return FAILURE;
+    }
+    ld->line_len = 0;
+    ld->mode = mode;
+    return SUCCESS;
+}
+
+/*
+ *  ldisc_put
+ *      DESCRIPTION: put bytes into the ring. nothing is put when they do not all fit,
+ *                   so a line is never cut.
+ *      INPUT:  ld: the line discipline.
+ *              buf, n: the bytes.
+ *      OUTPUT: None.
+ *      RETURN: 1 for put, 0 for dropped.
+ *      SIDE EFFECT: None.
+ */
+static int32_t ldisc_put(ldisc_t* ld, const uint8_t* buf, int32_t n){
+    int32_t i;
+    if (ld->head - ld->tail + n > LDISC_RING_SIZE){
+        return 0;
+    }
+    for (i = 0; i < n; i++){
+        ld->ring[(ld->head + i) & (LDISC_RING_SIZE-1)] = buf[i];
+    }
+    ld->head += n;
+    return 1;
+}
+
+/*
+ *  ldisc_input
+ *      DESCRIPTION: handle one key. raw mode puts it in the ring. cooked mode echoes it
+ *                   and edits the line: '\b' removes the last char, '\t' shows as spaces,
+ *                   '\n' sends the line to the ring. a full line takes only '\n'.
+ *      INPUT:  ld: the line discipline of the displayed terminal.
+ *              c: the char of the key.
+ *      OUTPUT: None.
+ *      RETURN: 1 when new input is in the ring, 0 otherwise.
+ *      SIDE EFFECT: the echo goes to the displayed terminal.
+ */
+int32_t ldisc_input(ldisc_t* ld, uint8_t c){
+    int i;
+
+    if (ld->mode == LDISC_RAW){
+        return ldisc_put(ld, &c, 1);
+    }
+
+    switch (c){
+        case '\b':
+            if (ld->line_len == 0){                         // nothing to delete.
+                return 0;
+            }
+            // a tab is deleted with '\t', which moves back over the spaces.
+            putc((ld->line[ld->line_len - 1] == '\t') ? '\t' : '\b');
+            ld->line_len--;
+            return 0;
+        case '\n':
+            putc('\n');
+            ld->line[ld->line_len++] = '\n';
+            i = ldisc_put(ld, ld->line, ld->line_len);
+            ld->line_len = 0;
+            return i;
+        default:
+            // keep room for the '\n'.
+            if (ld->line_len >= LDISC_LINE_MAX - 1){
+                return 0;
+            }
+            if (c == '\t'){
+                for (i = 0; i < TAB_WIDTH; i++){
+                    putc(' ');
+                }
+            } else{
+                putc(c);
+            }
+            ld->line[ld->line_len++] = c;
+            return 0;
+    }
+}
+
+/*
+ *  ldisc_ready
+ *      DESCRIPTION: check if the ring has input for read.
+ *      INPUT:  ld: the line discipline.
+ *      OUTPUT: None.
+ *      RETURN: 1 for ready, 0 for empty.
+ *      SIDE EFFECT: None.
+ */
+int32_t ldisc_ready(ldisc_t* ld){
+    return ld->head != ld->tail;
+}
+
+/*
+ *  ldisc_read
+ *      DESCRIPTION: take input from the ring. in cooked mode the read stops after the '\n',
+ *                   so one line is returned at most.
+ *      INPUT:  ld: the line discipline.
+ *              buf: kernel buffer.
+ *              nbytes: size of buf.
+ *      OUTPUT: the input in buf.
+ *      RETURN: number of bytes taken.
+ *      SIDE EFFECT: None.
+ */
+int32_t ldisc_read(ldisc_t* ld, uint8_t* buf, int32_t nbytes){
+    int32_t n = 0;
+    uint8_t c;
+
+    while (n < nbytes && ld->tail != ld->head){
+        c = ld->ring[ld->tail & (LDISC_RING_SIZE-1)];
+        ld->tail++;
+        buf[n++] = c;
+        if (c == '\n' && ld->mode == LDISC_COOKED){
+            break;
+        }
+    }
+    return n;
+}
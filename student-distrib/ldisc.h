@@ -0,0 +1,48 @@
+//
+// ldisc.h - line discipline between the keyboard and terminal_read.
+//
+// In cooked mode the keys are echoed and edited in a line buffer, and only
+// a finished line (ending with '\n') goes to the input ring. In raw mode
+// every key goes to the ring at once without echo, for programs that react
+// to single keys.
+//
+
+#ifndef MP3_LDISC_H
+#define MP3_LDISC_H
+
+#include "types.h"
+
+#define LDISC_RING_SIZE     1024        // bytes waiting for read, power of 2.
+#define LDISC_LINE_MAX      128         // longest line in cooked mode, with the '\n'.
+
+#define LDISC_COOKED        0
+#define LDISC_RAW           1
+
+typedef struct ldisc{
+    uint8_t  ring[LDISC_RING_SIZE];     // input ready for read.
+    volatile uint32_t head;             // bytes put by the keyboard. slot is head % size.
+    volatile uint32_t tail;             // bytes taken by read.
+    uint8_t  line[LDISC_LINE_MAX];      // line being edited in cooked mode.
+    int32_t  line_len;
+    int32_t  mode;                      // LDISC_COOKED or LDISC_RAW.
+}ldisc_t;
+
+/* empty the discipline, cooked mode. */
+void ldisc_init(ldisc_t* ld);
+
+/* drop the pending input but keep the mode. */
+void ldisc_flush(ldisc_t* ld);
+
+/* change the mode. the line being edited is dropped. */
+int32_t ldisc_set_mode(ldisc_t* ld, int32_t mode);
+
+/* handle one key from the keyboard. returns 1 when read can go on. */
+int32_t ldisc_input(ldisc_t* ld, uint8_t c);
+
+/* check if read would return data. */
+int32_t ldisc_ready(ldisc_t* ld);
+
+/* take the input for read, a line at most in cooked mode. */
+int32_t ldisc_read(ldisc_t* ld, uint8_t* buf, int32_t nbytes);
+
+#endif //MP3_LDISC_H
@@ -7,151 +7,321 @@
 #define VIDEO       0xB8000
 #define NUM_COLS    80
 #define NUM_ROWS    25
-#define ATTRIB      0x7
 
-int screen_x;
-int screen_y;
-static char* video_mem = (char *)VIDEO;
+/*
+ *  console
+ *      DESCRIPTION: the terminal that kernel output goes to. terminal 0 before the
+ *                   terminals are set up, so the boot messages have a place.
+ *      INPUT: term: the wanted terminal, may be NULL.
+ *      OUTPUT: None.
+ *      RETURN: the terminal to use.
+ *      SIDE EFFECT: None.
+ */
+static terminal_t* console(volatile terminal_t* term){
+    if (term == NULL){
+        return terminal_console();
+    }
+    return (terminal_t*)term;
+}
 
 /* void clear(void);
  * Inputs: void
  * Return Value: none
- * Function: Clears video memory */
+ * Function: Clears the displayed terminal */
 void clear(void) {
+    terminal_t* term = console(term_ptr);
+    terminal_clear(term);
+    terminal_flush(term);
+}
+
+// output of the formatting engine.
+typedef struct fmt_out{
+    int8_t* buf;
+    int32_t len;                    // bytes in buf.
+    int32_t size;                   // capacity of buf.
+    int32_t total;                  // bytes produced, also the ones cut.
+    int32_t to_term;                // 1: a full buf goes to the terminal. 0: the rest is cut.
+}fmt_out_t;
+
+// the conversion being formatted.
+typedef struct fmt_spec{
+    int32_t left;                   // '-': pad on the right.
+    int32_t zero;                   // '0': pad numbers with zeros.
+    int32_t plus;                   // '+': sign for positive numbers.
+    int32_t space;                  // ' ': space for positive numbers.
+    int32_t alternate;              // '#'.
+    int32_t width;                  // minimal width, 0 for none.
+    int32_t precision;              // min digits, or max chars of a string. -1 for none.
+}fmt_spec_t;
+
+/*
+ *  fmt_putc
+ *      DESCRIPTION: append one char to the output. a full printf buffer is written
+ *                   to the terminal in one piece.
+ *      INPUT: out: the output.
+ *             c: the char.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: may write to the terminal.
+ */
+static void fmt_putc(fmt_out_t* out, int8_t c){
+    if (out->len >= out->size){
+        if (!out->to_term){
+            out->total++;
+            return;
+        }
+        terminal_putn((uint8_t*)out->buf, out->len);
+        out->len = 0;
+    }
+    out->buf[out->len++] = c;
+    out->total++;
+}
+
+/*
+ *  fmt_pad
+ *      DESCRIPTION: append n copies of a char.
+ */
+static void fmt_pad(fmt_out_t* out, int8_t c, int32_t n){
+    for (; n > 0; n--){
+        fmt_putc(out, c);
+    }
+}
+
+/*
+ *  fmt_string
+ *      DESCRIPTION: append a string, cut at the precision and padded to the width.
+ *      INPUT: out: the output.
+ *             spec: the conversion.
+ *             str: the string, "(null)" for NULL.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+static void fmt_string(fmt_out_t* out, const fmt_spec_t* spec, const int8_t* str){
+    int32_t len = 0;
     int32_t i;
-    for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
-        *(uint8_t *)(video_mem + (i << 1)) = ' ';
-        *(uint8_t *)(video_mem + (i << 1) + 1) = ATTRIB;
+
+    if (str == NULL){
+        str = "(null)";
+    }
+    while (str[len] != '\0' && (spec->precision < 0 || len < spec->precision)){
+        len++;
+    }
+    if (!spec->left){
+        fmt_pad(out, ' ', spec->width - len);
+    }
+    for (i = 0; i < len; i++){
+        fmt_putc(out, str[i]);
+    }
+    if (spec->left){
+        fmt_pad(out, ' ', spec->width - len);
     }
-    screen_x = 0;
-    screen_y = 0;
-    moving_cursor(screen_x,screen_y);
 }
 
-/* Standard printf().
- * Only supports the following format strings:
- * %%  - print a literal '%' character
- * %x  - print a number in hexadecimal
- * %u  - print a number as an unsigned integer
- * %d  - print a number as a signed integer
- * %c  - print a character
- * %s  - print a string
- * %#x - print a number in 32-bit aligned hexadecimal, i.e.
- *       print 8 hexadecimal digits, zero-padded on the left.
- *       For example, the hex number "E" would be printed as
- *       "0000000E".
- *       Note: This is slightly different than the libc specification
- *       for the "#" modifier (this implementation doesn't add a "0x" at
- *       the beginning), but I think it's more flexible this way.
- *       Also note: %x is the only conversion specifier that can use
- *       the "#" modifier to alter output. */
-int32_t printf(int8_t *format, ...) {
-
-    /* Pointer to the format string */
-    int8_t* buf = format;
+/*
+ *  fmt_number
+ *      DESCRIPTION: append a number with its sign, zeros for the precision and padding
+ *                   for the width.
+ *      INPUT: out: the output.
+ *             spec: the conversion.
+ *             value: the magnitude.
+ *             negative: 1 for a '-' sign.
+ *             radix: 8, 10 or 16. hex digits are upper case, as itoa gives them.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+static void fmt_number(fmt_out_t* out, const fmt_spec_t* spec, uint32_t value, int32_t negative, int32_t radix){
+    static const int8_t digits[] = "0123456789ABCDEF";
+    int8_t conv_buf[12];            // 32 bits in octal at most.
+    int32_t ndigits = 0;
+    int32_t zeros, pad;
+    int8_t sign = 0;
+
+    // digits, lowest first. precision 0 prints nothing for 0.
+    while (value != 0 || (ndigits == 0 && spec->precision != 0)){
+        conv_buf[ndigits++] = digits[value % radix];
+        value /= radix;
+    }
+    if (negative){
+        sign = '-';
+    } else if (spec->plus){
+        sign = '+';
+    } else if (spec->space){
+        sign = ' ';
+    }
 
-    /* Stack pointer for the other parameters */
-    int32_t* esp = (void *)&format;
-    esp++;
+    zeros = (spec->precision > ndigits) ? spec->precision - ndigits : 0;
+    pad = spec->width - ndigits - zeros - (sign != 0);
+    if (spec->zero && !spec->left && spec->precision < 0 && pad > 0){
+        zeros += pad;
+        pad = 0;
+    }
 
-    while (*buf != '\0') {
-        switch (*buf) {
-            case '%':
-                {
-                    int32_t alternate = 0;
-                    buf++;
-
-format_char_switch:
-                    /* Conversion specifiers */
-                    switch (*buf) {
-                        /* Print a literal '%' character */
-                        case '%':
-                            terminal_putc('%');
-                            break;
-
-                        /* Use alternate formatting */
-                        case '#':
-                            alternate = 1;
-                            buf++;
-                            /* Yes, I know gotos are bad.  This is the
-                             * most elegant and general way to do this,
-                             * IMHO. */
-                            goto format_char_switch;
-
-                        /* Print a number in hexadecimal form */
-                        case 'x':
-                            {
-                                int8_t conv_buf[64];
-                                if (alternate == 0) {
-                                    itoa(*((uint32_t *)esp), conv_buf, 16);
-                                    puts(conv_buf);
-                                } else {
-                                    int32_t starting_index;
-                                    int32_t i;
-                                    itoa(*((uint32_t *)esp), &conv_buf[8], 16);
-                                    i = starting_index = strlen(&conv_buf[8]);
-                                    while(i < 8) {
-                                        conv_buf[i] = '0';
-                                        i++;
-                                    }
-                                    puts(&conv_buf[starting_index]);
-                                }
-                                esp++;
-                            }
-                            break;
-
-                        /* Print a number in unsigned int form */
-                        case 'u':
-                            {
-                                int8_t conv_buf[36];
-                                itoa(*((uint32_t *)esp), conv_buf, 10);
-                                puts(conv_buf);
-                                esp++;
-                            }
-                            break;
-
-                        /* Print a number in signed int form */
-                        case 'd':
-                            {
-                                int8_t conv_buf[36];
-                                int32_t value = *((int32_t *)esp);
-                                if(value < 0) {
-                                    conv_buf[0] = '-';
-                                    itoa(-value, &conv_buf[1], 10);
-                                } else {
-                                    itoa(value, conv_buf, 10);
-                                }
-                                puts(conv_buf);
-                                esp++;
-                            }
-                            break;
-
-                        /* Print a single character */
-                        case 'c':
-                            terminal_putc((uint8_t) *((int32_t *)esp));
-                            esp++;
-                            break;
-
-                        /* Print a NULL-terminated string */
-                        case 's':
-                            puts(*((int8_t **)esp));
-                            esp++;
-                            break;
-
-                        default:
-                            break;
-                    }
+    if (!spec->left){
+        fmt_pad(out, ' ', pad);
+    }
+    if (sign){
+        fmt_putc(out, sign);
+    }
+    fmt_pad(out, '0', zeros);
+    while (ndigits > 0){
+        fmt_putc(out, conv_buf[--ndigits]);
+    }
+    if (spec->left){
+        fmt_pad(out, ' ', pad);
+    }
+}
 
+/*
+ *  format
+ *      DESCRIPTION: the formatting engine behind printf and snprintf. supports
+ *                   %[flags][width][.precision]conversion with the flags "-0+ #",
+ *                   '*' for the width or the precision, and the conversions
+ *                   d i u x X o c s p %. "%#x" alone still gives 8 hex digits
+ *                   without "0x", as the old printf did.
+ *      INPUT: out: the output.
+ *             fmt: the format string.
+ *             esp: the first argument on the stack.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+static void format(fmt_out_t* out, const int8_t* fmt, int32_t* esp){
+    fmt_spec_t spec;
+    int32_t value;
+
+    for (; *fmt != '\0'; fmt++){
+        if (*fmt != '%'){
+            fmt_putc(out, *fmt);
+            continue;
+        }
+        fmt++;
+
+        memset(&spec, 0, sizeof(spec));
+        spec.precision = -1;
+        for (;; fmt++){
+            if (*fmt == '-')        spec.left = 1;
+            else if (*fmt == '0')   spec.zero = 1;
+            else if (*fmt == '+')   spec.plus = 1;
+            else if (*fmt == ' ')   spec.space = 1;
+            else if (*fmt == '#')   spec.alternate = 1;
+            else break;
+        }
+        if (*fmt == '*'){
+            spec.width = *esp++;
+            if (spec.width < 0){
+                spec.left = 1;
+                spec.width = -spec.width;
+            }
+            fmt++;
+        }
+        for (; *fmt >= '0' && *fmt <= '9'; fmt++){
+            spec.width = spec.width * 10 + (*fmt - '0');
+        }
+        if (*fmt == '.'){
+            fmt++;
+            spec.precision = 0;
+            if (*fmt == '*'){
+                spec.precision = *esp++;
+                fmt++;
+            }
+            for (; *fmt >= '0' && *fmt <= '9'; fmt++){
+                spec.precision = spec.precision * 10 + (*fmt - '0');
+            }
+        }
+
+        switch (*fmt){
+            case '%':
+                fmt_putc(out, '%');
+                break;
+            case 'd':
+            case 'i':
+                value = *esp++;
+                fmt_number(out, &spec, (value < 0) ? -(uint32_t)value : (uint32_t)value, value < 0, 10);
+                break;
+            case 'u':
+                fmt_number(out, &spec, *(uint32_t*)esp++, 0, 10);
+                break;
+            case 'o':
+                fmt_number(out, &spec, *(uint32_t*)esp++, 0, 8);
+                break;
+            case 'x':
+            case 'X':
+                // "%#x" is the 32-bit aligned hex of the old printf.
+                if (spec.alternate && spec.width == 0 && spec.precision < 0){
+                    spec.precision = 8;
                 }
+                fmt_number(out, &spec, *(uint32_t*)esp++, 0, 16);
                 break;
-
+            case 'p':
+                spec.precision = 8;
+                fmt_putc(out, '0');
+                fmt_putc(out, 'x');
+                fmt_number(out, &spec, *(uint32_t*)esp++, 0, 16);
+                break;
+            case 'c':
+                if (!spec.left){
+                    fmt_pad(out, ' ', spec.width - 1);
+                }
+                fmt_putc(out, (int8_t)*esp++);
+                if (spec.left){
+                    fmt_pad(out, ' ', spec.width - 1);
+                }
+                break;
+            case 's':
+                fmt_string(out, &spec, *(int8_t**)esp++);
+                break;
+            case '\0':
+                // a '%' at the end, nothing to print.
+                return;
             default:
-                terminal_putc(*buf);
                 break;
         }
-        buf++;
     }
-    return (buf - format);
+}
+
+/* Standard printf().
+ * Formats into a buffer on the stack and writes it to the terminal of the
+ * running process in one piece, see format() for the conversions.
+ * Return Value: number of chars printed */
+int32_t printf(int8_t *format_str, ...) {
+    int8_t text[PRINTF_BUF_SIZE];
+    fmt_out_t out;
+
+    out.buf = text;
+    out.len = 0;
+    out.size = PRINTF_BUF_SIZE;
+    out.total = 0;
+    out.to_term = 1;
+    /* Stack pointer for the other parameters */
+    format(&out, format_str, (int32_t*)&format_str + 1);
+
+    terminal_putn((uint8_t*)text, out.len);
+    terminal_flush(console(handle_term));
+    return out.total;
+}
+
+/*
+ *  snprintf
+ *      DESCRIPTION: printf into a string. the output is cut to size-1 chars and ends with '\0'.
+ *      INPUT: buf: the string.
+ *             size: capacity of buf.
+ *             format_str: the format, as printf.
+ *      OUTPUT: buf is filled.
+ *      RETURN: the length the whole output would have.
+ *      SIDE EFFECT: None.
+ */
+int32_t snprintf(int8_t* buf, int32_t size, int8_t* format_str, ...){
+    fmt_out_t out;
+
+    out.buf = buf;
+    out.len = 0;
+    out.size = (size > 0) ? size - 1 : 0;
+    out.total = 0;
+    out.to_term = 0;
+    format(&out, format_str, (int32_t*)&format_str + 1);
+    if (size > 0){
+        buf[out.len] = '\0';
+    }
+    return out.total;
 }
 
 /* int32_t puts(int8_t* s);
@@ -159,150 +329,147 @@ format_char_switch:
  *   Return Value: Number of bytes written
  *    Function: Output a string to the console */
 int32_t puts(int8_t* s) {
-    register int32_t index = 0;
-    while (s[index] != '\0') {
-        terminal_putc(s[index]);
-        index++;
-    }
-    return index;
+    int32_t len = strlen(s);
+    terminal_putn((uint8_t*)s, len);
+    terminal_flush(console(handle_term));
+    return len;
 }
 
-/* void putc(uint8_t c);
- * Inputs: uint_8* c = character to print
- * Return Value: void
- *  Function: Output a character to the console */
-void putc(uint8_t c) {
-    int i;                                                      // iterator for
-    // add function to handle key backspace and tab,
-    if (c == '\b'){
-
-        // move the cursor.
-        if (screen_x == 0){                                     // at the beginning of a line.
-            if (screen_y == 0){                                 // at the beginning of terminal. return.
-                return;
+/*
+ *  render
+ *      DESCRIPTION: put the chars into the text of a terminal. runs of printable chars are
+ *                   written cell by cell without any check, control chars are handled
+ *                   between the runs and escape sequences go to the parser of the terminal.
+ *                   the lines written are marked dirty, the video memory is left to
+ *                   terminal_flush.
+ *      INPUT: term: the terminal.
+ *             buf, n: the chars.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: Clobber the text of the terminal.
+ */
+static void render(terminal_t* term, const uint8_t* buf, int32_t n){
+    uint16_t* cell;
+    uint16_t attrib = term->attrib << 8;
+    int32_t i = 0;
+    int32_t run;
+    uint8_t c;
+
+    while (i < n){
+        c = buf[i];
+        if (c == ANSI_ESC_CHAR || term->esc.state != ANSI_GROUND){
+            i++;
+            switch (ansi_feed(&term->esc, c)){
+                case ANSI_DONE:
+                    terminal_escape(term);
+                    attrib = term->attrib << 8;
+                    continue;
+                case ANSI_MORE:
+                    continue;
             }
-            screen_y--;                                         // move the column above.
-            screen_x = NUM_COLS;                                // this is because the enter have another use.
+            // a control char cut the sequence, it is handled below.
+            i--;
         }
-        screen_x --;
-        // normal deletion.
-        *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1)) = ' ';
-        *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1) + 1) = ATTRIB;
-    }
-
-    // handle tab deletion.
-    else if (c == '\t'){
-
-        // move the cursor forward.
-        screen_x -= 4;                                          // since tabs are spaces, we do not need to modify Video memory.
-        if (screen_x < 0){                                      // check for line change.
-            screen_x += NUM_COLS;
-            screen_y --;
+        if (c >= ' ' && c != 0x7F){
+            // the run ends at a control char or at the end of the row.
+            run = 0;
+            cell = TERM_ROW(term, term->cursor_y) + term->cursor_x;
+            while (i < n && term->cursor_x + run < NUM_COLS && buf[i] >= ' ' && buf[i] != 0x7F){
+                cell[run++] = attrib | buf[i++];
+            }
+            term->dirty_rows |= 1 << term->cursor_y;
+            term->cursor_x += run;
+            if (term->cursor_x >= NUM_COLS){
+                term->cursor_x = 0;
+                terminal_line_feed(term);
+            }
+        } else{
+            i++;
+            // add function to handle key backspace and tab,
+            if (c == '\b'){
+                // move the cursor.
+                if (term->cursor_x == 0){                       // at the beginning of a line.
+                    if (term->cursor_y == 0){                   // at the beginning of terminal. skip.
+                        continue;
+                    }
+                    term->cursor_y--;                           // move the column above.
+                    term->cursor_x = NUM_COLS;                  // this is because the enter have another use.
+                }
+                term->cursor_x--;
+                // normal deletion.
+                TERM_ROW(term, term->cursor_y)[term->cursor_x] = attrib | ' ';
+                term->dirty_rows |= 1 << term->cursor_y;
+            } else if (c == '\t'){
+                // handle tab deletion. since tabs are spaces, we do not need to modify Video memory.
+                term->cursor_x -= 4;
+                if (term->cursor_x < 0){                        // check for line change.
+                    term->cursor_x += NUM_COLS;
+                    term->cursor_y--;
+                }
+                if (term->cursor_y < 0){                        // no line above the first one.
+                    term->cursor_x = 0;
+                    term->cursor_y = 0;
+                }
+            } else if (c == '\n' || c == '\r'){
+                // line rolling happens at the bottom of the scroll region.
+                term->cursor_x = 0;
+                terminal_line_feed(term);
+            } else if (c == '\0'){
+                continue;
+            } else{
+                TERM_ROW(term, term->cursor_y)[term->cursor_x] = attrib | c;
+                term->dirty_rows |= 1 << term->cursor_y;
+                if (++term->cursor_x >= NUM_COLS){
+                    term->cursor_x = 0;
+                    terminal_line_feed(term);
+                }
+            }
         }
     }
+}
 
-    else if(c == '\n' || c == '\r') {
-        screen_y++;
-        screen_x = 0;
-    }
-
-    else {
-        *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1)) = c;
-        *(uint8_t *)(video_mem + ((NUM_COLS * screen_y + screen_x) << 1) + 1) = ATTRIB;
-        screen_x++;
-        if (screen_x >= NUM_COLS) {
-            screen_x %= NUM_COLS;
-            screen_y ++;
-        }
-    }
-    // handle line rolling.
-    if (screen_y >= NUM_ROWS){
-        for (i=0;i<(NUM_ROWS-1)*NUM_COLS;i++){                  // Move row 1 to row 24 above.
-            *(int8_t*)(video_mem+(i<<1)) = *(int8_t*)(video_mem+ ( (i+NUM_COLS)<<1) );
-        }
-        for (;i<NUM_COLS*NUM_ROWS;i++){                         // clear row 25.
-            *(int8_t*)(video_mem+(i<<1)) = ' ';
-            *(int8_t*)(video_mem+(i<<1)+1) = ATTRIB;
-        }
-        screen_y = NUM_ROWS-1;
-    }
-    moving_cursor(screen_x,screen_y);
+/* void putc(uint8_t c);
+ * Inputs: uint_8* c = character to print
+ * Return Value: void
+ *  Function: Output a character to the displayed terminal */
+void putc(uint8_t c) {
+    terminal_t* term = console(term_ptr);
+    // typing brings the live screen back.
+    terminal_view_scroll(term, -(int)term->history->view);
+    render(term, &c, 1);
+    terminal_flush(term);
 }
 
 
 /*
  *  terminal_putc
- *      DESCRIPTION: modify version of putc. puts the chars into the current terminal buffer or call the real putc.
+ *      DESCRIPTION: modify version of putc. puts the chars into the terminal of the running process.
  *      INPUT: unit_8 c: the input char. use global variable to check running terminal.
  *      OUTPUT: None.
  *      RETURN: None.
  *      SIDE EFFECT: Clobber the terminal video buffer.
  */
 void terminal_putc(uint8_t c){
-    if (handle_term->terminalID == cur_terminal_id){
-        // simply print it out to the screen.
-        putc(c);
-    } else{
-        // the "video memory" was the buffer. Since directly mapping video memory may cause some visual problem....
-        int i;                                                      // iterator for
-
-
-        // add function to handle key backspace and tab,
-        if (c == '\b'){
-
-            // move the cursor.
-            if (handle_term->cursor_x == 0){                                     // at the beginning of a line.
-                if (handle_term->cursor_y == 0){                                 // at the beginning of terminal. return.
-                    return;
-                }
-                handle_term->cursor_y--;                                         // move the column above.
-                handle_term->cursor_x = NUM_COLS;                                // this is because the enter have another use.
-            }
-            handle_term->cursor_x --;
-            // normal deletion. (edit the content in the handled terminal's buffer)
-            *(uint8_t *)(handle_term->video_ptr + ((NUM_COLS * handle_term->cursor_y + handle_term->cursor_x) << 1)) = ' ';
-            *(uint8_t *)(handle_term->video_ptr + ((NUM_COLS * handle_term->cursor_y + handle_term->cursor_x) << 1) + 1) = ATTRIB;
-        }  
-
-            // handle tab deletion.
-        else if (c == '\t'){
-
-            // move the cursor forward.
-            handle_term->cursor_x -= 4;                                          // since tabs are spaces, we do not need to modify Video memory.
-            if (handle_term->cursor_x < 0){                                      // check for line change.
-                handle_term->cursor_x += NUM_COLS;
-                handle_term->cursor_y --;
-            }
-        }
+    terminal_t* term = console(handle_term);
+    render(term, &c, 1);
+    terminal_flush(term);
+}
 
-        else if(c == '\n' || c == '\r') {
-            handle_term->cursor_y++;
-            handle_term->cursor_x = 0;
-        }
-        else if (c == '\0'){
-            return;
-        }
-        else {
-            *(uint8_t *)(handle_term->video_ptr + ((NUM_COLS * handle_term->cursor_y + handle_term->cursor_x) << 1)) = c;
-            *(uint8_t *)(handle_term->video_ptr + ((NUM_COLS * handle_term->cursor_y + handle_term->cursor_x) << 1) + 1) = ATTRIB;
-            handle_term->cursor_x++;
-            if (handle_term->cursor_x >= NUM_COLS) {
-                handle_term->cursor_x %= NUM_COLS;
-                handle_term->cursor_y ++;
-            }
-        }
-        // handle line rolling.
-        if (handle_term->cursor_y >= NUM_ROWS){
-            for (i=0;i<(NUM_ROWS-1)*NUM_COLS;i++){                  // Move row 1 to row 24 above.
-                *(int8_t*)(handle_term->video_ptr+(i<<1)) = *(int8_t*)(handle_term->video_ptr + ( (i+NUM_COLS)<<1) );
-            }
-            for (;i<NUM_COLS*NUM_ROWS;i++){                         // clear row 25.
-                *(int8_t*)(handle_term->video_ptr+(i<<1)) = ' ';
-                *(int8_t*)(handle_term->video_ptr+(i<<1)+1) = ATTRIB;
-            }
-            handle_term->cursor_y = NUM_ROWS-1;
-        }
+/*
+ *  terminal_putn
+ *      DESCRIPTION: put n chars into the text of the handled terminal. the screen is
+ *                   left to terminal_flush, so a whole write is copied out once.
+ *      INPUT: buf: the chars, must be in kernel memory.
+ *             n: number of chars.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: Clobber the text of the terminal.
+ */
+void terminal_putn(const uint8_t* buf, int32_t n){
+    if (n <= 0){
+        return;
     }
+    render(console(handle_term), buf, n);
 }
 
 /* int8_t* itoa(uint32_t value, int8_t* buf, int32_t radix);
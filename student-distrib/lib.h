@@ -7,12 +7,13 @@
 
 #include "types.h"
 
-extern int screen_x;
-extern int screen_y;
+#define PRINTF_BUF_SIZE 256             // printf writes to the terminal in pieces of this size.
 
 int32_t printf(int8_t *format, ...);
+int32_t snprintf(int8_t* buf, int32_t size, int8_t* format, ...);
 void putc(uint8_t c);
 void terminal_putc(uint8_t c);
+void terminal_putn(const uint8_t* buf, int32_t n);
 int32_t puts(int8_t *s);
 int8_t *itoa(uint32_t value, int8_t* buf, int32_t radix);
 int8_t *strrev(int8_t* s);
@@ -77,6 +78,32 @@ static inline uint32_t inl(port) {
     return val;
 }
 
+/* Reads the time stamp counter */
+static inline uint64_t rdtsc(void) {
+    uint32_t low, high;
+    asm volatile ("rdtsc"
+            : "=a"(low), "=d"(high)
+    );
+    return ((uint64_t)high << 32) | low;
+}
+
+/* Divides the 64-bit value at "n" in place by "base" and returns the
+ * remainder.  libgcc is not linked in, so 64-bit "/" and "%" can not
+ * be used in the kernel. */
+static inline uint32_t do_div64(uint64_t* n, uint32_t base) {
+    uint32_t high = (uint32_t)(*n >> 32);
+    uint32_t low = (uint32_t)*n;
+    uint32_t high_quot = high / base;
+    uint32_t rem;
+    high %= base;
+    asm ("divl %4"
+            : "=a"(low), "=d"(rem)
+            : "0"(low), "1"(high), "rm"(base)
+    );
+    *n = ((uint64_t)high_quot << 32) | low;
+    return rem;
+}
+
 /* Writes a byte to a port */
 #define outb(data, port)                \
 do {                                    \
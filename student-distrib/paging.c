@@ -1,4 +1,8 @@
 #include "paging.h"
+#include "lib.h"
+
+// 1 for each pool page in use.
+static uint8_t page_used[PAGE_POOL_PAGES];
 
 
 /* paging_init
@@ -144,3 +148,79 @@ void set_vm_page(int index){
 
 }
 
+/*
+ *  pages_alloc
+ *      DESCRIPTION: take n free pages in a row from the pool and map them for the kernel.
+ *      INPUT: n: number of pages, at least 1.
+ *      OUTPUT: None.
+ *      RETURN: the first page, all zeroed. NULL when no run of n pages is free.
+ *      SIDE EFFECT: the pages become present in the first 4MB.
+ */
+void* pages_alloc(uint32_t n){
+    uint32_t flags;
+    uint32_t i, j, index;
+    void* page;
+
+    if (n == 0 || n > PAGE_POOL_PAGES){
+        return NULL;
+    }
+    cli_and_save(flags);
+    for (i = 0; i + n <= PAGE_POOL_PAGES; i++){
+        for (j = 0; j < n && !page_used[i+j]; j++);
+        if (j == n){
+            break;
+        }
+        i += j;                 // the run cannot start before the used page.
+    }
+    if (i + n > PAGE_POOL_PAGES){
+        restore_flags(flags);
+        return NULL;
+    }
+    for (j = 0; j < n; j++){
+        page_used[i+j] = 1;
+        index = PAGE_POOL_START/SIZE_4KB + i + j;
+        page_table[index].RW = 1;
+        page_table[index].US = 0;
+        page_table[index].Page_addr = index;
+        page_table[index].P = 1;
+    }
+    restore_flags(flags);
+
+    page = (void*)(PAGE_POOL_START + i*SIZE_4KB);
+    memset(page, 0, n*SIZE_4KB);
+    return page;
+}
+
+/*
+ *  page_alloc
+ *      DESCRIPTION: take a free page of the pool and map it for the kernel.
+ *      INPUT: None.
+ *      OUTPUT: None.
+ *      RETURN: the page, zeroed. NULL when the pool is empty.
+ *      SIDE EFFECT: the page becomes present in the first 4MB.
+ */
+void* page_alloc(void){
+    return pages_alloc(1);
+}
+
+/*
+ *  page_free
+ *      DESCRIPTION: give a page back to the pool and unmap it.
+ *      INPUT: page: a page from page_alloc.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: the TLB is flushed.
+ */
+void page_free(void* page){
+    uint32_t flags;
+    uint32_t addr = (uint32_t)page;
+
+    if (addr < PAGE_POOL_START || addr >= PAGE_POOL_END || addr % SIZE_4KB != 0){
+        return;
+    }
+    cli_and_save(flags);
+    page_used[(addr - PAGE_POOL_START)/SIZE_4KB] = 0;
+    page_table[addr/SIZE_4KB].P = 0;
+    tlb_flush();
+    restore_flags(flags);
+}
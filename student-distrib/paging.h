@@ -12,6 +12,11 @@
 #define USER_ADDR       0x08000000
 #define KERNEL_LOC      1
 
+// 4KB pages handed out by page_alloc, the free memory between the BIOS area and the kernel.
+#define PAGE_POOL_START 0x100000
+#define PAGE_POOL_END   KERNEL_ADDR
+#define PAGE_POOL_PAGES ((PAGE_POOL_END - PAGE_POOL_START)/SIZE_4KB)
+
 
 void tlb_flush();
 
@@ -64,6 +69,15 @@ table_entry_t page_table_vidmap[TOTAL_SIZE] __attribute__((aligned (SIZE_4KB)));
 
 /* function prototype */
 extern void paging_init(void);
+
+/* take a zeroed 4KB kernel page from the pool, NULL when it is empty. */
+void* page_alloc(void);
+
+/* take n zeroed pages in a row from the pool, NULL when there is no such run. */
+void* pages_alloc(uint32_t n);
+
+/* give a page back to the pool. */
+void page_free(void* page);
 //extern void paging_set_user_mapping(int32_t pid);
 //extern void paging_set_for_vedio_mem(int32_t virtual_addr_for_vedio, int32_t phys_addr_for_vedio);
 //extern void paging_restore_for_vedio_mem(int32_t virtual_addr_for_vedio);
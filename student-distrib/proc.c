@@ -0,0 +1,220 @@
+//
+// proc.c - kernel generated files that show up next to the file system image.
+//
+// A kernel file has no inode. The show function writes the whole text
+// again on every read, and the read copies out the part after file_pos.
+//
+
+#include "proc.h"
+#include "lib.h"
+#include "syscall.h"
+#include "uaccess.h"
+
+#define SUCCESS 0
+#define FAILURE -1
+
+#define PROC_STORE_MAX  32          // longest command written to a kernel file.
+
+static proc_entry_t proc_list[PROC_MAX_ENTRY];
+static int proc_count = 0;
+
+// text of the file being read. shared, so it is built with interrupts off.
+static int8_t proc_text[PROC_BUF_SIZE];
+
+/*
+ *  proc_register
+ *      DESCRIPTION: add a kernel file with the given name.
+ *      INPUT:  name: file name, at most NAME_LENGTH chars.
+ *              show: function that fills the content.
+ *              store: function that takes writes, or NULL.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS, or FAILURE when the table is full.
+ *      SIDE EFFECT: None.
+ */
+int proc_register(const int8_t* name, proc_show_t show, proc_store_t store){
+    if (name == NULL || show == NULL || proc_count >= PROC_MAX_ENTRY ||
+        strlen(name) > NAME_LENGTH){
+        return FAILURE;
+    }
+    strcpy(proc_list[proc_count].name, name);
+    proc_list[proc_count].show = show;
+    proc_list[proc_count].store = store;
+    proc_count++;
+    return SUCCESS;
+}
+
+/*
+ *  proc_lookup
+ *      DESCRIPTION: find a kernel file by name and fill a dentry for it.
+ *                   the inode number is the index in the proc list.
+ *      INPUT:  fname: the file name.
+ *              dentry: the dentry we should copy to.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS for found, FAILURE for otherwise.
+ *      SIDE EFFECT: modify the given dentry.
+ */
+int32_t proc_lookup(const uint8_t* fname, dentry_t* dentry){
+    int i;
+    for (i = 0; i < proc_count; i++){
+        if (!strncmp(proc_list[i].name, (const int8_t*)fname, NAME_LENGTH+1)){
+            memset(dentry, 0, sizeof(dentry_t));
+            strncpy(dentry->filename, proc_list[i].name, NAME_LENGTH);
+            dentry->type = TYPE_PROC;
+            dentry->inode_num = i;
+            return SUCCESS;
+        }
+    }
+    return FAILURE;
+}
+
+/*
+ *  proc_puts
+ *      DESCRIPTION: append a string to the output. cut when the buffer is full.
+ *      INPUT:  out: the output buffer.
+ *              s: the string.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void proc_puts(proc_buf_t* out, const int8_t* s){
+    while (*s != '\0' && out->len < out->size){
+        out->buf[out->len++] = *s++;
+    }
+}
+
+/*
+ *  proc_putnum
+ *      DESCRIPTION: append a number, right aligned with spaces to the given width.
+ *      INPUT:  out: the output buffer.
+ *              value: the number.
+ *              radix: 10 or 16.
+ *              width: minimal width, 0 for none.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void proc_putnum(proc_buf_t* out, uint32_t value, int32_t radix, int32_t width){
+    int8_t conv_buf[36];
+    int32_t len;
+    itoa(value, conv_buf, radix);
+    for (len = strlen(conv_buf); len < width; len++){
+        proc_puts(out, " ");
+    }
+    proc_puts(out, conv_buf);
+}
+
+/*
+ *  proc_putnum64
+ *      DESCRIPTION: append a 64 bit number in decimal, right aligned to the given width.
+ *      INPUT:  out: the output buffer.
+ *              value: the number.
+ *              width: minimal width, 0 for none.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void proc_putnum64(proc_buf_t* out, uint64_t value, int32_t width){
+    int8_t conv_buf[24];
+    int32_t i = sizeof(conv_buf) - 1;
+    conv_buf[i] = '\0';
+    do {
+        conv_buf[--i] = '0' + do_div64(&value, 10);
+    } while (value != 0);
+    for (; (int32_t)sizeof(conv_buf) - 1 - i < width; width--){
+        proc_puts(out, " ");
+    }
+    proc_puts(out, &conv_buf[i]);
+}
+
+/*
+ *  proc_open
+ *      DESCRIPTION: Standard open system call. Do nothing for kernel files.
+ *      INPUT/OUTPUT: None.
+ *      RETURN: SUCCESS.
+ *      SIDE EFFECT: None.
+ */
+int proc_open(const uint8_t* filename){
+    return SUCCESS;
+}
+
+/*
+ *  proc_close
+ *      DESCRIPTION: Standard close system call. Do nothing for kernel files.
+ *      INPUT/OUTPUT: None.
+ *      RETURN: SUCCESS, FAILURE for stdin and stdout.
+ *      SIDE EFFECT: None.
+ */
+int proc_close(int32_t fd){
+    if (fd < 2){
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/*
+ *  proc_read
+ *      DESCRIPTION: build the text of the kernel file and copy the part after
+ *                   the file position into the buffer.
+ *      INPUT:  fd: file descriptor.
+ *              buf: the output buffer.
+ *              nbytes: max number of bytes to read.
+ *      OUTPUT: None.
+ *      RETURN: number of bytes read, 0 at the end, FAILURE for error.
+ *      SIDE EFFECT: the file position is moved forward.
+ */
+int proc_read(int32_t fd, void* buf, int32_t nbytes){
+    uint32_t flags;
+    proc_buf_t out;
+    int32_t count;
+    file_des_t* cur_fd = &get_fd_array()[fd];
+
+    if (buf == NULL || cur_fd->inode_num >= proc_count){
+        return FAILURE;
+    }
+
+    cli_and_save(flags);
+    out.buf = proc_text;
+    out.len = 0;
+    out.size = PROC_BUF_SIZE;
+    proc_list[cur_fd->inode_num].show(&out);
+
+    count = 0;
+    if (cur_fd->file_pos < out.len){
+        count = out.len - cur_fd->file_pos;
+        if (count > nbytes){
+            count = nbytes;
+        }
+        if (copy_to_user(buf, proc_text + cur_fd->file_pos, count)){
+            count = FAILURE;
+        } else{
+            cur_fd->file_pos += count;
+        }
+    }
+    restore_flags(flags);
+    return count;
+}
+
+/*
+ *  proc_write
+ *      DESCRIPTION: pass the written bytes to the store function of the file.
+ *      INPUT:  fd: file descriptor.
+ *              buf: the bytes written.
+ *              nbytes: number of bytes.
+ *      OUTPUT: None.
+ *      RETURN: the return of the store function, FAILURE for read only files.
+ *      SIDE EFFECT: depends on the file.
+ */
+int proc_write(int32_t fd, const void* buf, int32_t nbytes){
+    int8_t cmd[PROC_STORE_MAX];
+    file_des_t* cur_fd = &get_fd_array()[fd];
+
+    if (buf == NULL || cur_fd->inode_num >= proc_count ||
+        proc_list[cur_fd->inode_num].store == NULL){
+        return FAILURE;
+    }
+    // the store function gets a kernel copy of the command.
+    if (nbytes > PROC_STORE_MAX){
+        nbytes = PROC_STORE_MAX;
+    }
+    if (copy_from_user(cmd, buf, nbytes)){
+        return FAILURE;
+    }
+    return proc_list[cur_fd->inode_num].store(cmd, nbytes);
+}
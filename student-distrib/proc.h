@@ -0,0 +1,49 @@
+//
+// proc.h - kernel generated files that show up next to the file system image.
+//
+
+#ifndef MP3_PROC_H
+#define MP3_PROC_H
+
+#include "types.h"
+#include "filesystem.h"
+
+#define PROC_MAX_ENTRY  8           // number of kernel files that can be registered.
+#define PROC_BUF_SIZE   8192        // the generated text is cut at this size.
+
+// output buffer handed to the show function.
+typedef struct proc_buf{
+    int8_t* buf;
+    int32_t len;                    // bytes filled.
+    int32_t size;                   // capacity of buf.
+}proc_buf_t;
+
+// fill the buffer with the current content of the file.
+typedef void (*proc_show_t)(proc_buf_t* out);
+// handle the bytes written to the file. can be NULL for read only files.
+typedef int32_t (*proc_store_t)(const int8_t* buf, int32_t nbytes);
+
+typedef struct proc_entry{
+    int8_t       name[NAME_LENGTH+1];
+    proc_show_t  show;
+    proc_store_t store;
+}proc_entry_t;
+
+/* register a kernel file. */
+int proc_register(const int8_t* name, proc_show_t show, proc_store_t store);
+
+/* look up the kernel files when the name is not in the image. */
+int32_t proc_lookup(const uint8_t* fname, dentry_t* dentry);
+
+/* helpers for the show functions. */
+void proc_puts(proc_buf_t* out, const int8_t* s);
+void proc_putnum(proc_buf_t* out, uint32_t value, int32_t radix, int32_t width);
+void proc_putnum64(proc_buf_t* out, uint64_t value, int32_t width);
+
+/* system call handle for kernel files. */
+int proc_open(const uint8_t* filename);
+int proc_close(int32_t fd);
+int proc_read(int32_t fd, void* buf, int32_t nbytes);
+int proc_write(int32_t fd, const void* buf, int32_t nbytes);
+
+#endif //MP3_PROC_H
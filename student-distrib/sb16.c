@@ -55,6 +55,10 @@ int8_t DSP_reset(){
 #include "sb16.h"
 #include "lib.h"
 #include "i8259.h"
+#include "softirq.h"
+#include "irq.h"
+#include "timer.h"
+#include "scheduler.h"
 
 #define BLOCK_SIZE     (32*1024)
 #define BUFFER_SIZE    (2 * BLOCK_SIZE)
@@ -72,11 +76,39 @@ static uint32_t audio_file_inode = 0;
 // I/O port addresses for lower page registers, channel 4 is unused
 static int8_t page_ports[8] = {0x87, 0x83, 0x81, 0x82, 0x00, 0x8B, 0x89, 0x8A};
 
+static ktimer_t boot_music_timer;
+
 /* initialize SB16 */
 void sb16_init(){
+    request_irq(SB16_IRQ, sb16_handler, "sb16");
     enable_irq(SB16_IRQ);
 }
 
+/*
+ *  boot_music_start
+ *      DESCRIPTION: the timer function of sb16_play_later, runs in the timer tasklet.
+ *      INPUT:  data: the file name.
+ *      OUTPUT/RETURN: None.
+ */
+static void boot_music_start(uint32_t data){
+    play_music((int8_t*)data);
+}
+
+/*
+ *  sb16_play_later
+ *      DESCRIPTION: start a file on the card a few ticks from now, so the DSP reset
+ *                   and the first file read are not in the way of the boot.
+ *      INPUT:  filename: the wav file, must stay valid.
+ *              ticks: PIT ticks to wait.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: the music starts in the timer tasklet.
+ */
+void sb16_play_later(int8_t* filename, uint32_t ticks){
+    init_timer(&boot_music_timer, boot_music_start, (uint32_t)filename);
+    mod_timer(&boot_music_timer, pit_ticks + ticks);
+}
+
 void DSP_outb(uint8_t data, uint8_t port_offset){
     outb(data, SB16_IOBase + port_offset);
 }
@@ -85,8 +117,17 @@ uint8_t DSP_inb(uint8_t port_offset){
     return inb(SB16_IOBase + port_offset);
 }
 
+/*
+ *  Reset_DSP
+ *      DESCRIPTION: reset the DSP and wait for its ready byte. the waits are bounded,
+ *                   a machine without the card reads 0xFF and fails here.
+ *      INPUT:  None.
+ *      OUTPUT: None.
+ *      RETURN: 0 for Success, -1 when no DSP answered.
+ */
 int8_t Reset_DSP(){
     uint32_t _3ms = 1000 * 0.03;
+    uint32_t polls;
     uint8_t i = 0;
     uint8_t read_val = 0;
     DSP_outb(1, DSP_Reset);
@@ -94,19 +135,19 @@ int8_t Reset_DSP(){
         i ++;
     DSP_outb(0, DSP_Reset);
 
-    while(1){
+    for(polls = 0; polls < DSP_RESET_POLLS; polls++){
         read_val = DSP_inb(DSP_Read_Buffer_Status);
         if(read_val & (1 << 7))
             break;
     }
 
-    while(1){
+    for(; polls < DSP_RESET_POLLS; polls++){
         read_val = DSP_inb(DSP_Read);
-        if(read_val & 0xAA)
-            break;
+        if(read_val == DSP_Ready)
+            return 0;
     }
 
-    return 0;
+    return -1;
 }
 
 int8_t Write_DSP(uint8_t data){
@@ -208,7 +249,9 @@ int8_t play_music(int8_t* filename){
         return 0;
     }
 
-    Reset_DSP();
+    if(Reset_DSP() == -1){
+        return -1;
+    }
     strncpy(audio_filename, filename, strlen(filename));
     
     uint32_t bytes_read = read_data(audio_file_inode,current_offset, (uint8_t*)DMA_Buffer, BLOCK_SIZE*2);
@@ -249,13 +292,22 @@ void stop(){
     }
 }
 
-void sb16_handler(){
-    DSP_inb(0xE);
-    send_eoi(5);
-    cli();
-    uint32_t bytes_read = read_data(audio_file_inode, current_offset, (uint8_t*)cur_block, BLOCK_SIZE);
+/*
+ *  sb16_refill
+ *      DESCRIPTION: bottom half of the SB16 interrupt. fill the block that was just
+ *                   played with the next part of the file and start it, or stop at the end.
+ *      INPUT:  data: unused.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: runs with interrupts on.
+ */
+static void sb16_refill(uint32_t data){
+    uint32_t bytes_read;
+
+    if (!is_playing){
+        return;
+    }
+    bytes_read = read_data(audio_file_inode, current_offset, (uint8_t*)cur_block, BLOCK_SIZE);
     current_offset += bytes_read;
-    sti();
 
     if(bytes_read == BLOCK_SIZE){
         uint16_t blksize = (uint16_t) bytes_read;
@@ -267,6 +319,18 @@ void sb16_handler(){
     }
     else if(bytes_read == 0)
         stop();
+}
 
-    return;
+static DECLARE_TASKLET(sb16_tasklet, sb16_refill, 0);
+
+/*
+ *  sb16_handler
+ *      DESCRIPTION: acknowledge the DSP and leave the 32KB read to the tasklet.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: sb16_tasklet is queued.
+ */
+void sb16_handler(){
+    DSP_inb(DSP_Read_Buffer_Status);
+    send_eoi(SB16_IRQ);
+    tasklet_schedule(&sb16_tasklet);
 }
@@ -116,6 +116,10 @@ extern int8_t sound_play(int8_t* filename);
 #define Start_8_bit             0xC0
 #define Start_16_bit            0xB0
 
+#define DSP_Ready               0xAA        // read after a reset.
+#define DSP_RESET_POLLS         0x10000     // port reads before the card counts as absent.
+#define SB16_BOOT_DELAY         2           // PIT ticks from the shell to the boot music.
+
 
 int8_t Reset_DSP();
 int8_t Write_DSP(uint8_t data);
@@ -129,5 +133,6 @@ void stop();
 
 extern void sb16_init();
 extern int8_t play_music(int8_t* filename);
+extern void sb16_play_later(int8_t* filename, uint32_t ticks);
 
 #endif
\ No newline at end of file
@@ -7,6 +7,20 @@
 #include "Terminal.h"
 #include "lib.h"
 #include "i8259.h"
+#include "Signals.h"
+#include "waitq.h"
+#include "vga.h"
+#include "apic.h"
+#include "smp.h"
+#include "softirq.h"
+#include "irq.h"
+#include "timer.h"
+
+// PIT ticks since boot.
+volatile uint32_t pit_ticks = 0;
+
+// ticks left until the next ALARM.
+static volatile int alarm_ticks = ALARM_PERIOD*PIT_FREQ;
 
 /*
  *  init_pit
@@ -14,47 +28,175 @@
  *      INPUT: None.
  *      OUTPUT: None.
  *      RETURN: None.
- *      SIDE EFFECT: the PIT irq enabled.
+ *      SIDE EFFECT: the PIT irq enabled, or the local APIC timer started.
  */
 void PIT_init(){
 
-    uint16_t freq_division = (PIT_MAX_FREQ/2)/PIT_FREQ;
+    uint16_t freq_division;
+    request_irq(PIT_IRQ, pit_handler, "timer");
+    // the local APIC timer ticks on the same vector, the PIT is left alone.
+    if (apic_active){
+        apic_timer_init(PIT_FREQ);
+        return;
+    }
+    freq_division = PIT_MAX_FREQ/PIT_FREQ;
     // select mode 3, channel 0;
     outb(PIT_MODE_SELECT, PIT_COMMAND);
     // load the freq into the PIT.
-    outb((uint8_t)freq_division && 0xFF, PIT_DATA);
-    outb((uint8_t)freq_division >> 8,PIT_DATA);
+    outb((uint8_t)(freq_division & 0xFF), PIT_DATA);
+    outb((uint8_t)(freq_division >> 8),PIT_DATA);
 
     // set the i8259.
     enable_irq(PIT_IRQ);
     return;
 }
 
+/*
+ *  terminal_runnable
+ *      DESCRIPTION: check if the process of the terminal may run.
+ *      INPUT: term: the terminal.
+ *      OUTPUT: None.
+ *      RETURN: 1 for runnable, 0 for sleeping.
+ *      SIDE EFFECT: None.
+ */
+static int terminal_runnable(terminal_t* term){
+    pcb_t* pcb;
+    // no process yet, the switch starts a shell there.
+    if (term->cur_pid < 0 || term->cur_pid >= MAX_PROCESS){
+        return 1;
+    }
+    pcb = get_pcb(term->cur_pid);
+    return pcb->state != TASK_SLEEPING;
+}
+
+/*
+ *  pick_next_terminal
+ *      DESCRIPTION: follow the RR loop from the next terminal and take the first one
+ *                   in the run queue of this CPU (term->cpu) that can run. the handled
+ *                   terminal itself comes last. when none can, a terminal waiting in
+ *                   the queue of another CPU is stolen.
+ *      INPUT: None.
+ *      OUTPUT: None.
+ *      RETURN: terminal to run next, the handled one (NULL on an idle AP) for none.
+ *      SIDE EFFECT: a stolen terminal moves to the run queue of this CPU.
+ */
+static terminal_t* pick_next_terminal(){
+    int id = smp_processor_id();
+    terminal_t* cur = (terminal_t*)handle_term;
+    terminal_t* term = get_terminal(cur != NULL ? cur->next_tid : 0);
+    int i;
+
+    for (i = 0; i < terminal_count; i++){
+        if (term->cpu == id && terminal_runnable(term)){
+            return term;
+        }
+        term = get_terminal(term->next_tid);
+    }
+    // a terminal can be stolen when its CPU runs another one. a terminal without
+    // a process yet is left to its CPU, which starts the shell.
+    for (i = 0; i < terminal_count; i++){
+        if (term->cpu != id && term->cur_pid >= 0 &&
+            cpu_list[term->cpu].term != term && terminal_runnable(term)){
+            term->cpu = id;
+            return term;
+        }
+        term = get_terminal(term->next_tid);
+    }
+    return cur;
+}
+
+/*
+ *  switch_terminal_task
+ *      DESCRIPTION: map the user video memory for the next terminal and switch to its process.
+ *      INPUT: next_term: the terminal to run, NULL for none.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: switch the process.
+ */
+static void switch_terminal_task(terminal_t* next_term){
+    if (next_term == NULL){
+        return;
+    }
+    // remap the video memory if any process on the terminal.
+    if (handle_term == NULL || handle_term->cur_pid != -1){
+        // each terminal has its own page of the text memory, shown or not.
+        vid_remap((uint8_t*)next_term->video_ptr);//map the program paging to the next terminal page
+        gfx_remap(next_term->cur_pid);          // the back buffer belongs to the graphics owner only.
+        tlb_flush();
+    }
+    // switch process.
+    task_switch(next_term->terminalID);//execute the next terminal.
+}
+
+/*
+ *  schedule
+ *      DESCRIPTION: called by a process that goes to sleep. run another terminal,
+ *                   or halt until the next interrupt when nothing else can run.
+ *                   other CPUs may use the kernel while this one halts.
+ *      INPUT: None.
+ *      OUTPUT: None.
+ *      RETURN: None. interrupts are on after it.
+ *      SIDE EFFECT: switch the process.
+ */
+void schedule(){
+    terminal_t* next_term = pick_next_terminal();
+    if (next_term == NULL || next_term == handle_term){
+        kernel_exit();
+        asm volatile("sti; hlt" : : : "memory");
+        kernel_enter();
+        return;
+    }
+    switch_terminal_task(next_term);
+    sti();
+}
+
 /*
  *  pit_handler
  *      DESCRIPTION: handle the PIT interrupt and switch the process. working as scheduler.
+ *                   terminals whose process sleeps are skipped. every CPU gets the tick
+ *                   from its local APIC timer, the boot CPU keeps the time. the switch
+ *                   itself is done by resched_check when do_IRQ is done with the tick.
  *      INPUT: None.
  *      OUTPUT: None.
  *      RETURN: None.
- *      SIDE EFFECT: switch the process.
+ *      SIDE EFFECT: this CPU is marked for a switch.
  */
 void pit_handler(){
-    terminal_t* next_term;
+    int i;
     // ending interrupt.
     send_eoi(PIT_IRQ);
-    // remap the video memory if any process on the terminal.
-    if (handle_term->cur_pid != -1){
-        next_term = get_terminal(handle_term->next_tid);
-
-        if (next_term->terminalID == cur_terminal_id){//if the next terminal to execute == current displaying terminal id
-            //example: handle term2(already executed), next is terminal 0. current show terminal0. then should map the user video memory to the video address.
-            vid_remap((uint8_t*)VIDEO_ADDR);//map the program paging to the physical VM
-        } else{
-            // map to the buffers for each terminal.
-            vid_remap((uint8_t*)next_term->video_ptr);//map the program paging to the next terminal buffer
+
+    if (smp_processor_id() == 0){
+        pit_ticks++;
+        timer_tick();
+
+        // the cursor moves at most once per tick.
+        terminal_cursor_sync();
+
+        // ALARM for the program in front of every terminal.
+        if (--alarm_ticks <= 0){
+            alarm_ticks = ALARM_PERIOD*PIT_FREQ;
+            for (i = 0; i < terminal_count; i++){
+                signal_send(get_terminal(i)->cur_pid, ALARM);
+            }
         }
-        tlb_flush();
     }
-    // switch process.
-    task_switch(handle_term->next_tid);//execute the next terminal.
+    this_cpu()->need_resched = 1;
+}
+
+/*
+ *  resched_check
+ *      DESCRIPTION: switch the process when a tick asked for it. a tick that comes in
+ *                   while tasklets run leaves the switch to the do_IRQ below it.
+ *      INPUT: None.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: switch the process.
+ */
+void resched_check(){
+    if (!this_cpu()->need_resched || in_softirq()){
+        return;
+    }
+    this_cpu()->need_resched = 0;
+    switch_terminal_task(pick_next_terminal());
 }
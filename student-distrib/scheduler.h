@@ -5,18 +5,26 @@
 #ifndef MP3_SCHEDULER_H
 #define MP3_SCHEDULER_H
 
-#endif //MP3_SCHEDULER_H
+#include "types.h"
 
-#define PIT_COMMAND     0x40
-#define PIT_DATA        0x43
+#define PIT_COMMAND     0x43
+#define PIT_DATA        0x40
 
-#define PIT_MODE_SELECT 0x37        // USE mode 3, Channel 0.
+#define PIT_MODE_SELECT 0x36        // USE mode 3, Channel 0, binary count.
 
 #define PIT_FREQ        100
 #define PIT_MAX_FREQ    1193180     // all in HZ.
 
 #define PIT_IRQ         0
 
+// PIT ticks since boot.
+extern volatile uint32_t pit_ticks;
+
 void PIT_init();
 
 extern void pit_handler();
+
+/* switch the process if the last tick asked for it. called by do_IRQ. */
+void resched_check();
+
+#endif //MP3_SCHEDULER_H
@@ -0,0 +1,97 @@
+//
+// scrollback.c - lines that scrolled off the top of a terminal.
+//
+
+#include "scrollback.h"
+#include "lib.h"
+
+#define SUCCESS 0
+#define FAILURE -1
+
+#define RUN_SIZE    3                       // count, char, attribute.
+
+/*
+ *  scrollback_init
+ *      DESCRIPTION: drop the whole history.
+ *      INPUT:  sb: the history.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void scrollback_init(scrollback_t* sb){
+    sb->head = 0;
+    sb->first = 0;
+    sb->count = 0;
+    sb->view = 0;
+}
+
+/*
+ *  scrollback_push
+ *      DESCRIPTION: encode a line and add it as the newest one. the oldest lines are
+ *                   dropped until the line count and the bytes fit.
+ *      INPUT:  sb: the history.
+ *              line: SCROLLBACK_COLS cells.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void scrollback_push(scrollback_t* sb, const uint16_t* line){
+    uint8_t enc[SCROLLBACK_COLS * RUN_SIZE];
+    uint32_t len = 0;
+    uint32_t slot;
+    int i, run;
+
+    for (i = 0; i < SCROLLBACK_COLS; i += run){
+        for (run = 1; i + run < SCROLLBACK_COLS && line[i + run] == line[i]; run++);
+        enc[len++] = run;
+        enc[len++] = line[i] & 0xFF;
+        enc[len++] = line[i] >> 8;
+    }
+
+    // make room. a line always fits, the ring is larger than the worst case.
+    while (sb->count > 0 && (sb->count == SCROLLBACK_LINES ||
+           sb->head + len - sb->line_start[sb->first] > SCROLLBACK_BYTES)){
+        sb->first = (sb->first + 1) % SCROLLBACK_LINES;
+        sb->count--;
+    }
+
+    slot = (sb->first + sb->count) % SCROLLBACK_LINES;
+    sb->line_start[slot] = sb->head;
+    sb->line_len[slot] = len;
+    for (i = 0; i < len; i++){
+        sb->data[(sb->head + i) % SCROLLBACK_BYTES] = enc[i];
+    }
+    sb->head += len;
+    sb->count++;
+}
+
+/*
+ *  scrollback_get
+ *      DESCRIPTION: decode one line of the history.
+ *      INPUT:  sb: the history.
+ *              idx: line number, 0 is the oldest.
+ *              line: SCROLLBACK_COLS cells to fill.
+ *      OUTPUT: the cells of the line.
+ *      RETURN: SUCCESS, FAILURE when the line is not in the history.
+ *      SIDE EFFECT: None.
+ */
+int32_t scrollback_get(scrollback_t* sb, uint32_t idx, uint16_t* line){
+    uint32_t slot, pos, end;
+    uint16_t cell;
+    int x = 0;
+    int run;
+
+    if (idx >= sb->count){
+        return FAILURE;
+    }
+    slot = (sb->first + idx) % SCROLLBACK_LINES;
+    pos = sb->line_start[slot];
+    end = pos + sb->line_len[slot];
+    for (; pos < end && x < SCROLLBACK_COLS; pos += RUN_SIZE){
+        run = sb->data[pos % SCROLLBACK_BYTES];
+        cell = sb->data[(pos + 1) % SCROLLBACK_BYTES] | (sb->data[(pos + 2) % SCROLLBACK_BYTES] << 8);
+        while (run-- > 0 && x < SCROLLBACK_COLS){
+            line[x++] = cell;
+        }
+    }
+    return SUCCESS;
+}
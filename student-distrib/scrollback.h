@@ -0,0 +1,38 @@
+//
+// scrollback.h - lines that scrolled off the top of a terminal.
+//
+// Each line is stored run length encoded, as (count, char, attribute)
+// triples, in a ring of bytes. Blank lines and the blank tail of a line
+// take 3 bytes, so the history holds many more lines than its raw size.
+//
+
+#ifndef MP3_SCROLLBACK_H
+#define MP3_SCROLLBACK_H
+
+#include "types.h"
+
+#define SCROLLBACK_PAGES    8                               // screens of history for each terminal.
+#define SCROLLBACK_LINES    (SCROLLBACK_PAGES * 25)         // lines kept at most.
+#define SCROLLBACK_BYTES    8192                            // encoded bytes kept at most.
+#define SCROLLBACK_COLS     80
+
+typedef struct scrollback{
+    uint8_t  data[SCROLLBACK_BYTES];        // ring of encoded lines.
+    uint32_t head;                          // total bytes written. byte i is at i % size.
+    uint32_t line_start[SCROLLBACK_LINES];  // value of head when the line was written.
+    uint8_t  line_len[SCROLLBACK_LINES];    // encoded size of the line.
+    uint32_t first;                         // slot of the oldest line.
+    uint32_t count;                         // lines in the history.
+    uint32_t view;                          // lines the screen is scrolled back, 0 for live.
+}scrollback_t;
+
+/* drop the whole history. */
+void scrollback_init(scrollback_t* sb);
+
+/* add a line that leaves the screen. the oldest lines go when it is full. */
+void scrollback_push(scrollback_t* sb, const uint16_t* line);
+
+/* decode line idx, 0 is the oldest. */
+int32_t scrollback_get(scrollback_t* sb, uint32_t idx, uint16_t* line);
+
+#endif //MP3_SCROLLBACK_H
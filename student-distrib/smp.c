@@ -0,0 +1,220 @@
+//
+// smp.c - start the APs and keep the per CPU state.
+//
+// Every AP gets its own TSS, idle stack and page directory. The directory
+// is a copy of the one of the boot CPU, only the user program and the video
+// pages are changed per CPU. An AP waits in smp_idle until its timer tick
+// finds a terminal to run, see pick_next_terminal.
+//
+// referred from:
+// SMP. Symmetric Multiprocessing - OSDev Wiki. (n.d.). Retrieved from https://wiki.osdev.org/Symmetric_Multiprocessing
+//
+
+#include "smp.h"
+#include "apic.h"
+#include "lib.h"
+#include "syscall.h"
+#include "fpu.h"
+
+#define SUCCESS 0
+#define FAILURE -1
+
+#define INIT_DELAY      10000           // micro seconds after INIT.
+#define STARTUP_DELAY   200             // after each STARTUP.
+#define ONLINE_WAIT     1000            // times 100 us for the AP to report.
+
+cpu_t cpu_list[NR_CPUS] = {
+    { .id = 0, .online = 1, .pid = -1, .tss = &tss,
+      .page_dir = page_directory, .vidmap_table = page_table_vidmap },
+};
+int cpu_count = 1;
+
+// the boot CPU holds the kernel lock from the start.
+static spinlock_t kernel_lock = { 1 };
+static volatile int kernel_owner = 0;
+
+static tss_t ap_tss[NR_CPUS-1] __attribute__((aligned (128)));
+static directory_entry_t ap_page_dir[NR_CPUS-1][TOTAL_SIZE] __attribute__((aligned (SIZE_4KB)));
+static table_entry_t ap_vidmap_table[NR_CPUS-1][TOTAL_SIZE] __attribute__((aligned (SIZE_4KB)));
+static uint8_t ap_stack[NR_CPUS-1][AP_STACK_SIZE] __attribute__((aligned (16)));
+
+// the AP being started, read by ap_main.
+static volatile int ap_boot_cpu;
+
+extern uint8_t ap_tramp_start[], ap_tramp_end[], ap_tramp_gdt[];
+extern uint8_t gdt_desc_ptr[];
+extern uint32_t ap_boot_cr3, ap_boot_esp;
+
+void ap_main();
+
+/*
+ *  kernel_enter
+ *      DESCRIPTION: take the kernel lock, unless this CPU already holds it.
+ *                   called by every linkage before the handler.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: spins while another CPU is in the kernel.
+ */
+void kernel_enter(){
+    int id = smp_processor_id();
+    if (kernel_owner == id){
+        return;
+    }
+    cpu_list[id].kernel_waiting = 1;
+    spin_lock(&kernel_lock);
+    cpu_list[id].kernel_waiting = 0;
+    kernel_owner = id;
+}
+
+/*
+ *  kernel_exit
+ *      DESCRIPTION: give the kernel lock up, when going back to user level or
+ *                   before waiting in hlt.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void kernel_exit(){
+    uint32_t flags;
+    cli_and_save(flags);
+    if (kernel_owner == smp_processor_id()){
+        kernel_owner = -1;
+        spin_unlock(&kernel_lock);
+    }
+    restore_flags(flags);
+}
+
+/*
+ *  smp_idle
+ *      DESCRIPTION: wait for interrupts without the kernel lock. the timer tick
+ *                   switches to a terminal and never comes back here.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void smp_idle(){
+    while (1){
+        cli();
+        kernel_exit();
+        asm volatile("sti; hlt" : : : "memory");
+    }
+}
+
+/*
+ *  set_tss_desc
+ *      DESCRIPTION: fill a GDT entry for a 32 bit available TSS.
+ */
+static void set_tss_desc(seg_desc_t* desc, tss_t* t){
+    desc->val[0] = 0;
+    desc->val[1] = 0;
+    desc->type = 0x9;
+    desc->sys = 0;
+    desc->dpl = 0;
+    desc->present = 1;
+    SET_TSS_PARAMS((*desc), t, tss_size);
+}
+
+/*
+ *  ap_main
+ *      DESCRIPTION: first C code of an AP, called by the trampoline with the
+ *                   paging on and the idle stack.
+ *      INPUT/OUTPUT/RETURN: None, it does not return.
+ *      SIDE EFFECT: the AP is online.
+ */
+void ap_main(){
+    cpu_t* cpu = &cpu_list[ap_boot_cpu];
+
+    ltr(AP_TSS + (cpu->id - 1)*8);
+    lldt(KERNEL_LDT);
+    apic_ap_init();
+    fpu_init();
+    cpu->online = 1;
+    smp_idle();
+}
+
+/*
+ *  ap_start
+ *      DESCRIPTION: set up the next cpu_t and wake the AP with INIT, STARTUP, STARTUP.
+ *      INPUT:  id: local APIC id of the AP.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS, FAILURE when it did not come online.
+ *      SIDE EFFECT: cpu_count goes up.
+ */
+static int ap_start(uint32_t id){
+    cpu_t* cpu = &cpu_list[cpu_count];
+    int n = cpu_count - 1;
+    int i;
+
+    cpu->id = cpu_count;
+    cpu->apic_id = id;
+    cpu->online = 0;
+    cpu->pid = -1;
+    cpu->pcb = NULL;
+    cpu->term = NULL;
+
+    memset(&ap_tss[n], 0, sizeof(tss_t));
+    ap_tss[n].ldt_segment_selector = KERNEL_LDT;
+    ap_tss[n].ss0 = KERNEL_DS;
+    ap_tss[n].esp0 = (uint32_t)(ap_stack[n] + AP_STACK_SIZE);
+    set_tss_desc(&ap_tss_desc_ptr[n], &ap_tss[n]);
+    cpu->tss = &ap_tss[n];
+
+    // same kernel pages, its own table for the video pages.
+    memcpy(ap_page_dir[n], page_directory, sizeof(ap_page_dir[n]));
+    memcpy(ap_vidmap_table[n], page_table_vidmap, sizeof(ap_vidmap_table[n]));
+    ap_page_dir[n][VIDEO_MEMORY_INDEX].Page_addr = (uint32_t)ap_vidmap_table[n]/SIZE_4KB;
+    cpu->page_dir = ap_page_dir[n];
+    cpu->vidmap_table = ap_vidmap_table[n];
+
+    ap_boot_cpu = cpu->id;
+    ap_boot_cr3 = (uint32_t)cpu->page_dir;
+    ap_boot_esp = (uint32_t)(ap_stack[n] + AP_STACK_SIZE);
+
+    apic_send_ipi(id, LAPIC_ICR_INIT);
+    apic_delay(INIT_DELAY);
+    for (i = 0; i < 2 && !cpu->online; i++){
+        apic_send_ipi(id, LAPIC_ICR_STARTUP | (AP_TRAMPOLINE/SIZE_4KB));
+        apic_delay(STARTUP_DELAY);
+    }
+    for (i = 0; i < ONLINE_WAIT && !cpu->online; i++){
+        apic_delay(100);
+    }
+    if (!cpu->online){
+        return FAILURE;
+    }
+    cpu_count++;
+    return SUCCESS;
+}
+
+/*
+ *  smp_init
+ *      DESCRIPTION: start every enabled processor of the MADT. called by the boot CPU
+ *                   after its own timer runs, before the first process.
+ *      INPUT: None.
+ *      OUTPUT: None.
+ *      RETURN: the number of CPUs online.
+ *      SIDE EFFECT: the APs wait in smp_idle.
+ */
+int smp_init(){
+    uint32_t bsp;
+    uint32_t page = AP_TRAMPOLINE/SIZE_4KB;
+    int i;
+
+    if (!apic_active){
+        return cpu_count;
+    }
+    bsp = apic_id();
+    cpu_list[0].apic_id = bsp;
+
+    // the trampoline runs below 1MB, its page is mapped only for the copy.
+    page_table[page].P = 1;
+    tlb_flush();
+    memcpy((void*)AP_TRAMPOLINE, ap_tramp_start, ap_tramp_end - ap_tramp_start);
+    memcpy((void*)(AP_TRAMPOLINE + (ap_tramp_gdt - ap_tramp_start)), gdt_desc_ptr, 6);
+
+    for (i = 0; i < apic_cpu_count && cpu_count < NR_CPUS; i++){
+        if (apic_cpu_ids[i] != bsp && ap_start(apic_cpu_ids[i]) != SUCCESS){
+            printf("CPU %d did not start\n", apic_cpu_ids[i]);
+        }
+    }
+    page_table[page].P = 0;
+    tlb_flush();
+    return cpu_count;
+}
@@ -0,0 +1,67 @@
+//
+// smp.h - the other processors, the per CPU state and the kernel lock.
+//
+// Each CPU finds its own cpu_t through the TSS it loaded: the boot CPU has
+// KERNEL_TSS, AP i has AP_TSS + 8*(i-1). A CPU holds the kernel lock from
+// the moment it enters the kernel until it goes back to user level or
+// waits in hlt, so the kernel code keeps running on one CPU at a time.
+//
+
+#ifndef MP3_SMP_H
+#define MP3_SMP_H
+
+#include "x86_desc.h"
+
+#define AP_TRAMPOLINE   0x8000          // an AP starts here in real mode. below 1MB, 4KB aligned.
+#define AP_STACK_SIZE   4096            // idle stack of an AP, left for good at its first task.
+
+#ifndef ASM
+
+#include "types.h"
+#include "paging.h"
+#include "spinlock.h"
+
+struct terminal_t;
+struct pcb;
+
+// state of one CPU.
+typedef struct cpu{
+    int      id;                        // index in cpu_list, 0 for the boot CPU.
+    uint32_t apic_id;
+    volatile int online;
+    volatile int pid;                   // process running here, -1 before the first one.
+    volatile struct pcb* pcb;
+    volatile struct terminal_t* term;   // its terminal, NULL while an AP is idle.
+    tss_t*   tss;
+    directory_entry_t* page_dir;        // the user program and video pages differ per CPU.
+    table_entry_t* vidmap_table;
+    volatile int need_resched;          // set by the tick, the switch is done on the way out.
+    volatile int kernel_waiting;        // spinning for the kernel lock, so not at user level.
+}cpu_t;
+
+extern cpu_t cpu_list[NR_CPUS];
+extern int cpu_count;
+
+/* index of this CPU. before the TR is loaded it is the boot CPU. */
+static inline int smp_processor_id(){
+    uint16_t sel;
+    asm volatile("str %0" : "=r"(sel));
+    return (sel < AP_TSS) ? 0 : (sel - AP_TSS)/8 + 1;
+}
+
+#define this_cpu()              (&cpu_list[smp_processor_id()])
+#define cpu_page_directory()    (this_cpu()->page_dir)
+#define cpu_vidmap_table()      (this_cpu()->vidmap_table)
+
+/* start the APs listed by the MADT. returns the number of CPUs online. */
+int smp_init();
+
+/* called by the linkages on the way in, and on the way back to user level. */
+void kernel_enter();
+void kernel_exit();
+
+/* where an AP waits for its first task. */
+void smp_idle();
+
+#endif
+#endif //MP3_SMP_H
@@ -0,0 +1,99 @@
+//
+// softirq.c - tasklets, the bottom halves of the interrupt handlers.
+//
+// Each CPU has its own queue. do_softirq takes the whole queue with
+// interrupts off and runs it with interrupts on. An interrupt that comes
+// in meanwhile only queues more work, which the same do_softirq picks up
+// in its next round.
+//
+
+#include "softirq.h"
+#include "lib.h"
+#include "smp.h"
+
+// tasklet queue of one CPU.
+typedef struct softirq_cpu{
+    tasklet_t*  head;
+    tasklet_t** tail;                   // the next field of the last tasklet, or &head.
+    volatile int running;
+}softirq_cpu_t;
+
+static softirq_cpu_t softirq_cpus[NR_CPUS];
+
+/*
+ *  tasklet_schedule
+ *      DESCRIPTION: put the tasklet at the end of the queue of this CPU, unless it is
+ *                   queued already.
+ *      INPUT:  t: the tasklet.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: the tasklet runs at the end of the current interrupt, or the next one.
+ */
+void tasklet_schedule(tasklet_t* t){
+    uint32_t flags;
+    softirq_cpu_t* cpu;
+
+    cli_and_save(flags);
+    if (!(t->state & TASKLET_SCHED)){
+        cpu = &softirq_cpus[smp_processor_id()];
+        if (cpu->tail == NULL){
+            cpu->tail = &cpu->head;
+        }
+        t->state |= TASKLET_SCHED;
+        t->next = NULL;
+        *cpu->tail = t;
+        cpu->tail = &t->next;
+    }
+    restore_flags(flags);
+}
+
+/*
+ *  do_softirq
+ *      DESCRIPTION: run the queued tasklets of this CPU with interrupts on. does nothing
+ *                   when it is running already, the outer call picks the new ones up.
+ *                   work queued after SOFTIRQ_MAX_RESTART rounds waits for the next
+ *                   interrupt, so a storm can not keep the CPU here.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: interrupts are on while the tasklets run, restored after.
+ */
+void do_softirq(){
+    uint32_t flags;
+    int round;
+    tasklet_t* list;
+    tasklet_t* t;
+    softirq_cpu_t* cpu = &softirq_cpus[smp_processor_id()];
+
+    cli_and_save(flags);
+    if (cpu->running || cpu->head == NULL){
+        restore_flags(flags);
+        return;
+    }
+    cpu->running = 1;
+    for (round = 0; round < SOFTIRQ_MAX_RESTART && cpu->head != NULL; round++){
+        list = cpu->head;
+        cpu->head = NULL;
+        cpu->tail = &cpu->head;
+        sti();
+        while (list != NULL){
+            t = list;
+            list = t->next;
+            // cleared first, so an interrupt during the run can queue it again.
+            t->state &= ~TASKLET_SCHED;
+            t->func(t->data);
+        }
+        cli();
+    }
+    cpu->running = 0;
+    restore_flags(flags);
+}
+
+/*
+ *  in_softirq
+ *      DESCRIPTION: check if this CPU is running tasklets.
+ *      INPUT: None.
+ *      OUTPUT: None.
+ *      RETURN: 1 for running, 0 otherwise.
+ *      SIDE EFFECT: None.
+ */
+int in_softirq(){
+    return softirq_cpus[smp_processor_id()].running;
+}
@@ -0,0 +1,37 @@
+//
+// softirq.h - tasklets, the bottom halves of the interrupt handlers.
+//
+// A handler only talks to its device and queues a tasklet. The IRQ linkage
+// runs the queued tasklets after the handler returns, with interrupts on.
+// A tasklet is on one queue at most, so scheduling it again before it runs
+// does nothing. Tasklets never sleep.
+//
+
+#ifndef MP3_SOFTIRQ_H
+#define MP3_SOFTIRQ_H
+
+#include "types.h"
+
+#define TASKLET_SCHED       1           // state bit, set while on a queue.
+#define SOFTIRQ_MAX_RESTART 8           // rounds of new tasklets run by one do_softirq.
+
+typedef struct tasklet{
+    struct tasklet* next;
+    void (*func)(uint32_t data);
+    uint32_t data;
+    volatile uint32_t state;
+}tasklet_t;
+
+#define DECLARE_TASKLET(name, func, data) \
+    tasklet_t name = {NULL, func, data, 0}
+
+/* queue the tasklet on this CPU. safe in interrupt handlers. */
+void tasklet_schedule(tasklet_t* t);
+
+/* run the queued tasklets, called by the IRQ linkage. */
+void do_softirq();
+
+/* 1 while this CPU runs tasklets. the scheduler does not switch then. */
+int in_softirq();
+
+#endif //MP3_SOFTIRQ_H
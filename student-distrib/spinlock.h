@@ -0,0 +1,50 @@
+//
+// spinlock.h - busy waiting locks for data shared between the CPUs.
+//
+// The _irqsave versions also keep the interrupt handlers of this CPU out,
+// they replace the cli/sti pairs around shared data.
+//
+
+#ifndef MP3_SPINLOCK_H
+#define MP3_SPINLOCK_H
+
+#include "types.h"
+#include "lib.h"
+
+typedef struct spinlock{
+    volatile uint32_t locked;           // 1 while a CPU holds it.
+}spinlock_t;
+
+#define SPIN_LOCK_UNLOCKED  { 0 }
+
+/* spin until the lock is ours. the xchg is only tried when the lock looks free. */
+static inline void spin_lock(spinlock_t* lock){
+    uint32_t old;
+    do {
+        while (lock->locked){
+            asm volatile("pause");
+        }
+        old = 1;
+        asm volatile("xchgl %0, %1" : "+r"(old), "+m"(lock->locked) : : "memory");
+    } while (old != 0);
+}
+
+/* a plain store releases on x86, the barrier keeps the compiler from moving writes after it. */
+static inline void spin_unlock(spinlock_t* lock){
+    asm volatile("" : : : "memory");
+    lock->locked = 0;
+}
+
+#define spin_lock_irqsave(lock, flags)          \
+do {                                            \
+    cli_and_save(flags);                        \
+    spin_lock(lock);                            \
+} while (0)
+
+#define spin_unlock_irqrestore(lock, flags)     \
+do {                                            \
+    spin_unlock(lock);                          \
+    restore_flags(flags);                       \
+} while (0)
+
+#endif //MP3_SPINLOCK_H
@@ -4,6 +4,11 @@
 #include "RTC.h"
 #include "tasks.h"
 #include "Terminal.h"
+#include "proc.h"
+#include "uaccess.h"
+#include "scheduler.h"
+#include "vga.h"
+#include "clock.h"
 
 
 /*
@@ -45,6 +50,10 @@ int32_t read(int32_t fd, void* buf, int32_t nbytes) {
         printf("The sysread input is wrong!\n");
         return -1;
     }
+    // the drivers copy with copy_to_user, refuse a bad buffer early.
+    if(!access_ok(buf, nbytes)){
+        return -1;
+    }
     pcb_t* current_pcb = get_pcb(get_current_pid());
     uint32_t whether_use = current_pcb->file_des_array[fd].flag;
     if(whether_use == NOT_USE){
@@ -72,6 +81,9 @@ int32_t write(int32_t fd, const void* buf, int32_t nbytes) {
         printf("input error!!!!6868666\n");
         return -1;
     }
+    if(!access_ok(buf, nbytes)){
+        return -1;
+    }
     pcb_t* current_pcb = get_pcb(get_current_pid());
     uint32_t whether_use = current_pcb->file_des_array[fd].flag;
     if(whether_use == NOT_USE){
@@ -108,6 +120,7 @@ int32_t open(const uint8_t* filename) {
             current_pcb->file_des_array[i].flag = 1;
 
             current_pcb->file_des_array[i].file_pos = 0;
+            current_pcb->file_des_array[i].f_flags = 0;
 
             if(dentry_found.type == TYPE_RTC){                /* rtc*/
                 //printf("Open RTC ...\n");
@@ -121,6 +134,9 @@ int32_t open(const uint8_t* filename) {
                 //printf("Open regular file...\n");
                 current_pcb->file_des_array[i].inode_num = dentry_found.inode_num;
                 current_pcb->file_des_array[i].file_op_table_ptr = &File_Op_table;
+            }else if (dentry_found.type == TYPE_PROC){         /* kernel file */
+                current_pcb->file_des_array[i].inode_num = dentry_found.inode_num;
+                current_pcb->file_des_array[i].file_op_table_ptr = &Proc_Op_table;
             }
             return i;
         }
@@ -167,24 +183,22 @@ int32_t close(int32_t fd) {
  */
 int32_t getargs(const void* buf, int32_t nbytes){
 
-    uint8_t* bufptr;
+    uint32_t length;
     pcb_t*  cur_pcb = get_pcb(get_current_pid());
-//    int i;
-//    int num_print = 0;
 
     // check if the input is valid.
-    if (buf == NULL || nbytes == 0){
+    if (buf == NULL || nbytes <= 0 || !access_ok(buf, nbytes)){
         return -1;
     }
-    bufptr = (uint8_t* )buf;
-/*
-    for (i = 0;i<nbytes;i++){
-        bufptr[i] = cur_pcb->arg[i];
-        num_print++;
+    // copy the string with its NULL, then pad the rest like strncpy.
+    length = strlen((int8_t*)(cur_pcb->arg)) + 1;
+    if (length > nbytes){
+        length = nbytes;
+    }
+    if (copy_to_user((void*)buf, cur_pcb->arg, length) ||
+        clear_user((uint8_t*)buf + length, nbytes - length)){
+        return -1;
     }
-    */
-   //printf("the args copy is: %d\n", cur_pcb->arg);
-    strncpy((int8_t*)buf, (int8_t*)(cur_pcb->arg), nbytes);
     return 0;
 }
 
@@ -197,25 +211,27 @@ int32_t getargs(const void* buf, int32_t nbytes){
  *      SIDE EFFECT: enable a new paging map to the physical VM and make the screen_start point to that vitual memory.
  */
 int32_t vidmap(uint32_t** screen_start){
+    uint32_t* video_start = (uint32_t*)(VIDEO_MM);
     //printf("enter vidmap!!!!!!!!!!!\n");
-    if (!screen_start || (uint32_t)screen_start < USER_ADDR || (uint32_t)screen_start >= (USER_ADDR+SIZE_4MB))
+    // hand out the address first, nothing is mapped for a bad pointer.
+    if (copy_to_user(screen_start, &video_start, sizeof(video_start)))
         return -1;
     //0x8800000(program paging(to modify the physical VM))
     // set up at 136 MB USER_ADDR
-    page_directory[VIDEO_MEMORY_INDEX].P = 1;
-    page_directory[VIDEO_MEMORY_INDEX].PS = 0;  //4KB
-    page_directory[VIDEO_MEMORY_INDEX].US = 1;
-    page_directory[VIDEO_MEMORY_INDEX].Page_addr =((uint32_t)page_table_vidmap)/SIZE_4KB;
-    page_directory[VIDEO_MEMORY_INDEX].RW = 1;
+    cpu_page_directory()[VIDEO_MEMORY_INDEX].P = 1;
+    cpu_page_directory()[VIDEO_MEMORY_INDEX].PS = 0;  //4KB
+    cpu_page_directory()[VIDEO_MEMORY_INDEX].US = 1;
+    cpu_page_directory()[VIDEO_MEMORY_INDEX].Page_addr =((uint32_t)cpu_vidmap_table())/SIZE_4KB;
+    cpu_page_directory()[VIDEO_MEMORY_INDEX].RW = 1;
 
-    page_table_vidmap[0].P = 1;//why page_table_vidmap[0]? because 0x88000000 is the first 4kb paging in the 132MB-136MB  
-    page_table_vidmap[0].US = 1;
-    page_table_vidmap[0].Page_addr = VIDEO_ADDR/SIZE_4KB;//map the program paging(DPL=3)?? to the Physicle VM
-    page_table_vidmap[0].RW = 1;//read and write
+    cpu_vidmap_table()[0].P = 1;//why cpu_vidmap_table()[0]? because 0x88000000 is the first 4kb paging in the 132MB-136MB  
+    cpu_vidmap_table()[0].US = 1;
+    cpu_vidmap_table()[0].Page_addr = (uint32_t)handle_term->video_ptr/SIZE_4KB;//map the program paging to the page of its terminal
+    cpu_vidmap_table()[0].RW = 1;//read and write
 
     tlb_flush();
 
-    *screen_start = (uint32_t*)(VIDEO_MM);  //0x8800000/4096 = 34816, 34816/1024 = 34 (the 34th 4MB(132MB-136MB))
+    //0x8800000/4096 = 34816, 34816/1024 = 34 (the 34th 4MB(132MB-136MB))
     return 0;
 }
 
@@ -233,27 +249,424 @@ int vid_remap(uint8_t* address){
     }
 
     // set up at 136 MBUSER_ADDR
-    page_directory[VIDEO_MEMORY_INDEX].P = 1;
-    page_directory[VIDEO_MEMORY_INDEX].PS = 0;  //4KB
-    page_directory[VIDEO_MEMORY_INDEX].US = 1;
-    page_directory[VIDEO_MEMORY_INDEX].Page_addr =((uint32_t)page_table_vidmap)/SIZE_4KB;
-    page_directory[VIDEO_MEMORY_INDEX].RW = 1;
+    cpu_page_directory()[VIDEO_MEMORY_INDEX].P = 1;
+    cpu_page_directory()[VIDEO_MEMORY_INDEX].PS = 0;  //4KB
+    cpu_page_directory()[VIDEO_MEMORY_INDEX].US = 1;
+    cpu_page_directory()[VIDEO_MEMORY_INDEX].Page_addr =((uint32_t)cpu_vidmap_table())/SIZE_4KB;
+    cpu_page_directory()[VIDEO_MEMORY_INDEX].RW = 1;
 
-    page_table_vidmap[0].P = 1;     
-    page_table_vidmap[0].US = 1;
-    page_table_vidmap[0].Page_addr = ((uint32_t)address)/SIZE_4KB;  //map the first 4kb paging in 132MB-136MB to the terminal buffer(calculated by address)
-    page_table_vidmap[0].RW = 1;
+    cpu_vidmap_table()[0].P = 1;     
+    cpu_vidmap_table()[0].US = 1;
+    cpu_vidmap_table()[0].Page_addr = ((uint32_t)address)/SIZE_4KB;  //map the first 4kb paging in 132MB-136MB to the terminal buffer(calculated by address)
+    cpu_vidmap_table()[0].RW = 1;
 
     tlb_flush();
     return 0;
 }
 
-int32_t set_handler(int32_t signum, void* handler_address){
-    return 1;
+/*
+ *  vidmap_ex
+ *      DESCRIPTION: vidmap with a choice of screen. VIDMAP_TEXT is the text page of
+ *                   the terminal as vidmap gives. VIDMAP_GFX makes the process the owner
+ *                   of the 320x200x256 mode and maps its back buffer right after the
+ *                   text page. the screen follows vidflush.
+ *      INPUT:  screen_start: where the user address is written.
+ *              mode: VIDMAP_TEXT or VIDMAP_GFX.
+ *      OUTPUT: None.
+ *      RETURN: 0 for Success, -1 for FAIL or when another process owns the graphics.
+ *      SIDE EFFECT: the screen may switch to mode 13h.
+ */
+int32_t vidmap_ex(uint8_t** screen_start, int32_t mode){
+    uint8_t* back_start = (uint8_t*)(VIDEO_MM + SIZE_4KB);
+
+    if (mode == VIDMAP_TEXT){
+        return vidmap((uint32_t**)screen_start);
+    }
+    if (mode != VIDMAP_GFX){
+        return -1;
+    }
+    // the address is only given out once the graphics are ours.
+    if (gfx_acquire(get_current_pid(), handle_term->terminalID))
+        return -1;
+    if (copy_to_user(screen_start, &back_start, sizeof(back_start))){
+        gfx_release(get_current_pid());
+        return -1;
+    }
+    // the text page stays mapped too, the directory entry is set up the same way.
+    return vid_remap((uint8_t*)handle_term->video_ptr);
+}
+
+/*
+ *  vidflush
+ *      DESCRIPTION: copy the changed rectangles of the back buffer to the screen,
+ *                   starting at the next vertical retrace.
+ *      INPUT:  rects: the rectangles, clipped to the screen.
+ *              n: number of rectangles, at most GFX_MAX_RECTS. 0 for the whole screen.
+ *      OUTPUT: None.
+ *      RETURN: 0 for Success, -1 for FAIL or when the caller does not own the graphics.
+ *      SIDE EFFECT: nothing is drawn while the terminal of the caller is not shown.
+ */
+int32_t vidflush(const gfx_rect_t* rects, int32_t n){
+    gfx_rect_t krects[GFX_MAX_RECTS];
+
+    if (n < 0 || n > GFX_MAX_RECTS){
+        return -1;
+    }
+    if (n > 0 && copy_from_user(krects, rects, n*sizeof(gfx_rect_t))){
+        return -1;
+    }
+    return gfx_flush(get_current_pid(), krects, n);
+}
+
+/*
+ *  check_iovec
+ *      DESCRIPTION: copy the iovec array given by the user into the kernel and check it
+ *                   before readv/writev. the segments themselves stay user buffers.
+ *      INPUT:  kiov: kernel array with room for IOV_MAX segments.
+ *              iov: the segment array.
+ *              iovcnt: number of segments.
+ *      OUTPUT: kiov is filled.
+ *      RETURN: total bytes described by the array, or -1 for FAIL or a total
+ *              past INT32_MAX.
+ *      SIDE EFFECT: None.
+ */
+static int32_t check_iovec(iovec_t* kiov, const iovec_t* iov, int32_t iovcnt){
+    int i;
+    int32_t total = 0;
+    if (iov == NULL || iovcnt <= 0 || iovcnt > IOV_MAX ||
+        copy_from_user(kiov, iov, iovcnt*sizeof(iovec_t))){
+        return -1;
+    }
+    for (i = 0; i < iovcnt; i++){
+        if (kiov[i].iov_len < 0 || (kiov[i].iov_len != 0 && !access_ok(kiov[i].iov_base, kiov[i].iov_len))){
+            return -1;
+        }
+        // the total is returned as an int32_t, it must not wrap.
+        if (kiov[i].iov_len > INT32_MAX - total){
+            return -1;
+        }
+        total += kiov[i].iov_len;
+    }
+    return total;
+}
+
+/*
+ *  sys_readv(int32_t fd, const iovec_t* user_iov, int32_t iovcnt)
+ *      Description: read into several buffers with one trap.
+ *      Inputs: fd - file descriptor, user_iov - segment array, iovcnt - number of segments
+ *      Outputs: -1 on failure, total number of read bytes on success
+ */
+int32_t readv(int32_t fd, const iovec_t* user_iov, int32_t iovcnt){
+    int i;
+    int32_t ret;
+    int32_t total = 0;
+    iovec_t iov[IOV_MAX];
+    file_operation_table_t* fop;
+
+    if(fd < 0 || fd >= MAX_FD || fd == 1 || check_iovec(iov, user_iov, iovcnt) == -1){
+        return -1;
+    }
+    pcb_t* current_pcb = get_pcb(get_current_pid());
+    if(current_pcb->file_des_array[fd].flag == NOT_USE){
+        return -1;
+    }
+    fop = current_pcb->file_des_array[fd].file_op_table_ptr;
+    if (fop->readv != NULL){
+        return fop->readv(fd, iov, iovcnt);
+    }
+
+    // no batched version. fill the segments in order and stop at the first short read.
+    for (i = 0; i < iovcnt; i++){
+        if (iov[i].iov_len == 0){
+            continue;
+        }
+        ret = fop->read(fd, iov[i].iov_base, iov[i].iov_len);
+        if (ret == -1){
+            return (total == 0) ? -1 : total;
+        }
+        total += ret;
+        if (ret < iov[i].iov_len){
+            break;
+        }
+    }
+    return total;
+}
+
+/*
+ *  sys_writev(int32_t fd, const iovec_t* user_iov, int32_t iovcnt)
+ *      Description: write several buffers with one trap.
+ *      Inputs: fd - file descriptor, user_iov - segment array, iovcnt - number of segments
+ *      Outputs: -1 on failure, total number of written bytes on success
+ */
+int32_t writev(int32_t fd, const iovec_t* user_iov, int32_t iovcnt){
+    int i;
+    int32_t ret;
+    int32_t total = 0;
+    iovec_t iov[IOV_MAX];
+    file_operation_table_t* fop;
+
+    if(fd < 0 || fd >= MAX_FD || fd == 0 || check_iovec(iov, user_iov, iovcnt) == -1){
+        return -1;
+    }
+    pcb_t* current_pcb = get_pcb(get_current_pid());
+    if(current_pcb->file_des_array[fd].flag == NOT_USE){
+        return -1;
+    }
+    fop = current_pcb->file_des_array[fd].file_op_table_ptr;
+    if (fop->writev != NULL){
+        return fop->writev(fd, iov, iovcnt);
+    }
+
+    // no batched version. hand the segments to write one by one and stop at the
+    // first short write, the bytes written so far are returned. a driver that
+    // gives back 0 for success, like the RTC, wrote the whole segment.
+    for (i = 0; i < iovcnt; i++){
+        if (iov[i].iov_len == 0){
+            continue;
+        }
+        ret = fop->write(fd, iov[i].iov_base, iov[i].iov_len);
+        if (ret == -1){
+            return (total == 0) ? -1 : total;
+        }
+        if (ret == 0){
+            ret = iov[i].iov_len;
+        }
+        total += ret;
+        if (ret < iov[i].iov_len){
+            break;
+        }
+    }
+    return total;
+}
+/*
+ *  sys_ioctl(int32_t fd, int32_t cmd, int32_t arg)
+ *      Description: control a file. FIONBIO is handled here for every file, the
+ *                   other commands go to the file's own ioctl.
+ *      Inputs: fd - file descriptor, cmd - the command, arg - argument of the command
+ *      Outputs: -1 on failure, the result of the command on success
+ */
+int32_t ioctl(int32_t fd, int32_t cmd, int32_t arg){
+    file_des_t* cur_fd;
+
+    if(fd < 0 || fd >= MAX_FD){
+        return -1;
+    }
+    cur_fd = &get_fd_array()[fd];
+    if(cur_fd->flag == NOT_USE){
+        return -1;
+    }
+    if(cmd == FIONBIO){
+        if(arg){
+            cur_fd->f_flags |= O_NONBLOCK;
+        } else{
+            cur_fd->f_flags &= ~O_NONBLOCK;
+        }
+        return 0;
+    }
+    if(cur_fd->file_op_table_ptr->ioctl == NULL){
+        return -1;
+    }
+    return cur_fd->file_op_table_ptr->ioctl(fd, cmd, arg);
+}
+
+/*
+ *  poll_wait
+ *      DESCRIPTION: called by the poll handler of a file. put the current process on the
+ *                   wait queue, so poll sleeps until the file may be ready.
+ *      INPUT:  pt: the poll table, NULL when poll will not sleep.
+ *              wq: the wait queue of the file.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void poll_wait(poll_table_t* pt, wait_queue_t* wq){
+    int i;
+    if (pt == NULL){
+        return;
+    }
+    for (i = 0; i < pt->count; i++){
+        if (pt->queue[i] == wq){
+            return;
+        }
+    }
+    if (pt->count < POLL_MAX_QUEUE){
+        pt->queue[pt->count++] = wq;
+        wait_queue_add(wq);
+    }
+}
+
+/*
+ *  poll_check
+ *      DESCRIPTION: fill the revents of every entry.
+ *      INPUT:  fds: kernel copy of the poll array.
+ *              nfds: number of entries.
+ *              pt: the poll table the files register on.
+ *      OUTPUT: the revents are filled.
+ *      RETURN: number of entries with revents set.
+ *      SIDE EFFECT: None.
+ */
+static int32_t poll_check(pollfd_t* fds, int32_t nfds, poll_table_t* pt){
+    int i;
+    int32_t ready = 0;
+    file_des_t* fd_array = get_fd_array();
+    file_operation_table_t* fop;
+
+    for (i = 0; i < nfds; i++){
+        fds[i].revents = 0;
+        if (fds[i].fd < 0 || fds[i].fd >= MAX_FD || fd_array[fds[i].fd].flag == NOT_USE){
+            fds[i].revents = POLLNVAL;
+        } else{
+            fop = fd_array[fds[i].fd].file_op_table_ptr;
+            if (fop->poll == NULL){
+                fds[i].revents = fds[i].events & (POLLIN | POLLOUT);
+            } else{
+                fds[i].revents = fop->poll(fds[i].fd, pt) & (fds[i].events | POLLERR);
+            }
+        }
+        if (fds[i].revents){
+            ready++;
+        }
+    }
+    return ready;
+}
+
+/*
+ *  ms_to_ticks
+ *      DESCRIPTION: a time in PIT ticks, rounded up so a wait is never shorter.
+ *      INPUT:  ms: the time, not negative.
+ *      OUTPUT: None.
+ *      RETURN: the ticks.
+ *      SIDE EFFECT: None.
+ */
+static uint32_t ms_to_ticks(int32_t ms){
+    return (ms/1000)*PIT_FREQ + ((ms%1000)*PIT_FREQ + 999)/1000;
+}
+
+/*
+ *  sys_poll(pollfd_t* fds, int32_t nfds, int32_t timeout)
+ *      Description: wait until one of the files is ready. the process sleeps on the
+ *                   wait queues of all the files and is not scheduled meanwhile.
+ *      Inputs: fds - poll array, nfds - number of entries,
+ *              timeout - in ms, 0 to return at once, -1 to wait forever
+ *      Outputs: -1 on failure, number of ready entries on success, 0 for time out
+ */
+int32_t poll(pollfd_t* fds, int32_t nfds, int32_t timeout){
+    pollfd_t kfds[MAX_FD];
+    poll_table_t pt;
+    uint32_t deadline = 0;
+    int32_t ready;
+    int i;
+    pcb_t* current_pcb = get_pcb(get_current_pid());
+
+    if(nfds <= 0 || nfds > MAX_FD || copy_from_user(kfds, fds, nfds*sizeof(pollfd_t))){
+        return -1;
+    }
+    if(timeout > 0){
+        deadline = pit_ticks + ms_to_ticks(timeout);
+    }
+
+    pt.count = 0;
+    while(1){
+        cli();
+        current_pcb->state = TASK_SLEEPING;
+        ready = poll_check(kfds, nfds, &pt);
+        if(ready || timeout == 0 || (deadline && pit_ticks >= deadline) || signal_fatal_pending()){
+            break;
+        }
+        // the timer wakes us at the deadline.
+        if(deadline && !timer_pending(&current_pcb->wake_timer)){
+            mod_timer(&current_pcb->wake_timer, deadline);
+        }
+        schedule();
+    }
+    current_pcb->state = TASK_RUNNING;
+    del_timer(&current_pcb->wake_timer);
+    for(i = 0; i < pt.count; i++){
+        wait_queue_remove(pt.queue[i]);
+    }
+    sti();
+
+    if(copy_to_user(fds, kfds, nfds*sizeof(pollfd_t))){
+        return -1;
+    }
+    return ready;
+}
+
+/*
+ *  sleep
+ *      DESCRIPTION: give the CPU away for a time. the wake timer of the pcb ends the
+ *                   sleep, the scheduler skips the process until then.
+ *      INPUT:  ms: the time, rounded up to PIT ticks.
+ *      OUTPUT: None.
+ *      RETURN: 0 after the whole time, the ms left when a signal that kills the
+ *              process ended it early, -1 for a negative time.
+ *      SIDE EFFECT: None.
+ */
+int32_t sleep(int32_t ms){
+    uint32_t deadline;
+    int32_t left;
+    pcb_t* current_pcb = get_pcb(get_current_pid());
+
+    if(ms < 0){
+        return -1;
+    }
+    deadline = pit_ticks + ms_to_ticks(ms);
+
+    while(1){
+        cli();
+        current_pcb->state = TASK_SLEEPING;
+        left = (int32_t)(deadline - pit_ticks);
+        if(left <= 0 || signal_fatal_pending()){
+            break;
+        }
+        if(!timer_pending(&current_pcb->wake_timer)){
+            mod_timer(&current_pcb->wake_timer, deadline);
+        }
+        schedule();
+    }
+    current_pcb->state = TASK_RUNNING;
+    del_timer(&current_pcb->wake_timer);
+    sti();
+
+    return (left <= 0) ? 0 : left*(1000/PIT_FREQ);
+}
+
+/*
+ *  gettime
+ *      DESCRIPTION: the time of the monotonic clock, from boot. it never goes back,
+ *                   also when the caller moves to another CPU.
+ *      INPUT:  ts: filled with the time.
+ *      OUTPUT: None.
+ *      RETURN: 0 for Success, -1 for FAIL.
+ *      SIDE EFFECT: None.
+ */
+int32_t gettime(timespec_t* ts){
+    timespec_t kts;
+    uint64_t ns = clock_ns();
+
+    kts.tv_nsec = do_div64(&ns, NSEC_PER_SEC);
+    kts.tv_sec = (uint32_t)ns;
+    if (copy_to_user(ts, &kts, sizeof(timespec_t))){
+        return -1;
+    }
+    return 0;
 }
-int32_t sigreturn(void){
-    return 1;
+
+/*
+ *  fd_nonblock
+ *      DESCRIPTION: check if the fd of the current process is in non blocking mode.
+ *      INPUT:  fd: file descriptor.
+ *      OUTPUT: None.
+ *      RETURN: 1 for non blocking, 0 for not.
+ *      SIDE EFFECT: None.
+ */
+int32_t fd_nonblock(int32_t fd){
+    if (fd < 0 || fd >= MAX_FD){
+        return 0;
+    }
+    return (get_fd_array()[fd].f_flags & O_NONBLOCK) != 0;
 }
+
 /*-----------------------------helper functions--------------------------*/
 pcb_t* get_pcb(int32_t pid){
     return (pcb_t*)(_Eight_MB_ - _Eight_KB_ *(pid+1));
@@ -264,6 +677,10 @@ void init_File_operations_table(){
     File_Op_table.read = file_read;
     File_Op_table.write = file_write;
     File_Op_table.close = file_close;
+    File_Op_table.readv = file_readv;
+    File_Op_table.writev = NULL;
+    File_Op_table.ioctl = NULL;
+    File_Op_table.poll = NULL;
 }
 
 void init_Rtc_operations_table(){
@@ -271,6 +688,10 @@ void init_Rtc_operations_table(){
     RTC_Op_table.read = rtc_read;
     RTC_Op_table.write = rtc_write;
     RTC_Op_table.close = rtc_close;
+    RTC_Op_table.readv = NULL;
+    RTC_Op_table.writev = NULL;
+    RTC_Op_table.ioctl = NULL;
+    RTC_Op_table.poll = rtc_poll;
 }
 
 void init_Directory_operations_table(){
@@ -278,6 +699,10 @@ void init_Directory_operations_table(){
     Directory_Op_table.read = directory_read;
     Directory_Op_table.write = directory_write;
     Directory_Op_table.close = directory_close;
+    Directory_Op_table.readv = NULL;
+    Directory_Op_table.writev = NULL;
+    Directory_Op_table.ioctl = NULL;
+    Directory_Op_table.poll = NULL;
 }
 
 void init_Terminal_table(){
@@ -285,14 +710,30 @@ void init_Terminal_table(){
     Terminal_table.read = terminal_read;
     Terminal_table.write = terminal_write;
     Terminal_table.close = terminal_close;
+    Terminal_table.readv = NULL;
+    Terminal_table.writev = terminal_writev;
+    Terminal_table.ioctl = terminal_ioctl;
+    Terminal_table.poll = terminal_poll;
 }
 
+void init_Proc_table(){
+    Proc_Op_table.open = proc_open;
+    Proc_Op_table.read = proc_read;
+    Proc_Op_table.write = proc_write;
+    Proc_Op_table.close = proc_close;
+    Proc_Op_table.readv = NULL;
+    Proc_Op_table.writev = NULL;
+    Proc_Op_table.ioctl = NULL;
+    Proc_Op_table.poll = NULL;
+}
 
 int32_t init_test_PCB(){
     int cur_pid = get_current_pid();
     pcb_t* current_pcb = get_pcb(cur_pid);
     file_des_t* FD_array =  current_pcb->file_des_array;
     init_fd_array(FD_array);
+    // the tests pass kernel buffers to the system calls.
+    current_pcb->addr_limit = KERNEL_ADDR_LIMIT;
     return cur_pid;
 }
 
@@ -317,10 +758,12 @@ int init_fd_array(file_des_t* fd_array){
     fd_array[0].file_op_table_ptr = &Terminal_table;
     fd_array[0].file_pos = 0;
     fd_array[0].flag = 1;
+    fd_array[0].f_flags = 0;
     fd_array[0].inode_num = 0;
     // stdout FD
     fd_array[1].file_op_table_ptr = &Terminal_table;
     fd_array[1].flag = 1;
+    fd_array[1].f_flags = 0;
     fd_array[1].inode_num = 0;
     fd_array[1].file_pos = 0;
 
@@ -329,6 +772,7 @@ int init_fd_array(file_des_t* fd_array){
         fd_array[i].file_pos = 0;
         fd_array[i].inode_num = 0;
         fd_array[i].flag = 0;
+        fd_array[i].f_flags = 0;
         fd_array[i].file_op_table_ptr = NULL;
     }
 
@@ -376,5 +820,6 @@ int init_fop_table(){
     init_File_operations_table();
     init_Directory_operations_table();
     init_Rtc_operations_table();
+    init_Proc_table();
     return 0;
 }
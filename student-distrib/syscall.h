@@ -3,6 +3,11 @@
 
 
 #include "types.h"
+#include "Signals.h"
+#include "waitq.h"
+#include "vga.h"
+#include "fpu.h"
+#include "timer.h"
 
 #define MAX_FD 8
 #define MIN_FD 2
@@ -18,11 +23,55 @@
 
 #define VIDEO_MM 0x8800000
 
+#define IOV_MAX 16                          // max segments in one readv/writev.
+
+#define O_NONBLOCK  0x1                     // read/write return -1 instead of sleeping.
+
+#define FIONBIO     0x5421                  // ioctl: arg 1 sets O_NONBLOCK, 0 clears it.
+
+#define POLLIN      0x0001                  // data to read.
+#define POLLOUT     0x0004                  // write will not sleep.
+#define POLLERR     0x0008
+#define POLLNVAL    0x0020                  // fd not open.
+#define POLL_MAX_QUEUE  8                   // wait queues one poll may sleep on.
+
+/* one segment for the vectored read/write. */
+typedef struct iovec{
+    void*   iov_base;                       // segment start.
+    int32_t iov_len;                        // segment length in bytes.
+} iovec_t;
+
+/* one entry of the poll array. */
+typedef struct pollfd{
+    int32_t fd;
+    int16_t events;                         // what the caller waits for.
+    int16_t revents;                        // what is ready, filled by poll.
+} pollfd_t;
+
+/* time given by gettime. */
+typedef struct timespec{
+    uint32_t tv_sec;
+    uint32_t tv_nsec;
+} timespec_t;
+
+/* wait queues collected by the poll handlers of the files. */
+typedef struct poll_table{
+    int32_t       count;
+    wait_queue_t* queue[POLL_MAX_QUEUE];
+} poll_table_t;
+
 typedef struct file_operation{
     int32_t (*read)(int32_t fd, void* buf, int32_t nbytes);
     int32_t (*write)(int32_t fd, const void* buf, int32_t nbytes);
     int32_t (*open)(const uint8_t* filename);
     int32_t (*close)(int32_t fd);
+    // vectored version. NULL means loop over read/write one segment at a time.
+    int32_t (*readv)(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+    int32_t (*writev)(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+    // device control. NULL when the file takes no commands.
+    int32_t (*ioctl)(int32_t fd, int32_t cmd, int32_t arg);
+    // ready mask, and poll_wait on the queues that change it. NULL means always ready.
+    int32_t (*poll)(int32_t fd, poll_table_t* pt);
 } file_operation_table_t;
 
 
@@ -32,6 +81,7 @@ typedef struct file_des{
     uint32_t inode_num;
     uint32_t file_pos;
     uint32_t flag;
+    uint32_t f_flags;                       // O_NONBLOCK.
 } file_des_t;
 
 
@@ -45,6 +95,13 @@ typedef struct pcb{
     uint32_t tss_esp0;                      // ker
     uint32_t user_eip;
     uint32_t user_esp;
+    uint32_t addr_limit;                    // user pointers must end below this.
+    uint32_t sig_pending;                   // one bit for each pending signal.
+    uint32_t sig_masked;                    // set while a handler runs.
+    void*    sig_handler[NUM_SIGNALS];      // user handlers, NULL for the default action.
+    uint32_t state;                         // TASK_RUNNING or TASK_SLEEPING.
+    ktimer_t wake_timer;                    // wakes the process when a sleep times out.
+    fpu_state_t fpu;                        // saved x87/SSE registers, see fpu.c.
 
     uint8_t arg[BUFFER_SIZE];
 } pcb_t;
@@ -53,6 +110,7 @@ file_operation_table_t File_Op_table;
 file_operation_table_t RTC_Op_table;
 file_operation_table_t Directory_Op_table;
 file_operation_table_t Terminal_table;            // for stdio use.
+file_operation_table_t Proc_Op_table;             // for kernel generated files.
 
 extern void syscall_handler();
 
@@ -81,12 +139,42 @@ int32_t getargs(const void* buf, int32_t nbytes);
 int32_t vidmap(uint32_t** screen_start); // ????????int32 or int8????
 int vid_remap(uint8_t* address);
 
+// map the text page or the graphics back buffer
+int32_t vidmap_ex(uint8_t** screen_start, int32_t mode);
+
+// show the changed part of the back buffer
+int32_t vidflush(const gfx_rect_t* rects, int32_t n);
+
 // set handler
 int32_t set_handler(int32_t signum, void* handler_address);
 
 // sigreturn
 int32_t sigreturn(void);
 
+// vectored read
+int32_t readv(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+
+// vectored write
+int32_t writev(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+
+// device control
+int32_t ioctl(int32_t fd, int32_t cmd, int32_t arg);
+
+// wait for several files
+int32_t poll(pollfd_t* fds, int32_t nfds, int32_t timeout);
+
+// monotonic time since boot
+int32_t gettime(timespec_t* ts);
+
+// give the CPU away for a time
+int32_t sleep(int32_t ms);
+
+// register a wait queue for poll.
+void poll_wait(poll_table_t* pt, wait_queue_t* wq);
+
+// check the O_NONBLOCK flag of a fd of the current process.
+int32_t fd_nonblock(int32_t fd);
+
 /*-----------------helper functions---------------*/
 pcb_t* get_pcb(int32_t pid);
 
@@ -98,6 +186,8 @@ void init_Directory_operations_table();
 
 void init_Terminal_table();
 
+void init_Proc_table();
+
 int32_t init_test_PCB();
 
 int init_fd_array(file_des_t* fd_array);
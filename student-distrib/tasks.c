@@ -9,15 +9,21 @@
 #include "x86_desc.h"
 #include "lib.h"
 #include "Terminal.h"
+#include "uaccess.h"
+#include "smp.h"
+#include "fpu.h"
 
 #define SUCCESS  0
 #define FAILURE -1
 
-volatile int pid_map[6] = {0,0,0,0,0,0};
+volatile int pid_map[MAX_PROCESS] = {0};
 
-volatile int cur_pid = -1;
+// the process running on this CPU.
+#define current_pid     (this_cpu()->pid)
+#define current_pcb     (this_cpu()->pcb)
 
-volatile pcb_t* cur_pcb = NULL;
+// pid_map and the process of each terminal.
+static spinlock_t exec_lock = SPIN_LOCK_UNLOCKED;
 
 /*
  *  execute_task
@@ -38,49 +44,51 @@ int execute_task(const uint8_t* cmd, int target_num){
 
     int parent_pid;
     int next_pid;
+    uint32_t flags;
 
     // parse command before next check.
 
-    cli();
+    spin_lock_irqsave(&exec_lock, flags);
 
     if (cmd == NULL){
-        sti();
+        spin_unlock_irqrestore(&exec_lock, flags);
         return FAILURE;
     }
-    if (target_num < 0 || target_num > 3){
-        sti();
+    if (target_num < 0 || target_num >= terminal_count){
+        spin_unlock_irqrestore(&exec_lock, flags);
         return FAILURE;
     }
     if (parse_argument(cmd,filename,argument) == FAILURE){
-        sti();
+        spin_unlock_irqrestore(&exec_lock, flags);
         return FAILURE;
     }
 
     // check for File's magic number.
     if(read_dentry_by_name(filename,&current_dentry)==FAILURE){
-        sti();
+        spin_unlock_irqrestore(&exec_lock, flags);
         return FAILURE;
     }
 
     if (current_dentry.type != TYPE_FILE){
-        sti();
+        spin_unlock_irqrestore(&exec_lock, flags);
         return FAILURE;
     }
 
     if (read_data(current_dentry.inode_num,0,magic_buffer,4)!=FAILURE){
         if (magic_buffer[0] != 0x7F || magic_buffer[1] != 0x45 ||
             magic_buffer[2] != 0x4C || magic_buffer[3] != 0x46){
-            sti();
+            spin_unlock_irqrestore(&exec_lock, flags);
             return FAILURE;
         }
     } else{
+        spin_unlock_irqrestore(&exec_lock, flags);
         return FAILURE;
     }
 
     // try to allocate new PID.
     next_pid = create_new_pid();
     if (next_pid == FAILURE){
-        sti();
+        spin_unlock_irqrestore(&exec_lock, flags);
         printf("Process Full. \n ");
         return FAILURE;
     }
@@ -90,7 +98,7 @@ int execute_task(const uint8_t* cmd, int target_num){
 
     // load the file into given user pages. PROGRAM_ADDR to the kernel space
     if (read_exe_file(filename)== FAILURE){
-        sti();
+        spin_unlock_irqrestore(&exec_lock, flags);
         return FAILURE;
     }
     // load the pid into the given terminal.
@@ -98,21 +106,24 @@ int execute_task(const uint8_t* cmd, int target_num){
     parent_pid = execute_terminal->cur_pid;
     execute_terminal->cur_pid = next_pid;
 
+    // the FPU registers of the parent are saved before the child can touch them.
+    fpu_switch_out();
+
     // INIT the PCB.
-    cur_pcb = init_pcb(next_pid,parent_pid);
+    current_pcb = init_pcb(next_pid,parent_pid);
 
-    strncpy((int8_t*)cur_pcb->arg, (int8_t*)argument, BUFFER_SIZE);
+    strncpy((int8_t*)current_pcb->arg, (int8_t*)argument, BUFFER_SIZE);
 
     // set the TSS: change to the stack pointer.
 
-    tss.esp0 = cur_pcb->tss_esp0;
-    tss.ss0 = KERNEL_DS;
+    this_cpu()->tss->esp0 = current_pcb->tss_esp0;
+    this_cpu()->tss->ss0 = KERNEL_DS;
 
-    cur_pid = next_pid;
+    current_pid = next_pid;
 
     // set the esp and ebp in the pcb.
-    if (cur_pcb->parent_pid != -1) {
-        last_pcb = get_pcb(cur_pcb->parent_pid);
+    if (current_pcb->parent_pid != -1) {
+        last_pcb = get_pcb(current_pcb->parent_pid);
 
         // move the esp and ebp into the pcb.
         asm volatile(
@@ -122,8 +133,8 @@ int execute_task(const uint8_t* cmd, int target_num){
         );
     }
 
-    // go to ring 3.
-
+    // go to ring 3. the interrupts stay off until the iret.
+    spin_unlock(&exec_lock);
     goto_user_level();
 
     return SUCCESS;
@@ -132,18 +143,21 @@ int execute_task(const uint8_t* cmd, int target_num){
 /*
  *  halt_task
  *      DESCRIPTION: halt the task with the given PID, return to parent process.
- *      INPUT: status: the address to be return.
+ *      INPUT: status: the value execute returns. 256 for a process killed by a signal.
  *      OUTPUT: None.
  *      RETURN: 0 for success.
  *      SIDE EFFECT: RETURN to parent process.
  */
-int halt_task(uint8_t status){
+int halt_task(uint32_t status){
     int32_t fd;
 
     file_des_t* fd_array;   /* current fd array. */
 
     cli();
 
+    // the parent loads its own FPU state at its next use.
+    fpu_switch_out();
+
     fd_array = get_fd_array();
 
     /* close related files, clear the fd array */
@@ -155,40 +169,48 @@ int halt_task(uint8_t status){
         fd++;
     }
 
+    /* the parent reads lines again, even if the program left the terminal raw */
+    ldisc_set_mode((ldisc_t*)&handle_term->ldisc, TTY_COOKED);
+    /* and writes in the default colors, even if the program died in a sequence */
+    terminal_reset((terminal_t*)handle_term);
+
+    /* the screen goes back to text if it was drawing for this process */
+    gfx_release(current_pid);
+
     /* restart the base shell if halting it */
-    if(cur_pcb->parent_pid == -1){
+    if(current_pcb->parent_pid == -1){
         sti();
-        pid_map[cur_pid] = 0;
-        cur_pid = -1;
+        pid_map[current_pid] = 0;
+        current_pid = -1;
         handle_term->cur_pid = -1;
         // the pit will restart the terminal.
         execute((uint8_t*)"shell");     /* restart the base shell */
     }
     else {
         /* restore parent paging */
-        set_task_page(cur_pcb->parent_pid);
+        set_task_page(current_pcb->parent_pid);
 
         /* restore tss's kernel stack registers */
-        tss.ss0 = KERNEL_DS;
-        tss.esp0 = KERNEL_BOTTOM - KERNEL_STACK_SIZE * cur_pcb->parent_pid - 4; /* 4-byte for int32_t */
+        this_cpu()->tss->ss0 = KERNEL_DS;
+        this_cpu()->tss->esp0 = get_pcb(current_pcb->parent_pid)->tss_esp0;   /* top of the parent kernel stack */
 
         /* switch current process to parent process */
         // free the bitmap for process.
-        pid_map[cur_pid] = 0;
-        cur_pid = cur_pcb->parent_pid;
-        cur_pcb = get_pcb(cur_pid);
+        pid_map[current_pid] = 0;
+        current_pid = current_pcb->parent_pid;
+        current_pcb = get_pcb(current_pid);
+        handle_term->cur_pid = current_pid;
 
         sti();
         /* restore parent's esp and ebp, ready to return back */
         asm volatile(
         "movl   %0, %%esp   ;"     /* restore %esp */
         "movl   %1, %%ebp   ;"     /* restore %ebp */
-        "movl   $0, %%eax   ;"
-        "movb   %2, %%al    ;"     /* return status */
+        "movl   %2, %%eax   ;"     /* return status */
         "leave              ;"
         "ret                ;"     /*need to jump to execute return */
         : /* no output */
-        : "r" (cur_pcb->exec_esp), "r" (cur_pcb->exec_ebp), "r" (status)
+        : "r" (current_pcb->exec_esp), "r" (current_pcb->exec_ebp), "r" (status)
         : "esp", "ebp", "eax"
         );
     }
@@ -209,33 +231,41 @@ int halt_task(uint8_t status){
 int task_switch(int next_term_id){
     pcb_t* next_pcb;
     terminal_t* next_terminal;
-    // check if the current status is valid.
-    // wait for first execute to activate the task switch.
-    if (cur_pid == -1||cur_pcb == NULL){
-        return FAILURE;
-    }
-    if (next_term_id == -1|| next_term_id == handle_term->terminalID){
-        // no next process. do nothing.
+    // an idle AP has no process to save, it leaves its idle stack for good.
+    if (handle_term != NULL){
+        // check if the current status is valid.
+        // wait for first execute to activate the task switch.
+        if (current_pid == -1||current_pcb == NULL){
+            return FAILURE;
+        }
+        if (next_term_id == -1|| next_term_id == handle_term->terminalID){
+            // no next process. do nothing.
+            return SUCCESS;
+        }
+        // the FPU state goes with the process, it may run on another CPU next.
+        fpu_switch_out();
+
+        // store the current terminal info.
+        handle_term->cur_pid = current_pid;//store the pid information of zhiqian yunxingde terminal (save to the list(will restore in the next execute))
+
+        // store current stack info.
+        asm volatile(
+        "movl %%ebp, %0;"
+        "movl %%esp, %1;"
+        : "=r"(current_pcb->exec_ebp), "=r"(current_pcb->exec_esp)
+        );
+        current_pcb->tss_esp0 = this_cpu()->tss->esp0;
+    } else if (next_term_id == -1){
         return SUCCESS;
     }
-    // store the current terminal info.
-    handle_term->cur_pid = cur_pid;//store the pid information of zhiqian yunxingde terminal (save to the list(will restore in the next execute))
     next_terminal = get_terminal(next_term_id);//find the terminal will execute now
     next_pcb = get_pcb(next_terminal->cur_pid);//find the pcb of the terminal execute now
 
-    // store current stack info.
-    asm volatile(
-    "movl %%ebp, %0;"
-    "movl %%esp, %1;"
-    : "=r"(cur_pcb->exec_ebp), "=r"(cur_pcb->exec_esp)
-    );
-    cur_pcb->tss_esp0 = tss.esp0;
-
     // update local variables
     handle_term = next_terminal;
 
     // check if the terminal has valid process running.
-    if (handle_term->cur_pid < 0 || handle_term->cur_pid > 5){
+    if (handle_term->cur_pid < 0 || handle_term->cur_pid >= MAX_PROCESS){
         if (handle_term->cur_pid == -1){
             // run new shell on the terminal, but not chain it into the terminal chain.
             printf("Current located in TTY %d. \n",handle_term->terminalID+1);
@@ -244,18 +274,19 @@ int task_switch(int next_term_id){
             return FAILURE;
         }
     } else{
-        cur_pid = handle_term->cur_pid;//update the global variable(to execute the current terminal)
-        cur_pcb = next_pcb;
-        // load next stack info.
+        current_pid = handle_term->cur_pid;//update the global variable(to execute the current terminal)
+        current_pcb = next_pcb;
+        // load next stack info. only the per CPU state is used after this, the locals
+        // belong to the other stack.
         asm volatile(
         "movl %0, %%esp;"
         "movl %1, %%ebp;"
         :
-        : "r"(cur_pcb->exec_esp), "r"(cur_pcb->exec_ebp)
+        : "r"(current_pcb->exec_esp), "r"(current_pcb->exec_ebp)
         : "esp", "ebp"
         );
-        tss.esp0 = cur_pcb->tss_esp0;
-        tss.ss0 = KERNEL_DS;
+        this_cpu()->tss->esp0 = current_pcb->tss_esp0;
+        this_cpu()->tss->ss0 = KERNEL_DS;
 
     }
 
@@ -325,13 +356,14 @@ int parse_argument(const uint8_t* cmd, uint8_t* cmd_buffer, uint8_t* arg_buffer)
 int set_task_page(int pid){
     // set pages.
     uint32_t phys_addr = (2 + pid)*SIZE_4MB;                                     //start at 8MB-12MB, one process one page
-    page_directory[User_Level_Programs_Index].Page_addr = phys_addr/SIZE_4KB;   // >> 12 bits.(map the virtual memory 128MB-132MB to the current program physicle paging.)
-    page_directory[User_Level_Programs_Index].PS = 1;
-    page_directory[User_Level_Programs_Index].P  = 1;
-    page_directory[User_Level_Programs_Index].US = 1;
-    page_directory[User_Level_Programs_Index].PWT = 0;
-    page_directory[User_Level_Programs_Index].PCD = 0;
-    page_directory[User_Level_Programs_Index].G = 0;
+    directory_entry_t* page_dir = cpu_page_directory();                         // each CPU maps its own process.
+    page_dir[User_Level_Programs_Index].Page_addr = phys_addr/SIZE_4KB;   // >> 12 bits.(map the virtual memory 128MB-132MB to the current program physicle paging.)
+    page_dir[User_Level_Programs_Index].PS = 1;
+    page_dir[User_Level_Programs_Index].P  = 1;
+    page_dir[User_Level_Programs_Index].US = 1;
+    page_dir[User_Level_Programs_Index].PWT = 0;
+    page_dir[User_Level_Programs_Index].PCD = 0;
+    page_dir[User_Level_Programs_Index].G = 0;
     tlb_flush();
     return SUCCESS;
 }
@@ -348,21 +380,16 @@ int create_new_pid(){
 
     int next_pid;
 
-    if(cur_pid == -1){
-        pid_map[0] = 1;
-        return 0;
-
-    } else{
-        for(next_pid=0;next_pid < 6;next_pid++){
-            if (pid_map[next_pid] == 0){
-                pid_map[next_pid] = 1;
-                return next_pid;
-            }
+    // an idle CPU or a restarted base shell has no current pid, the map decides alone.
+    for(next_pid=0;next_pid < MAX_PROCESS;next_pid++){
+        if (pid_map[next_pid] == 0){
+            pid_map[next_pid] = 1;
+            return next_pid;
         }
-
-        printf("Too many process. Try again later.\n");
-        return FAILURE;
     }
+
+    printf("Too many process. Try again later.\n");
+    return FAILURE;
 }
 
 /*
@@ -392,6 +419,21 @@ pcb_t* init_pcb(int next_pid, int parent_pid){
     // map the user address into virtual address: 132MB!
     pcb->user_esp = USER_ADDR+USER_STACK_SIZE-sizeof(uint32_t);
 
+    // user pointers must stay in the program page.
+    pcb->addr_limit = USER_ADDR_LIMIT;
+
+    // no signal pending, all default actions.
+    pcb->sig_pending = 0;
+    pcb->sig_masked = 0;
+    memset(pcb->sig_handler, 0, sizeof(pcb->sig_handler));
+
+    // not waiting on anything.
+    pcb->state = TASK_RUNNING;
+    init_timer(&pcb->wake_timer, process_timeout, next_pid);
+
+    // the FPU starts from the boot state at the first use.
+    pcb->fpu.valid = 0;
+
     return pcb;
 }
 
@@ -435,14 +477,18 @@ int goto_user_level(){
     // Load into Register.
     uint32_t ESP = VIRTUAL_MAP_END;
     uint32_t EIP = *(uint32_t*)((uint8_t*)PROGRAM_ADDR + 24);
-    cur_pcb->user_eip = EIP;
-    sti();
+    current_pcb->user_eip = EIP;
+
+    // leave the kernel with the interrupts off, the iret turns them on.
+    cli();
+    kernel_exit();
 
     asm volatile(
     "movw  %%ax, %%ds;"
     "pushl %%eax;"
     "pushl %%ebx;"
     "pushfl     ;"
+    "orl   $0x200, (%%esp);"
     "pushl %%ecx;"
     "pushl %%edx;"
     "iret"
@@ -471,10 +517,10 @@ pcb_t* get_pcb_block(uint32_t pid){
   *     DESCRIPTION: return the current pid.
   *     INPUT: None.
   *     OUTPUT: None.
-  *     RETURN: cur_pid recorded in this file.
+  *     RETURN: pid running on this CPU.
   *     SIDE EFFECT:None.
   */
  int get_current_pid(){
-     return cur_pid;
+     return current_pid;
  }
 
@@ -19,13 +19,14 @@
 #define PROGRAM_ADDR        0x08048000      // given entry point.
 #define PROGRAM_START       PROGRAM_ADDR+24 // same entry for all program.
 
+#define MAX_PROCESS         16          // a shell on each of 12 terminals and a few programs.
 #define MAX_FILENAME_LENGTH 32
 #define User_Level_Programs_Index 32        // 128MB/4MB = 32
 // PCB struct from syscall.h
 
 /* main execute function. */
 int execute_task(const uint8_t* cmd,int target_num);
-int halt_task(uint8_t status);
+int halt_task(uint32_t status);
 int task_switch(int next_term_id);
 
 /* read arguments */
@@ -10,6 +10,16 @@
 #include "filesystem.h"
 #include "syscall.h"
 #include "tasks.h"
+#include "uaccess.h"
+#include "apic.h"
+#include "smp.h"
+#include "softirq.h"
+#include "irq.h"
+#include "scheduler.h"
+#include "fpu.h"
+#include "clock.h"
+#include "timer.h"
+#include "boottime.h"
 
 #define PASS 1
 #define FAIL 0
@@ -607,6 +617,897 @@ int test_syscall_read_write_new(){
     
 }
 
+/* Vectored read/write test
+ *
+ * Asserts that writev prints all segments and readv fills them in order
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Prints to the terminal
+ * Coverage: readv, writev, file_readv, terminal_writev
+ * Files: syscall.c, filesystem.c, Terminal.c
+ */
+int test_syscall_readv_writev(){
+    TEST_HEADER;
+
+    char head[4];
+    char rest[8];
+    char whole[12];
+    iovec_t out[3] = {{"read", 4}, {"v/", 2}, {"writev\n", 7}};
+    iovec_t in[2]  = {{head, 4}, {rest, 8}};
+    int32_t fd;
+
+    init_test_PCB();
+    if (writev(1, out, 3) != 13){
+        return FAIL;
+    }
+
+    // the two segments should hold the same bytes as one plain read.
+    fd = open((uint8_t*)"frame0.txt");
+    if (readv(fd, in, 2) != 12){
+        return FAIL;
+    }
+    close(fd);
+    fd = open((uint8_t*)"frame0.txt");
+    read(fd, whole, 12);
+    close(fd);
+    if (strncmp(head, whole, 4) || strncmp(rest, whole + 4, 8)){
+        return FAIL;
+    }
+
+    // bad segment counts are refused.
+    if (writev(1, out, 0) != -1 || writev(1, out, IOV_MAX + 1) != -1){
+        return FAIL;
+    }
+    return PASS;
+}
+
+/* Syscall trace file test
+ *
+ * Asserts that the trace files open like normal files and show the calls
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: proc lookup, proc read, trace histogram
+ * Files: proc.c, trace.c
+ */
+int test_syscall_trace(){
+    TEST_HEADER;
+
+    char buffer[200];
+    dentry_t dentry;
+    int32_t fd;
+
+    init_test_PCB();
+    if (read_dentry_by_name((uint8_t*)"syslat", &dentry) || dentry.type != TYPE_PROC){
+        return FAIL;
+    }
+    fd = open((uint8_t*)"systrace");
+    if (fd == -1 || read(fd, buffer, 199) <= 0){
+        return FAIL;
+    }
+    // writing a bad command is refused, the file stays readable.
+    if (write(fd, "bogus", 5) != -1){
+        return FAIL;
+    }
+    close(fd);
+    return PASS;
+}
+
+/* Syscall argument test
+ *
+ * Asserts that a system call made by int $0x80 gets all three arguments,
+ * with the syscall trace on the way in
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: writes a line to the terminal
+ * Coverage: syscall_handler, trace_syscall_enter, write
+ * Files: syscall_sup.S, trace.c
+ */
+int test_syscall_args(){
+    TEST_HEADER;
+
+    const char* line = "syscall args ok\n";
+    int32_t ret;
+
+    init_test_PCB();
+    asm volatile ("int $0x80"
+                  : "=a"(ret)
+                  : "a"(4), "b"(1), "c"(line), "d"(16)
+                  : "memory", "cc");
+    return (ret == 16) ? PASS : FAIL;
+}
+
+/* User copy test
+ *
+ * Asserts that bad user pointers are refused and that a faulting copy comes back short
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: access_ok, copy_to_user, page fault fixup
+ * Files: uaccess.c, uaccess_sup.S, idt.c
+ */
+int test_user_copy(){
+    TEST_HEADER;
+
+    char buffer[8] = "abcdefg";
+    pcb_t* cur_pcb = get_pcb(init_test_PCB());
+    int result = PASS;
+
+    // with the user limit only the program page is allowed.
+    cur_pcb->addr_limit = USER_ADDR_LIMIT;
+    if (access_ok((void*)KERNEL_ADDR, 4) || !access_ok((void*)USER_ADDR, 4) ||
+        access_ok((void*)(USER_ADDR_LIMIT-2), 4) || copy_to_user((void*)VIDEO_ADDR, buffer, 8) != 8){
+        result = FAIL;
+    }
+    cur_pcb->addr_limit = KERNEL_ADDR_LIMIT;
+
+    // the first page is not present, the fixup ends the copy.
+    if (__copy_user((void*)0x10, buffer, 8) != 8){
+        result = FAIL;
+    }
+    return result;
+}
+
+/* Signal send test
+ *
+ * Asserts that signals are marked pending and bad signals are refused
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: clears the signal state of pid 0
+ * Coverage: signal_send, set_handler
+ * Files: Signals.c
+ */
+int test_signal_send(){
+    TEST_HEADER;
+
+    pcb_t* pcb = get_pcb(0);
+    int result = PASS;
+
+    pcb->sig_pending = 0;
+    if (signal_send(0, INTERRUPT) || pcb->sig_pending != (1 << INTERRUPT)){
+        result = FAIL;
+    }
+    if (signal_send(0, NUM_SIGNALS) != -1 || signal_send(MAX_PROCESS, ALARM) != -1 ||
+        set_handler(NUM_SIGNALS, NULL) != -1){
+        result = FAIL;
+    }
+    pcb->sig_pending = 0;
+    return result;
+}
+
+/* Poll test
+ *
+ * Asserts that a non blocking read does not wait and poll reports the fds
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: interrupts are on after it
+ * Coverage: ioctl FIONBIO, rtc_read, rtc_poll, poll
+ * Files: syscall.c, RTC.c
+ */
+int test_syscall_poll(){
+    TEST_HEADER;
+
+    int32_t fd, value;
+    pollfd_t pfd;
+    int result = PASS;
+
+    init_test_PCB();
+    fd = open((uint8_t*)"rtc");
+    if (fd == -1 || ioctl(fd, FIONBIO, 1) != 0 || ioctl(MAX_FD-1, FIONBIO, 1) != -1){
+        return FAIL;
+    }
+    // no interrupt can come with IF off, so the second read finds nothing.
+    cli();
+    read(fd, &value, 4);
+    if (read(fd, &value, 4) != -1){
+        result = FAIL;
+    }
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 0) != 0 || pfd.revents != 0){
+        result = FAIL;
+    }
+    // an unused fd is reported, not refused.
+    pfd.fd = MAX_FD-1;
+    if (poll(&pfd, 1, 0) != 1 || pfd.revents != POLLNVAL){
+        result = FAIL;
+    }
+    ioctl(fd, FIONBIO, 0);
+    close(fd);
+    return result;
+}
+
+/* Terminal render test
+ *
+ * Asserts that a batch of chars marks its lines dirty and lands in the buffer of a hidden terminal
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: clobbers the first rows of terminal 2
+ * Coverage: terminal_putn, terminal_flush, cursor marking
+ * Files: lib.c, Terminal.c
+ */
+int test_terminal_render(){
+    TEST_HEADER;
+
+    volatile terminal_t* saved = handle_term;
+    terminal_t* term = get_terminal(2);
+    uint16_t* cells = (uint16_t*)term->video_ptr;
+    int result = PASS;
+
+    if (cur_terminal_id == 2){
+        return FAIL;
+    }
+    cli();
+    handle_term = term;
+    terminal_flush(term);
+    term->cursor_x = 0;
+    term->cursor_y = 0;
+    terminal_putn((uint8_t*)"ab\ncx\bd", 8);
+    if (term->dirty_rows != 0x3){
+        result = FAIL;
+    }
+    terminal_flush(term);
+    if (term->dirty_rows != 0 || !term->cursor_dirty || (cells[0] & 0xFF) != 'a' || (cells[1] & 0xFF) != 'b' ||
+        (cells[SCREEN_WIDTH] & 0xFF) != 'c' || (cells[SCREEN_WIDTH+1] & 0xFF) != 'd' ||
+        term->cursor_x != 2 || term->cursor_y != 1){
+        result = FAIL;
+    }
+    handle_term = saved;
+    sti();
+    return result;
+}
+
+/* Scrollback test
+ *
+ * Asserts that lines come back from the history as they went in and old lines are dropped
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: scrollback_push, scrollback_get
+ * Files: scrollback.c
+ */
+int test_scrollback(){
+    TEST_HEADER;
+
+    static scrollback_t sb;
+    uint16_t line[SCROLLBACK_COLS];
+    uint16_t out[SCROLLBACK_COLS];
+    int i;
+
+    scrollback_init(&sb);
+    memset_word(line, BLANK_CELL, SCROLLBACK_COLS);
+    for (i = 0; i < SCROLLBACK_LINES + 5; i++){
+        line[0] = (TEXT_ATTRIB << 8) | ('a' + i % 26);
+        scrollback_push(&sb, line);
+    }
+    // a blank tail costs one run, so the line limit is hit first.
+    if (sb.count != SCROLLBACK_LINES || scrollback_get(&sb, sb.count, out) != -1){
+        return FAIL;
+    }
+    scrollback_get(&sb, sb.count - 1, out);
+    for (i = 0; i < SCROLLBACK_COLS; i++){
+        if (out[i] != line[i]){
+            return FAIL;
+        }
+    }
+    scrollback_get(&sb, 0, out);
+    if ((out[0] & 0xFF) != 'a' + 5 % 26 || out[1] != BLANK_CELL){
+        return FAIL;
+    }
+    return PASS;
+}
+
+/* Line discipline test
+ *
+ * Asserts that cooked mode gives whole edited lines and raw mode gives single keys
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: echoes a few chars on the screen
+ * Coverage: ldisc_input, ldisc_read, ldisc_set_mode
+ * Files: ldisc.c
+ */
+int test_ldisc(){
+    TEST_HEADER;
+
+    static ldisc_t ld;
+    uint8_t buf[LDISC_LINE_MAX];
+    int result = PASS;
+
+    ldisc_init(&ld);
+    // "ab<bs>c" then enter gives "ac\n" and nothing before the enter.
+    if (ldisc_input(&ld, 'a') || ldisc_input(&ld, 'b') || ldisc_input(&ld, '\b') ||
+        ldisc_input(&ld, 'c') || ldisc_ready(&ld) || !ldisc_input(&ld, '\n')){
+        result = FAIL;
+    }
+    if (ldisc_read(&ld, buf, LDISC_LINE_MAX) != 3 || strncmp((int8_t*)buf, "ac\n", 3)){
+        result = FAIL;
+    }
+    // raw keys are ready one by one.
+    ldisc_set_mode(&ld, LDISC_RAW);
+    if (!ldisc_input(&ld, 'x') || !ldisc_input(&ld, '\b') ||
+        ldisc_read(&ld, buf, LDISC_LINE_MAX) != 2 || buf[0] != 'x' || buf[1] != '\b'){
+        result = FAIL;
+    }
+    if (ldisc_set_mode(&ld, 7) != -1){
+        result = FAIL;
+    }
+    return result;
+}
+
+/* ANSI escape test
+ *
+ * Asserts that escape sequences move the cursor, erase, color and scroll inside a region
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: clobbers the text of terminal 2
+ * Coverage: ansi_feed, terminal_escape, render
+ * Files: ansi.c, Terminal.c, lib.c
+ */
+int test_ansi(){
+    TEST_HEADER;
+
+    volatile terminal_t* saved = handle_term;
+    terminal_t* term = get_terminal(2);
+    int8_t* seq;
+    uint32_t history;
+    int result = PASS;
+
+    if (cur_terminal_id == 2){
+        return FAIL;
+    }
+    cli();
+    handle_term = term;
+    terminal_reset(term);
+    terminal_clear(term);
+    history = term->history->count;
+    // go to row 3 col 5, write red on blue.
+    seq = "\x1b[3;5H\x1b[31;44mab\x1b[0m";
+    terminal_putn((uint8_t*)seq, strlen(seq));
+    if (term->cursor_y != 2 || term->cursor_x != 6 || TERM_ROW(term, 2)[4] != ((0x14 << 8) | 'a') ||
+        term->attrib != TEXT_ATTRIB){
+        result = FAIL;
+    }
+    // clear to the end of the line from col 5, the 'a' stays.
+    seq = "\x1b[6Gxyz\x1b[6G\x1b[K";
+    terminal_putn((uint8_t*)seq, strlen(seq));
+    if ((TERM_ROW(term, 2)[4] & 0xFF) != 'a' || TERM_ROW(term, 2)[5] != BLANK_CELL ||
+        TERM_ROW(term, 2)[7] != BLANK_CELL){
+        result = FAIL;
+    }
+    // a line feed at the bottom of the region 2-4 scrolls only lines 2-4.
+    seq = "\x1b[2;4r\x1b[4;1Hq\nw";
+    terminal_putn((uint8_t*)seq, strlen(seq));
+    if (term->cursor_y != 3 || (TERM_ROW(term, 2)[0] & 0xFF) != 'q' || (TERM_ROW(term, 3)[0] & 0xFF) != 'w' ||
+        (TERM_ROW(term, 1)[4] & 0xFF) != 'a' || term->history->count != history){
+        result = FAIL;
+    }
+    // a control char cuts a sequence.
+    seq = "\x1b[1\n";
+    terminal_putn((uint8_t*)seq, strlen(seq));
+    if (term->esc.state != ANSI_GROUND){
+        result = FAIL;
+    }
+    terminal_reset(term);
+    terminal_clear(term);
+    terminal_flush(term);
+    handle_term = saved;
+    sti();
+    return result;
+}
+
+/* Formatting test
+ *
+ * Asserts that width, precision and the flags pad like the C library and a short buffer cuts the output
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: snprintf, format
+ * Files: lib.c
+ */
+int test_format(){
+    TEST_HEADER;
+
+    int8_t buf[48];
+    int result = PASS;
+
+    snprintf(buf, sizeof(buf), "[%5d|%-5d|%05d|%+d]", 42, 42, -42, 7);
+    if (strncmp(buf, "[   42|42   |-0042|+7]", sizeof(buf))){
+        result = FAIL;
+    }
+    snprintf(buf, sizeof(buf), "%#x %.3d %8.3x %-4s|%.2s", 0xE, 5, 0x1F, "ab", "xyz");
+    if (strncmp(buf, "0000000E 005      01F ab  |xy", sizeof(buf))){
+        result = FAIL;
+    }
+    if (snprintf(buf, 6, "%s", "hello world") != 11 || strncmp(buf, "hello", 6)){
+        result = FAIL;
+    }
+    return result;
+}
+
+/* Page pool test
+ *
+ * Asserts that pool pages are zeroed, mapped and reused after they are freed, and
+ * that runs of pages are contiguous free pages
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: page_alloc, pages_alloc, page_free
+ * Files: paging.c
+ */
+int test_page_pool(){
+    TEST_HEADER;
+
+    uint8_t* a = page_alloc();
+    uint8_t* b = page_alloc();
+    int result = PASS;
+
+    if (a == NULL || b == NULL || a == b || (uint32_t)a % SIZE_4KB != 0 ||
+        (uint32_t)a < PAGE_POOL_START || (uint32_t)b >= PAGE_POOL_END){
+        return FAIL;
+    }
+    if (a[0] != 0 || a[SIZE_4KB-1] != 0){
+        result = FAIL;
+    }
+    memset(a, 0x5A, SIZE_4KB);
+    page_free(a);
+    if (page_alloc() != a || a[SIZE_4KB-1] != 0){
+        result = FAIL;
+    }
+    // a run of pages goes around the used one, and is zeroed as a whole.
+    page_free(a);
+    a = pages_alloc(2);
+    if (a == NULL || a == b || a + SIZE_4KB == b || a[2*SIZE_4KB-1] != 0){
+        result = FAIL;
+    }
+    if (a != NULL){
+        page_free(a);
+        page_free(a + SIZE_4KB);
+    }
+    page_free(b);
+    return result;
+}
+
+/* Graphics rectangle test
+ *
+ * Asserts that rectangles are clipped to the screen and that vidflush is refused
+ * without the graphics mode
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None, the screen mode is not touched
+ * Coverage: gfx_clip, gfx_flush, vidflush
+ * Files: vga.c, syscall.c
+ */
+int test_gfx_rect(){
+    TEST_HEADER;
+
+    gfx_rect_t r;
+    int result = PASS;
+
+    // a rectangle hanging over the top left corner.
+    r.x = -10; r.y = -5; r.w = 20; r.h = 10;
+    if (!gfx_clip(&r) || r.x != 0 || r.y != 0 || r.w != 10 || r.h != 5){
+        result = FAIL;
+    }
+    // over the bottom right corner.
+    r.x = 310; r.y = 195; r.w = 50; r.h = 50;
+    if (!gfx_clip(&r) || r.w != GFX_WIDTH - 310 || r.h != GFX_HEIGHT - 195){
+        result = FAIL;
+    }
+    // outside, or empty.
+    r.x = GFX_WIDTH; r.y = 0; r.w = 4; r.h = 4;
+    if (gfx_clip(&r)){
+        result = FAIL;
+    }
+    r.x = 0; r.y = 0; r.w = 0; r.h = 4;
+    if (gfx_clip(&r)){
+        result = FAIL;
+    }
+    // nobody owns the graphics mode.
+    if (gfx_active() || vidflush(NULL, 0) != -1 || vidflush(NULL, GFX_MAX_RECTS+1) != -1){
+        result = FAIL;
+    }
+    return result;
+}
+
+/* IRQ mask test
+ *
+ * Asserts that disable_irq and enable_irq reach the interrupt controller in use,
+ * the IO-APIC entry with the 8259 vector or the cached 8259 mask
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: the keyboard is masked for a moment
+ * Coverage: enable_irq, disable_irq, apic_irq_entry
+ * Files: i8259.c, apic.c
+ */
+int test_irq_mask(){
+    TEST_HEADER;
+
+    int result = PASS;
+    uint32_t entry;
+
+    disable_irq(KB_IRQ);
+    if (apic_active){
+        if (!(apic_irq_entry(KB_IRQ) & IOAPIC_MASKED)){
+            result = FAIL;
+        }
+    } else if (!(master_mask & (1 << KB_IRQ)) || !(inb(PIC1_DATA) & (1 << KB_IRQ))){
+        result = FAIL;
+    }
+    enable_irq(KB_IRQ);
+    if (apic_active){
+        entry = apic_irq_entry(KB_IRQ);
+        if ((entry & IOAPIC_MASKED) || (entry & 0xFF) != KEYBOARD_VECTOR){
+            result = FAIL;
+        }
+    } else if ((master_mask & (1 << KB_IRQ)) || (inb(PIC1_DATA) & (1 << KB_IRQ))){
+        result = FAIL;
+    }
+    return result;
+}
+
+/* SMP state test
+ *
+ * Asserts that the tests run on the boot CPU with its own TSS and page directory,
+ * that the handled terminal is the one of this CPU and that a spinlock can be
+ * taken again after it is released
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: smp_processor_id, this_cpu, spin_lock, spin_unlock
+ * Files: smp.h, spinlock.h
+ */
+int test_smp_state(){
+    TEST_HEADER;
+
+    spinlock_t lock = SPIN_LOCK_UNLOCKED;
+    uint32_t flags;
+    int i, result = PASS;
+
+    if (smp_processor_id() != 0 || this_cpu() != &cpu_list[0] || this_cpu()->tss != &tss ||
+        cpu_page_directory() != page_directory || handle_term != cpu_list[0].term){
+        result = FAIL;
+    }
+    if (cpu_count < 1 || cpu_count > NR_CPUS){
+        result = FAIL;
+    }
+    for (i = 1; i < cpu_count; i++){
+        if (!cpu_list[i].online || cpu_list[i].id != i || cpu_list[i].page_dir == page_directory){
+            result = FAIL;
+        }
+    }
+    for (i = 0; i < 2; i++){
+        spin_lock_irqsave(&lock, flags);
+        if (!lock.locked){
+            result = FAIL;
+        }
+        spin_unlock_irqrestore(&lock, flags);
+    }
+    if (lock.locked){
+        result = FAIL;
+    }
+    return result;
+}
+
+/* tasklet test
+ *
+ * Asserts that a tasklet scheduled twice runs once, with interrupts on,
+ * and can be scheduled again after it ran
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: other queued tasklets run too
+ * Coverage: tasklet_schedule, do_softirq, in_softirq
+ * Files: softirq.c
+ */
+static int tasklet_runs;
+static int tasklet_if;
+static void test_tasklet_fn(uint32_t data){
+    uint32_t flags;
+    asm volatile("pushfl; popl %0" : "=r"(flags));
+    tasklet_runs += data;
+    tasklet_if = (flags & 0x200) && in_softirq();
+}
+int test_tasklet(){
+    TEST_HEADER;
+
+    DECLARE_TASKLET(t, test_tasklet_fn, 1);
+    uint32_t flags;
+    int result = PASS;
+
+    tasklet_runs = 0;
+    cli_and_save(flags);
+    tasklet_schedule(&t);
+    tasklet_schedule(&t);
+    if (!(t.state & TASKLET_SCHED)){
+        result = FAIL;
+    }
+    do_softirq();
+    if (tasklet_runs != 1 || !tasklet_if || t.state != 0 || in_softirq()){
+        result = FAIL;
+    }
+    tasklet_schedule(&t);
+    do_softirq();
+    restore_flags(flags);
+    if (tasklet_runs != 2){
+        result = FAIL;
+    }
+    return result;
+}
+
+/* interrupt stats test
+ *
+ * Asserts that every stub is in the IDT, the exceptions and the timer have
+ * their handlers, a timer tick is counted, and request_irq checks its input
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: interrupts are on for a moment
+ * Coverage: interrupt_stubs, do_IRQ, request_irq, irq_stat
+ * Files: Linkage.S, irq.c, idt.c
+ */
+int test_irq_stats(){
+    TEST_HEADER;
+
+    const irq_desc_t* timer = irq_stat(IRQ_VECTOR_BASE + PIT_IRQ);
+    uint32_t before, flags;
+    int i, result = PASS;
+
+    for (i = 0; i < NR_INTR_STUBS; i++){
+        if (!idt[i].present || (idt[i].offset_15_00 | (idt[i].offset_31_16 << 16)) != interrupt_stubs[i] ||
+            (i > 0 && interrupt_stubs[i] <= interrupt_stubs[i-1])){
+            result = FAIL;
+        }
+    }
+    if (irq_stat(14)->handler != page_fault || timer->handler == NULL || irq_stat(NR_INTR_STUBS) != NULL){
+        result = FAIL;
+    }
+    if (request_irq(NR_IRQS, pit_handler, "bad") != -1 || request_irq(PIT_IRQ, NULL, "bad") != -1){
+        result = FAIL;
+    }
+    before = timer->count[0];
+    cli_and_save(flags);
+    sti();
+    while (*(volatile uint32_t*)&timer->count[0] == before);
+    restore_flags(flags);
+    return result;
+}
+
+/* key map test
+ *
+ * Asserts that the key maps follow shift, caps lock and num lock, that ctrl
+ * and alt do not change the char, and that break codes give none
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: key_translate, key_map_init
+ * Files: keyboard.c
+ */
+int test_keymap(){
+    TEST_HEADER;
+
+    int result = PASS;
+
+    if (key_translate(0, KEY_A) != 'a' || key_translate(KB_SHIFT, KEY_A) != 'A' ||
+        key_translate(KB_CAPS, KEY_A) != 'A' || key_translate(KB_CAPS | KB_SHIFT, KEY_A) != 'a'){
+        result = FAIL;
+    }
+    if (key_translate(KB_CAPS, KEY_1) != '1' || key_translate(KB_SHIFT, KEY_1) != '!' ||
+        key_translate(0, KEY_ENTER) != '\n' || key_translate(KB_CTRL | KB_ALT, KEY_A) != 'a'){
+        result = FAIL;
+    }
+    if (key_translate(0, KEY_PAGEUP) != 0 || key_translate(KB_NUM, KEY_PAGEUP) != '9' ||
+        key_translate(KB_NUM | KB_SHIFT, 0x52) != '0' || key_translate(KB_NUM, 0x4A) != 0){
+        result = FAIL;
+    }
+    if (key_translate(0, KEY_A | 0x80) != 0 || key_translate(0, KEY_LEFTSHIFT) != 0){
+        result = FAIL;
+    }
+    return result;
+}
+
+/* lazy FPU test
+ *
+ * Asserts that the FPU is on with TS set, that the first use of a process
+ * gets the fninit state, and that a value in the registers survives a
+ * switch out and the next #NM
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: the pcb of this CPU is replaced for a moment
+ * Coverage: fpu_init, fpu_switch_out, fpu_trap
+ * Files: fpu.c
+ */
+static pcb_t fpu_test_pcb;
+int test_fpu(){
+    TEST_HEADER;
+
+    cpu_t* cpu = this_cpu();
+    volatile struct pcb* saved_pcb;
+    uint32_t flags, cr0;
+    uint64_t pi = 0;
+    int result = PASS;
+
+    cli_and_save(flags);
+    saved_pcb = cpu->pcb;
+    cpu->pcb = &fpu_test_pcb;
+    fpu_test_pcb.fpu.valid = 0;
+
+    asm volatile("movl %%cr0, %0" : "=r"(cr0));
+    if ((cr0 & (CR0_EM | CR0_MP | CR0_NE | CR0_TS)) != (CR0_MP | CR0_NE | CR0_TS)){
+        result = FAIL;
+    }
+    fpu_trap(NULL);
+    asm volatile("fldpi");
+    fpu_switch_out();
+    asm volatile("movl %%cr0, %0" : "=r"(cr0));
+    // FCW of the saved state is the fninit one, the pi went on top of it.
+    if (!(cr0 & CR0_TS) || !fpu_test_pcb.fpu.valid || *(uint16_t*)fpu_test_pcb.fpu.area != 0x037F){
+        result = FAIL;
+    }
+    fpu_trap(NULL);
+    asm volatile("fstpl %0" : "=m"(pi));
+    if (pi != 0x400921FB54442D18ULL){
+        result = FAIL;
+    }
+    fpu_switch_out();
+    cpu->pcb = saved_pcb;
+    restore_flags(flags);
+    return result;
+}
+
+/* clock and timer test
+ *
+ * Asserts that clock_ns moves forward, and that timers on level 0 and
+ * level 1 of the wheel fire once, after their tick, and not when deleted
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: interrupts are on for a few ticks
+ * Coverage: clock_ns, add_timer, mod_timer, del_timer, timer_tick
+ * Files: clock.c, timer.c
+ */
+static volatile uint32_t timer_test_fired[3];
+static void timer_test_func(uint32_t data){
+    timer_test_fired[data] = pit_ticks;
+}
+int test_clock_timers(){
+    TEST_HEADER;
+
+    ktimer_t timers[3];
+    uint64_t t0, t1;
+    uint32_t start, flags;
+    int i, result = PASS;
+
+    t0 = clock_ns();
+    t1 = clock_ns();
+    if (t1 < t0){
+        result = FAIL;
+    }
+    cli_and_save(flags);
+    start = pit_ticks;
+    for (i = 0; i < 3; i++){
+        timer_test_fired[i] = 0;
+        init_timer(&timers[i], timer_test_func, i);
+    }
+    timers[0].expires = start + 2;
+    add_timer(&timers[0]);
+    mod_timer(&timers[1], start + TVR_SIZE + 10);
+    mod_timer(&timers[2], start + 1);
+    if (!timer_pending(&timers[1]) || del_timer(&timers[2]) != 1 || del_timer(&timers[2]) != 0){
+        result = FAIL;
+    }
+    sti();
+    while (!timer_test_fired[0]);
+    if (timer_test_fired[0] < start + 2 || !timer_pending(&timers[1]) || timer_test_fired[1]){
+        result = FAIL;
+    }
+    // move the far timer close, it leaves level 1.
+    mod_timer(&timers[1], pit_ticks + 1);
+    while (!timer_test_fired[1]);
+    if (timer_pending(&timers[0]) || timer_pending(&timers[1]) || timer_test_fired[2]){
+        result = FAIL;
+    }
+    if (clock_ns() <= t1){
+        result = FAIL;
+    }
+    restore_flags(flags);
+    return result;
+}
+
+/* sleep test
+ *
+ * Asserts that a negative time is refused, and that a zero sleep returns at
+ * once with the process running and no wake timer left
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: sleep
+ * Files: syscall.c
+ */
+int test_sleep(){
+    TEST_HEADER;
+
+    pcb_t* pcb;
+    int result = PASS;
+
+    if (sleep(-1) != -1){
+        result = FAIL;
+    }
+    // the zero sleep needs a process for its pcb.
+    if (get_current_pid() >= 0){
+        pcb = get_pcb(get_current_pid());
+        if (sleep(0) != 0 || pcb->state != TASK_RUNNING || timer_pending(&pcb->wake_timer)){
+            result = FAIL;
+        }
+    }
+    return result;
+}
+
+/* crash record test
+ *
+ * Asserts that a fault without a handler is not turned into a signal, so it
+ * kills, that crash records exist for the pids only, and that an NMI and the
+ * user debug traps do not kill
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: signal_fault, crash_record
+ * Files: idt.c, Signals.c
+ */
+int test_crash_record(){
+    TEST_HEADER;
+
+    int32_t pid = get_current_pid();
+    hw_context_t regs;
+    int result = PASS;
+
+    if (crash_record(-1) != NULL || crash_record(MAX_PROCESS) != NULL || crash_record(0) == NULL){
+        result = FAIL;
+    }
+    if ((pid < 0 || pid >= MAX_PROCESS || get_pcb(pid)->sig_handler[SEGFAULT] == NULL) &&
+        signal_fault(SEGFAULT) != -1){
+        result = FAIL;
+    }
+    // an NMI, an int3 and a single step come back, with the single step off.
+    memset(&regs, 0, sizeof(regs));
+    regs.cs = KERNEL_CS;
+    raise_except_info(&regs, 0x02);
+    regs.cs = USER_CS;
+    regs.eflags = 0x0100;
+    raise_except_info(&regs, 0x03);
+    raise_except_info(&regs, 0x01);
+    if (regs.eflags & 0x0100){
+        result = FAIL;
+    }
+    return result;
+}
+
+/* boot time test
+ *
+ * Asserts that the boot phases were marked in order, each with a name and
+ * a TSC stamp not before the one of the phase ahead of it
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: boot_mark, boot_phase, boot_time_us
+ * Files: boottime.c
+ */
+int test_boot_time(){
+    TEST_HEADER;
+
+    const boot_phase_t* phase;
+    int i, result = PASS;
+
+    if (boot_phase(0) == NULL || boot_phase(-1) != NULL || boot_phase(BOOT_MAX_PHASES) != NULL){
+        result = FAIL;
+    }
+    for (i = 1; (phase = boot_phase(i)) != NULL; i++){
+        if (phase->name == NULL || phase->tsc < boot_phase(i-1)->tsc){
+            result = FAIL;
+        }
+    }
+    if (tsc_khz != 0 && boot_time_us() == 0){
+        result = FAIL;
+    }
+    return result;
+}
+
 /*
  *  simple_execute
  *      TEST shell....
@@ -632,6 +1533,29 @@ void launch_tests(){
     //test_syscall_open();
    //test_syscall_close();
    // test_syscall_read_write_new();
+    //TEST_OUTPUT("readv/writev test", test_syscall_readv_writev())
+    //TEST_OUTPUT("syscall trace test", test_syscall_trace())
+    //TEST_OUTPUT("user copy test", test_user_copy())
+    //TEST_OUTPUT("signal send test", test_signal_send())
+    //TEST_OUTPUT("poll test", test_syscall_poll())
+    //TEST_OUTPUT("terminal render test", test_terminal_render())
+    //TEST_OUTPUT("scrollback test", test_scrollback())
+    //TEST_OUTPUT("line discipline test", test_ldisc())
+    //TEST_OUTPUT("graphics rectangle test", test_gfx_rect())
+    //TEST_OUTPUT("ANSI escape test", test_ansi())
+    //TEST_OUTPUT("formatting test", test_format())
+    //TEST_OUTPUT("page pool test", test_page_pool())
+    //TEST_OUTPUT("IRQ mask test", test_irq_mask())
+    //TEST_OUTPUT("SMP state test", test_smp_state())
+    //TEST_OUTPUT("tasklet test", test_tasklet())
+    //TEST_OUTPUT("interrupt stats test", test_irq_stats())
+    //TEST_OUTPUT("key map test", test_keymap())
+    //TEST_OUTPUT("lazy FPU test", test_fpu())
+    //TEST_OUTPUT("clock and timer test", test_clock_timers())
+    //TEST_OUTPUT("sleep test", test_sleep())
+    //TEST_OUTPUT("crash record test", test_crash_record())
+    //TEST_OUTPUT("boot time test", test_boot_time())
+    //TEST_OUTPUT("syscall argument test", test_syscall_args())
 
 }
 
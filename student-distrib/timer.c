@@ -0,0 +1,248 @@
+//
+// timer.c - kernel timers on a hierarchical timer wheel.
+//
+// timer_jiffies is the next tick the wheel has to run. A timer is kept in
+// the slot of its expires tick on the lowest level that reaches it from
+// there. When the level 0 index wraps, the current slot of level 1 is
+// moved down, and so on up. pit_handler only queues the tasklet, which
+// runs the ticks up to pit_ticks with interrupts on.
+//
+
+#include "timer.h"
+#include "lib.h"
+#include "spinlock.h"
+#include "softirq.h"
+#include "scheduler.h"
+
+#define TVN_INDEX(jiffies, n)   (((jiffies) >> (TVR_BITS + (n)*TVN_BITS)) & TVN_MASK)
+
+static ktimer_t* tv1[TVR_SIZE];
+static ktimer_t* tvn[TIMER_LEVELS][TVN_SIZE];
+static uint32_t timer_jiffies = 0;
+static uint32_t timer_count = 0;        // pending timers.
+static spinlock_t timer_lock = SPIN_LOCK_UNLOCKED;
+
+static void run_timers(uint32_t data);
+static DECLARE_TASKLET(timer_tasklet, run_timers, 0);
+
+/*
+ *  timer_link / timer_unlink
+ *      DESCRIPTION: put the timer at the head of a slot, or take it out of its slot.
+ *                   the lock is held.
+ */
+static void timer_link(ktimer_t* t, ktimer_t** slot){
+    t->next = *slot;
+    if (t->next != NULL){
+        t->next->pprev = &t->next;
+    }
+    t->pprev = slot;
+    *slot = t;
+}
+
+static void timer_unlink(ktimer_t* t){
+    *t->pprev = t->next;
+    if (t->next != NULL){
+        t->next->pprev = t->pprev;
+    }
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+/*
+ *  internal_add_timer
+ *      DESCRIPTION: put the timer in its slot. a timer already due goes to the slot
+ *                   run next, one too far away is clamped to the top level.
+ *      INPUT:  t: the timer.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: the lock is held.
+ */
+static void internal_add_timer(ktimer_t* t){
+    uint32_t expires = t->expires;
+    uint32_t idx = expires - timer_jiffies;
+    ktimer_t** slot;
+
+    if ((int32_t)idx < 0){
+        slot = &tv1[timer_jiffies & TVR_MASK];
+    } else if (idx < TVR_SIZE){
+        slot = &tv1[expires & TVR_MASK];
+    } else if (idx < (1 << (TVR_BITS + TVN_BITS))){
+        slot = &tvn[0][TVN_INDEX(expires, 0)];
+    } else if (idx < (1 << (TVR_BITS + 2*TVN_BITS))){
+        slot = &tvn[1][TVN_INDEX(expires, 1)];
+    } else{
+        if (idx > TIMER_MAX_TICKS){
+            expires = timer_jiffies + TIMER_MAX_TICKS;
+        }
+        slot = &tvn[2][TVN_INDEX(expires, 2)];
+    }
+    timer_link(t, slot);
+}
+
+/*
+ *  cascade
+ *      DESCRIPTION: move the timers of one slot to the levels below.
+ *      INPUT:  level: index in tvn.
+ *              index: slot in the level.
+ *      OUTPUT: None.
+ *      RETURN: the index, 0 when the level above has to cascade as well.
+ *      SIDE EFFECT: the lock is held.
+ */
+static uint32_t cascade(int level, uint32_t index){
+    ktimer_t* t = tvn[level][index];
+    ktimer_t* next;
+
+    tvn[level][index] = NULL;
+    while (t != NULL){
+        next = t->next;
+        internal_add_timer(t);
+        t = next;
+    }
+    return index;
+}
+
+/*
+ *  run_timers
+ *      DESCRIPTION: run the ticks of the wheel up to pit_ticks. each timer is out of
+ *                   the wheel and the lock is dropped while its function runs, so it
+ *                   may add itself again.
+ *      INPUT:  data: unused.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: the functions of the expired timers are called.
+ */
+static void run_timers(uint32_t data){
+    uint32_t flags, index;
+    ktimer_t* head;
+    ktimer_t* t;
+
+    spin_lock_irqsave(&timer_lock, flags);
+    while ((int32_t)(pit_ticks - timer_jiffies) >= 0){
+        // nothing can be on the wheel, the slots need no cascading.
+        if (timer_count == 0){
+            timer_jiffies = pit_ticks + 1;
+            break;
+        }
+        index = timer_jiffies & TVR_MASK;
+        if (index == 0 && cascade(0, TVN_INDEX(timer_jiffies, 0)) == 0 &&
+            cascade(1, TVN_INDEX(timer_jiffies, 1)) == 0){
+            cascade(2, TVN_INDEX(timer_jiffies, 2));
+        }
+        timer_jiffies++;
+
+        // take the slot, timers added to it meanwhile wait for the next turn.
+        head = tv1[index];
+        tv1[index] = NULL;
+        if (head != NULL){
+            head->pprev = &head;
+        }
+        while (head != NULL){
+            t = head;
+            timer_unlink(t);
+            timer_count--;
+            spin_unlock_irqrestore(&timer_lock, flags);
+            t->func(t->data);
+            spin_lock_irqsave(&timer_lock, flags);
+        }
+    }
+    spin_unlock_irqrestore(&timer_lock, flags);
+}
+
+/*
+ *  init_timer
+ *      DESCRIPTION: set up a timer that is not pending.
+ *      INPUT:  t: the timer.
+ *              func: called with data when it expires.
+ *              data: argument of func.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void init_timer(ktimer_t* t, void (*func)(uint32_t data), uint32_t data){
+    t->next = NULL;
+    t->pprev = NULL;
+    t->expires = 0;
+    t->func = func;
+    t->data = data;
+}
+
+/*
+ *  add_timer
+ *      DESCRIPTION: start a timer at t->expires. a tick already past runs it on the
+ *                   next tick.
+ *      INPUT:  t: the timer, not pending.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void add_timer(ktimer_t* t){
+    uint32_t flags;
+
+    spin_lock_irqsave(&timer_lock, flags);
+    if (!timer_pending(t)){
+        // the ticks the wheel ran empty are skipped.
+        if (timer_count == 0){
+            timer_jiffies = pit_ticks + 1;
+        }
+        internal_add_timer(t);
+        timer_count++;
+    }
+    spin_unlock_irqrestore(&timer_lock, flags);
+}
+
+/*
+ *  del_timer
+ *      DESCRIPTION: stop a timer. the function may be running on the boot CPU still.
+ *      INPUT:  t: the timer.
+ *      OUTPUT: None.
+ *      RETURN: 1 if the timer was pending, 0 if not.
+ *      SIDE EFFECT: None.
+ */
+int del_timer(ktimer_t* t){
+    uint32_t flags;
+    int ret = 0;
+
+    spin_lock_irqsave(&timer_lock, flags);
+    if (timer_pending(t)){
+        timer_unlink(t);
+        timer_count--;
+        ret = 1;
+    }
+    spin_unlock_irqrestore(&timer_lock, flags);
+    return ret;
+}
+
+/*
+ *  mod_timer
+ *      DESCRIPTION: start the timer at a new tick, in one step if it was pending.
+ *      INPUT:  t: the timer.
+ *              expires: PIT tick.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void mod_timer(ktimer_t* t, uint32_t expires){
+    uint32_t flags;
+
+    spin_lock_irqsave(&timer_lock, flags);
+    if (timer_pending(t)){
+        timer_unlink(t);
+    } else{
+        // the ticks the wheel ran empty are skipped.
+        if (timer_count == 0){
+            timer_jiffies = pit_ticks + 1;
+        }
+        timer_count++;
+    }
+    t->expires = expires;
+    internal_add_timer(t);
+    spin_unlock_irqrestore(&timer_lock, flags);
+}
+
+/*
+ *  timer_tick
+ *      DESCRIPTION: let the tasklet run the wheel after the tick.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void timer_tick(){
+    if (timer_count != 0){
+        tasklet_schedule(&timer_tasklet);
+    }
+}
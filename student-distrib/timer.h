@@ -0,0 +1,53 @@
+//
+// timer.h - kernel timers on a hierarchical timer wheel.
+//
+// A timer calls its function once, in a tasklet on the boot CPU, at the
+// first PIT tick at or after its expires tick. Level 0 has one slot per
+// tick for the next 256 ticks. Each of the 3 levels above has 64 slots
+// that are 64 times wider, and a slot is moved one level down when the
+// level below wraps. Adding or removing a timer is O(1).
+//
+
+#ifndef MP3_TIMER_H
+#define MP3_TIMER_H
+
+#include "types.h"
+
+#define TVR_BITS        8
+#define TVN_BITS        6
+#define TVR_SIZE        (1 << TVR_BITS)
+#define TVN_SIZE        (1 << TVN_BITS)
+#define TVR_MASK        (TVR_SIZE - 1)
+#define TVN_MASK        (TVN_SIZE - 1)
+#define TIMER_LEVELS    3                               // levels above level 0.
+#define TIMER_MAX_TICKS ((1 << (TVR_BITS + TIMER_LEVELS*TVN_BITS)) - 1)    // about 46 hours.
+
+typedef struct ktimer{
+    struct ktimer*  next;
+    struct ktimer** pprev;              // the pointer to this timer, NULL when not pending.
+    uint32_t expires;                   // PIT tick.
+    void (*func)(uint32_t data);
+    uint32_t data;
+}ktimer_t;
+
+/* set the function of a timer that is not pending. */
+void init_timer(ktimer_t* t, void (*func)(uint32_t data), uint32_t data);
+
+/* start the timer at t->expires. it must not be pending. */
+void add_timer(ktimer_t* t);
+
+/* move a timer to expires, pending or not. */
+void mod_timer(ktimer_t* t, uint32_t expires);
+
+/* stop a timer. returns 1 if it was pending. */
+int del_timer(ktimer_t* t);
+
+/* 1 while the timer waits to run. */
+static inline int timer_pending(const ktimer_t* t){
+    return t->pprev != NULL;
+}
+
+/* called by pit_handler on the boot CPU after pit_ticks moved. */
+void timer_tick();
+
+#endif //MP3_TIMER_H
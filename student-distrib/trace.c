@@ -0,0 +1,268 @@
+//
+// trace.c - system call trace ring and latency histograms.
+//
+// syscall_handler calls trace_syscall_enter before the dispatch and
+// trace_syscall_exit after it. Each finished call goes into the ring of
+// the CPU and into the histogram of its number. Both are shown through
+// the kernel files "systrace" and "syslat".
+//
+
+#include "trace.h"
+#include "proc.h"
+#include "lib.h"
+#include "tasks.h"
+
+#define SYS_HALT    1
+
+// call that is still running for each process. execute stays here until the child halts.
+typedef struct trace_inflight{
+    uint32_t syscall_num;
+    uint64_t entry_tsc;
+    int32_t  active;
+}trace_inflight_t;
+
+static trace_cpu_t      trace_cpus[NR_CPUS];
+static trace_inflight_t trace_inflight[MAX_PROCESS];
+static volatile int     trace_enabled = 1;
+
+static const int8_t* trace_names[] = {
+    "none", "halt", "execute", "read", "write", "open", "close",
+    "getargs", "vidmap", "set_handler", "sigreturn", "readv", "writev",
+    "ioctl", "poll", "vidmap_ex", "vidflush", "gettime", "sleep"
+};
+#define TRACE_NR_NAMES  (sizeof(trace_names)/sizeof(trace_names[0]))
+
+void trace_show_ring(proc_buf_t* out);
+void trace_show_hist(proc_buf_t* out);
+int32_t trace_store(const int8_t* buf, int32_t nbytes);
+
+/*
+ *  trace_init
+ *      DESCRIPTION: register the trace files.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: "systrace" and "syslat" can be opened.
+ */
+void trace_init(){
+    proc_register("systrace", trace_show_ring, trace_store);
+    proc_register("syslat", trace_show_hist, trace_store);
+}
+
+/*
+ *  trace_record
+ *      DESCRIPTION: put one finished call into the ring and the histogram of this CPU.
+ *      INPUT:  the fields of the entry.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: the oldest entry in the ring is overwritten.
+ */
+static void trace_record(uint32_t num, int32_t pid, uint64_t entry_tsc, uint64_t exit_tsc, int32_t ret, int hist){
+    uint32_t flags;
+    uint64_t cycles;
+    int bucket;
+    trace_cpu_t* cpu = &trace_cpus[smp_processor_id()];
+    trace_entry_t* entry;
+    trace_hist_t* h;
+
+    cli_and_save(flags);
+    entry = &cpu->ring[cpu->head & (TRACE_RING_SIZE-1)];
+    entry->syscall_num = num;
+    entry->pid = pid;
+    entry->entry_tsc = entry_tsc;
+    entry->exit_tsc = exit_tsc;
+    entry->ret = ret;
+    cpu->head++;
+
+    if (hist && num < TRACE_NR_SYSCALLS){
+        cycles = exit_tsc - entry_tsc;
+        h = &cpu->hist[num];
+        h->count++;
+        h->total += cycles;
+        if (cycles > h->max){
+            h->max = cycles;
+        }
+        // bucket is the index of the highest set bit.
+        for (bucket = 0; bucket < TRACE_HIST_BUCKETS-1 && (cycles >> (bucket+1)) != 0; bucket++);
+        h->bucket[bucket]++;
+    }
+    restore_flags(flags);
+}
+
+/*
+ *  trace_syscall_enter
+ *      DESCRIPTION: remember the start time of the system call of current process.
+ *      INPUT:  syscall_num: the number in EAX.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: halt does not come back, so it is recorded right here.
+ */
+void trace_syscall_enter(uint32_t syscall_num){
+    int32_t pid = get_current_pid();
+    uint64_t now;
+
+    if (!trace_enabled || pid < 0 || pid >= MAX_PROCESS){
+        return;
+    }
+    now = rdtsc();
+    if (syscall_num == SYS_HALT){
+        trace_inflight[pid].active = 0;
+        trace_record(syscall_num, pid, now, now, 0, 0);
+        return;
+    }
+    trace_inflight[pid].syscall_num = syscall_num;
+    trace_inflight[pid].entry_tsc = now;
+    trace_inflight[pid].active = 1;
+}
+
+/*
+ *  trace_syscall_exit
+ *      DESCRIPTION: record the finished system call of current process.
+ *      INPUT:  ret: the return value of the system call.
+ *      OUTPUT: None.
+ *      RETURN: ret, so the caller keeps it in EAX.
+ *      SIDE EFFECT: None.
+ */
+int32_t trace_syscall_exit(int32_t ret){
+    int32_t pid = get_current_pid();
+
+    if (pid < 0 || pid >= MAX_PROCESS || !trace_inflight[pid].active){
+        return ret;
+    }
+    trace_inflight[pid].active = 0;
+    trace_record(trace_inflight[pid].syscall_num, pid, trace_inflight[pid].entry_tsc, rdtsc(), ret, 1);
+    return ret;
+}
+
+/*
+ *  trace_put_name
+ *      DESCRIPTION: append the name of a system call number.
+ */
+static void trace_put_name(proc_buf_t* out, uint32_t num){
+    int len;
+    if (num < TRACE_NR_NAMES){
+        proc_puts(out, trace_names[num]);
+        len = strlen(trace_names[num]);
+    } else{
+        proc_puts(out, "sys");
+        proc_putnum(out, num, 10, 0);
+        len = 5;
+    }
+    for (; len < 12; len++){
+        proc_puts(out, " ");
+    }
+}
+
+/*
+ *  trace_show_ring
+ *      DESCRIPTION: print the rings of all CPUs, oldest entry first.
+ *      INPUT:  out: the output buffer.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void trace_show_ring(proc_buf_t* out){
+    int i;
+    uint32_t idx, start;
+    trace_cpu_t* cpu;
+    trace_entry_t* entry;
+
+    proc_puts(out, "cpu pid syscall           ret      cycles\n");
+    for (i = 0; i < NR_CPUS; i++){
+        cpu = &trace_cpus[i];
+        start = (cpu->head > TRACE_RING_SIZE) ? cpu->head - TRACE_RING_SIZE : 0;
+        for (idx = start; idx != cpu->head; idx++){
+            entry = &cpu->ring[idx & (TRACE_RING_SIZE-1)];
+            proc_putnum(out, i, 10, 3);
+            proc_putnum(out, entry->pid, 10, 4);
+            proc_puts(out, " ");
+            trace_put_name(out, entry->syscall_num);
+            if (entry->ret < 0){
+                proc_puts(out, "       -");
+                proc_putnum(out, -entry->ret, 10, 0);
+            } else{
+                proc_putnum(out, entry->ret, 10, 9);
+            }
+            proc_putnum64(out, entry->exit_tsc - entry->entry_tsc, 12);
+            proc_puts(out, "\n");
+        }
+    }
+}
+
+/*
+ *  trace_show_hist
+ *      DESCRIPTION: print the latency histogram of every system call that was used,
+ *                   summed over all CPUs.
+ *      INPUT:  out: the output buffer.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void trace_show_hist(proc_buf_t* out){
+    int i, num, b;
+    trace_hist_t sum;
+    trace_hist_t* h;
+    uint64_t avg;
+
+    for (num = 0; num < TRACE_NR_SYSCALLS; num++){
+        memset(&sum, 0, sizeof(sum));
+        for (i = 0; i < NR_CPUS; i++){
+            h = &trace_cpus[i].hist[num];
+            sum.count += h->count;
+            sum.total += h->total;
+            if (h->max > sum.max){
+                sum.max = h->max;
+            }
+            for (b = 0; b < TRACE_HIST_BUCKETS; b++){
+                sum.bucket[b] += h->bucket[b];
+            }
+        }
+        if (sum.count == 0){
+            continue;
+        }
+        avg = sum.total;
+        do_div64(&avg, sum.count);
+
+        trace_put_name(out, num);
+        proc_puts(out, "calls ");
+        proc_putnum(out, sum.count, 10, 0);
+        proc_puts(out, " total ");
+        proc_putnum64(out, sum.total, 0);
+        proc_puts(out, " avg ");
+        proc_putnum64(out, avg, 0);
+        proc_puts(out, " max ");
+        proc_putnum64(out, sum.max, 0);
+        proc_puts(out, "\n");
+        for (b = 0; b < TRACE_HIST_BUCKETS; b++){
+            if (sum.bucket[b] == 0){
+                continue;
+            }
+            proc_puts(out, "    2^");
+            proc_putnum(out, b, 10, 2);
+            proc_puts(out, " ");
+            proc_putnum(out, sum.bucket[b], 10, 8);
+            proc_puts(out, "\n");
+        }
+    }
+}
+
+/*
+ *  trace_store
+ *      DESCRIPTION: control the trace by writing to the trace files.
+ *                   "on" and "off" switch the recording, "clear" drops all data.
+ *      INPUT:  buf: the written bytes.
+ *              nbytes: number of bytes.
+ *      OUTPUT: None.
+ *      RETURN: nbytes, -1 for unknown command.
+ *      SIDE EFFECT: None.
+ */
+int32_t trace_store(const int8_t* buf, int32_t nbytes){
+    uint32_t flags;
+    if (nbytes >= 2 && !strncmp(buf, "on", 2)){
+        trace_enabled = 1;
+    } else if (nbytes >= 3 && !strncmp(buf, "off", 3)){
+        trace_enabled = 0;
+    } else if (nbytes >= 5 && !strncmp(buf, "clear", 5)){
+        cli_and_save(flags);
+        memset(trace_cpus, 0, sizeof(trace_cpus));
+        memset(trace_inflight, 0, sizeof(trace_inflight));
+        restore_flags(flags);
+    } else{
+        return -1;
+    }
+    return nbytes;
+}
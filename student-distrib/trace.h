@@ -0,0 +1,46 @@
+//
+// trace.h - system call trace ring and latency histograms.
+//
+
+#ifndef MP3_TRACE_H
+#define MP3_TRACE_H
+
+#include "types.h"
+#include "smp.h"
+
+#define TRACE_RING_SIZE     64          // entries kept in each ring, power of 2.
+#define TRACE_NR_SYSCALLS   32          // syscall numbers that get a histogram.
+#define TRACE_HIST_BUCKETS  40          // bucket i counts latency in [2^i, 2^(i+1)) cycles.
+
+// one finished system call.
+typedef struct trace_entry{
+    uint32_t syscall_num;
+    int32_t  pid;
+    uint64_t entry_tsc;
+    uint64_t exit_tsc;
+    int32_t  ret;
+}trace_entry_t;
+
+// latency histogram of one system call number.
+typedef struct trace_hist{
+    uint32_t count;
+    uint64_t total;                     // sum of cycles.
+    uint64_t max;
+    uint32_t bucket[TRACE_HIST_BUCKETS];
+}trace_hist_t;
+
+// per CPU trace state. only that CPU writes it.
+typedef struct trace_cpu{
+    uint32_t      head;                 // total entries written. slot is head % size.
+    trace_entry_t ring[TRACE_RING_SIZE];
+    trace_hist_t  hist[TRACE_NR_SYSCALLS];
+}trace_cpu_t;
+
+/* register the kernel files. */
+void trace_init();
+
+/* called by syscall_handler around the system call. */
+void trace_syscall_enter(uint32_t syscall_num);
+int32_t trace_syscall_exit(int32_t ret);
+
+#endif //MP3_TRACE_H
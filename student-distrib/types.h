@@ -12,13 +12,18 @@
 #define TYPE_RTC        0
 #define TYPE_DIR        1
 #define TYPE_FILE       2
+#define TYPE_PROC       3           // kernel generated file, see proc.c
 
 
 #ifndef ASM
 
 /* Types defined here just like in <stdint.h> */
+typedef long long int64_t;
+typedef unsigned long long uint64_t;
+
 typedef int int32_t;
 typedef unsigned int uint32_t;
+#define INT32_MAX 0x7FFFFFFF
 
 typedef short int16_t;
 typedef unsigned short uint16_t;
@@ -0,0 +1,124 @@
+//
+// uaccess.c - range checks for the user buffers and the exception table lookup.
+//
+
+#include "uaccess.h"
+#include "syscall.h"
+#include "paging.h"
+#include "tasks.h"
+#include "smp.h"
+
+/*
+ *  access_ok
+ *      DESCRIPTION: check that the buffer lies in memory the current process may use.
+ *                   that is the 4MB program page, or the video pages after vidmap.
+ *                   a process with the kernel limit (the in-kernel tests) may pass anything.
+ *      INPUT:  addr: start of the buffer.
+ *              size: length in bytes.
+ *      OUTPUT: None.
+ *      RETURN: 1 for valid, 0 for not.
+ *      SIDE EFFECT: None.
+ */
+int32_t access_ok(const void* addr, uint32_t size){
+    uint32_t start = (uint32_t)addr;
+    uint32_t end = start + size;
+    pcb_t* cur_pcb = get_pcb(get_current_pid());
+
+    if (addr == NULL || end < start){
+        return 0;
+    }
+    if (cur_pcb->addr_limit == KERNEL_ADDR_LIMIT){
+        return 1;
+    }
+    if (start >= USER_ADDR && end <= cur_pcb->addr_limit){
+        return 1;
+    }
+    // the video page mapped by vidmap.
+    if (start >= VIDEO_MM && end <= VIDEO_MM + SIZE_4KB &&
+        cpu_page_directory()[VIDEO_MEMORY_INDEX].P && cpu_vidmap_table()[0].P){
+        return 1;
+    }
+    // the graphics back buffer, only mapped for its owner.
+    if (start >= VIDEO_MM + SIZE_4KB && end <= VIDEO_MM + (GFX_PAGES+1)*SIZE_4KB &&
+        cpu_page_directory()[VIDEO_MEMORY_INDEX].P && cpu_vidmap_table()[1].P){
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ *  copy_to_user
+ *      DESCRIPTION: copy n bytes from the kernel into a user buffer.
+ *      INPUT:  to: user buffer.
+ *              from: kernel buffer.
+ *              n: number of bytes.
+ *      OUTPUT: None.
+ *      RETURN: number of bytes not copied, 0 for success.
+ *      SIDE EFFECT: None.
+ */
+uint32_t copy_to_user(void* to, const void* from, uint32_t n){
+    if (n == 0){
+        return 0;
+    }
+    if (!access_ok(to, n)){
+        return n;
+    }
+    return __copy_user(to, from, n);
+}
+
+/*
+ *  copy_from_user
+ *      DESCRIPTION: copy n bytes from a user buffer into the kernel.
+ *      INPUT:  to: kernel buffer.
+ *              from: user buffer.
+ *              n: number of bytes.
+ *      OUTPUT: None.
+ *      RETURN: number of bytes not copied, 0 for success.
+ *      SIDE EFFECT: None.
+ */
+uint32_t copy_from_user(void* to, const void* from, uint32_t n){
+    if (n == 0){
+        return 0;
+    }
+    if (!access_ok(from, n)){
+        return n;
+    }
+    return __copy_user(to, from, n);
+}
+
+/*
+ *  clear_user
+ *      DESCRIPTION: fill n bytes of a user buffer with zero.
+ *      INPUT:  to: user buffer.
+ *              n: number of bytes.
+ *      OUTPUT: None.
+ *      RETURN: number of bytes not cleared, 0 for success.
+ *      SIDE EFFECT: None.
+ */
+uint32_t clear_user(void* to, uint32_t n){
+    if (n == 0){
+        return 0;
+    }
+    if (!access_ok(to, n)){
+        return n;
+    }
+    return __clear_user(to, n);
+}
+
+/*
+ *  search_exception_table
+ *      DESCRIPTION: look for the faulting instruction in the exception table.
+ *      INPUT:  eip: address of the faulting instruction.
+ *      OUTPUT: None.
+ *      RETURN: the address to resume at, 0 when the fault is not expected.
+ *      SIDE EFFECT: None.
+ */
+uint32_t search_exception_table(uint32_t eip){
+    exception_table_entry_t* entry;
+    for (entry = __ex_table_start; entry < __ex_table_end; entry++){
+        if (entry->insn == eip){
+            return entry->fixup;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+//
+// uaccess.h - copy data between the kernel and user buffers.
+//
+// The user range is checked first, then the copy runs in uaccess_sup.S. When
+// the copy still faults, page_fault finds the instruction in the exception
+// table and resumes at its fixup, so the caller just sees a short copy.
+//
+
+#ifndef MP3_UACCESS_H
+#define MP3_UACCESS_H
+
+#ifndef ASM
+
+#include "types.h"
+
+#define USER_ADDR_LIMIT     0x08400000  // end of the 4MB user page at 128MB.
+#define KERNEL_ADDR_LIMIT   0xFFFFFFFF  // any buffer, for callers inside the kernel.
+
+// one entry of the exception table: faulting instruction and where to go on.
+typedef struct exception_table_entry{
+    uint32_t insn;
+    uint32_t fixup;
+}exception_table_entry_t;
+
+/* check that [addr, addr+size) belongs to the current process. */
+int32_t access_ok(const void* addr, uint32_t size);
+
+/* return the number of bytes NOT copied, 0 for success. */
+uint32_t copy_to_user(void* to, const void* from, uint32_t n);
+uint32_t copy_from_user(void* to, const void* from, uint32_t n);
+uint32_t clear_user(void* to, uint32_t n);
+
+/* find the fixup of a faulting kernel instruction, 0 for none. */
+uint32_t search_exception_table(uint32_t eip);
+
+/* raw routines in uaccess_sup.S, no range check. */
+extern uint32_t __copy_user(void* to, const void* from, uint32_t n);
+extern uint32_t __clear_user(void* to, uint32_t n);
+extern exception_table_entry_t __ex_table_start[];
+extern exception_table_entry_t __ex_table_end[];
+
+#endif
+#endif //MP3_UACCESS_H
@@ -0,0 +1,418 @@
+//
+// vga.c - VGA mode 13h (320x200, 256 colors) for user programs.
+//
+// One process at a time owns the graphics mode. The screen is in mode 13h
+// only while the terminal of the owner is displayed, the other terminals
+// keep working in text mode and get redrawn from their text models when
+// they are shown again. The owner draws into a kernel back buffer mapped
+// right after its text page, so the frame buffer is only written by
+// vidflush, one row span of a changed rectangle at a time.
+//
+// register values referred from:
+// VGA Hardware. VGA Hardware - OSDev Wiki. (n.d.).
+// Retrieved from https://wiki.osdev.org/VGA_Hardware
+//
+
+#include "vga.h"
+#include "lib.h"
+#include "paging.h"
+#include "syscall.h"
+#include "Terminal.h"
+
+#define SUCCESS 0
+#define FAILURE -1
+
+#define CRTC_PROTECT    0x11            // bit 7 locks CRTC registers 0-7.
+#define CRTC_HBLANK_END 0x03
+#define AC_PAL_ENABLE   0x20            // give the palette back to the screen.
+#define INSTAT_RETRACE  0x08            // bit 3 of input status 1: vertical retrace.
+
+#define SEQ_MAP_MASK    0x02
+#define SEQ_MEM_MODE    0x04
+#define GC_READ_MAP     0x04
+#define GC_MODE         0x05
+#define GC_MISC         0x06
+
+// 80x25 text, the mode the bootloader left.
+static const uint8_t text_regs[VGA_NUM_REGS] = {
+    /* MISC */
+    0x67,
+    /* SEQ */
+    0x03, 0x00, 0x03, 0x00, 0x02,
+    /* CRTC */
+    0x5F, 0x4F, 0x50, 0x82, 0x55, 0x81, 0xBF, 0x1F,
+    0x00, 0x4F, 0x0D, 0x0E, 0x00, 0x00, 0x00, 0x50,
+    0x9C, 0x0E, 0x8F, 0x28, 0x1F, 0x96, 0xB9, 0xA3,
+    0xFF,
+    /* GC */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x0E, 0x00,
+    0xFF,
+    /* AC */
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x14, 0x07,
+    0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F,
+    0x0C, 0x00, 0x0F, 0x08, 0x00
+};
+
+// 320x200, 256 colors, chained.
+static const uint8_t gfx_regs[VGA_NUM_REGS] = {
+    /* MISC */
+    0x63,
+    /* SEQ */
+    0x03, 0x01, 0x0F, 0x00, 0x0E,
+    /* CRTC */
+    0x5F, 0x4F, 0x50, 0x82, 0x54, 0x80, 0xBF, 0x1F,
+    0x00, 0x41, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x9C, 0x0E, 0x8F, 0x28, 0x40, 0x96, 0xB9, 0xA3,
+    0xFF,
+    /* GC */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x05, 0x0F,
+    0xFF,
+    /* AC */
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+    0x41, 0x00, 0x0F, 0x00, 0x00
+};
+
+// the back buffer handed to the owner.
+static uint8_t gfx_back[GFX_PAGES*SIZE_4KB] __attribute__((aligned (SIZE_4KB)));
+
+// the text font lives in plane 2, which the chained writes of mode 13h overwrite.
+static uint8_t gfx_font[VGA_FONT_SIZE];
+
+static int32_t gfx_owner_pid = -1;      // process that owns the graphics mode.
+static int32_t gfx_owner_tid = -1;      // its terminal.
+static int gfx_on = 0;                  // 1 while the screen is in mode 13h.
+
+/*
+ *  write_regs
+ *      DESCRIPTION: load a whole register set into the VGA.
+ *      INPUT:  regs: MISC, then SEQ, CRTC, GC and AC values in order.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: the screen mode changes.
+ */
+static void write_regs(const uint8_t* regs){
+    int i;
+
+    outb(*regs++, VGA_MISC_WRITE);
+    for (i = 0; i < VGA_NUM_SEQ; i++){
+        outb(i, VGA_SEQ_INDEX);
+        outb(*regs++, VGA_SEQ_DATA);
+    }
+    // unlock CRTC registers 0-7 and keep them unlocked in the new values.
+    outb(CRTC_HBLANK_END, VGA_CRTC_INDEX);
+    outb(inb(VGA_CRTC_DATA) | 0x80, VGA_CRTC_DATA);
+    outb(CRTC_PROTECT, VGA_CRTC_INDEX);
+    outb(inb(VGA_CRTC_DATA) & ~0x80, VGA_CRTC_DATA);
+    for (i = 0; i < VGA_NUM_CRTC; i++){
+        outb(i, VGA_CRTC_INDEX);
+        if (i == CRTC_HBLANK_END){
+            outb(regs[i] | 0x80, VGA_CRTC_DATA);
+        } else if (i == CRTC_PROTECT){
+            outb(regs[i] & ~0x80, VGA_CRTC_DATA);
+        } else{
+            outb(regs[i], VGA_CRTC_DATA);
+        }
+    }
+    regs += VGA_NUM_CRTC;
+    for (i = 0; i < VGA_NUM_GC; i++){
+        outb(i, VGA_GC_INDEX);
+        outb(*regs++, VGA_GC_DATA);
+    }
+    // reading input status resets the AC flip-flop to the index.
+    for (i = 0; i < VGA_NUM_AC; i++){
+        (void)inb(VGA_INSTAT_READ);
+        outb(i, VGA_AC_INDEX);
+        outb(*regs++, VGA_AC_INDEX);
+    }
+    (void)inb(VGA_INSTAT_READ);
+    outb(AC_PAL_ENABLE, VGA_AC_INDEX);
+}
+
+/*
+ *  copy_font
+ *      DESCRIPTION: open plane 2 at 0xA0000 and copy the font out of it or back in.
+ *                   must run in text mode, the registers are restored after.
+ *      INPUT:  save: 1 copies the font to gfx_font, 0 writes gfx_font back.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+static void copy_font(int save){
+    uint8_t seq2, seq4, gc4, gc5, gc6;
+
+    outb(SEQ_MAP_MASK, VGA_SEQ_INDEX);
+    seq2 = inb(VGA_SEQ_DATA);
+    outb(SEQ_MEM_MODE, VGA_SEQ_INDEX);
+    seq4 = inb(VGA_SEQ_DATA);
+    outb(GC_READ_MAP, VGA_GC_INDEX);
+    gc4 = inb(VGA_GC_DATA);
+    outb(GC_MODE, VGA_GC_INDEX);
+    gc5 = inb(VGA_GC_DATA);
+    outb(GC_MISC, VGA_GC_INDEX);
+    gc6 = inb(VGA_GC_DATA);
+
+    // plane 2 only, no odd/even, 64KB window at 0xA0000.
+    outb(SEQ_MAP_MASK, VGA_SEQ_INDEX);
+    outb(0x04, VGA_SEQ_DATA);
+    outb(SEQ_MEM_MODE, VGA_SEQ_INDEX);
+    outb(seq4 | 0x04, VGA_SEQ_DATA);
+    outb(GC_READ_MAP, VGA_GC_INDEX);
+    outb(0x02, VGA_GC_DATA);
+    outb(GC_MODE, VGA_GC_INDEX);
+    outb(gc5 & ~0x10, VGA_GC_DATA);
+    outb(GC_MISC, VGA_GC_INDEX);
+    outb((gc6 & ~0x0E) | 0x04, VGA_GC_DATA);
+
+    if (save){
+        memcpy(gfx_font, (void*)GFX_ADDR, VGA_FONT_SIZE);
+    } else{
+        memcpy((void*)GFX_ADDR, gfx_font, VGA_FONT_SIZE);
+    }
+
+    outb(SEQ_MAP_MASK, VGA_SEQ_INDEX);
+    outb(seq2, VGA_SEQ_DATA);
+    outb(SEQ_MEM_MODE, VGA_SEQ_INDEX);
+    outb(seq4, VGA_SEQ_DATA);
+    outb(GC_READ_MAP, VGA_GC_INDEX);
+    outb(gc4, VGA_GC_DATA);
+    outb(GC_MODE, VGA_GC_INDEX);
+    outb(gc5, VGA_GC_DATA);
+    outb(GC_MISC, VGA_GC_INDEX);
+    outb(gc6, VGA_GC_DATA);
+}
+
+/*
+ *  wait_retrace
+ *      DESCRIPTION: wait for the start of the next vertical retrace.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+static void wait_retrace(){
+    // finish the retrace we may be in, then catch the next one from its start.
+    while (inb(VGA_INSTAT_READ) & INSTAT_RETRACE);
+    while (!(inb(VGA_INSTAT_READ) & INSTAT_RETRACE));
+}
+
+/*
+ *  gfx_enter
+ *      DESCRIPTION: put the screen in mode 13h and show the whole back buffer.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: the text memory is overwritten, the font is saved first.
+ */
+static void gfx_enter(){
+    if (gfx_on){
+        return;
+    }
+    copy_font(1);
+    write_regs(gfx_regs);
+    memcpy((void*)GFX_ADDR, gfx_back, GFX_SIZE);
+    gfx_on = 1;
+}
+
+/*
+ *  gfx_leave
+ *      DESCRIPTION: go back to text mode and redraw the terminals from their text.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+static void gfx_leave(){
+    if (!gfx_on){
+        return;
+    }
+    write_regs(text_regs);
+    copy_font(0);
+    gfx_on = 0;
+    terminal_redraw();
+}
+
+/*
+ *  gfx_init
+ *      DESCRIPTION: map the 64KB frame buffer of mode 13h for the kernel.
+ *      INPUT/OUTPUT/RETURN: None.
+ *      SIDE EFFECT: pages at 0xA0000 to 0xAFFFF are present.
+ */
+void gfx_init(){
+    int i, index;
+    for (i = 0; i < GFX_PAGES; i++){
+        index = GFX_ADDR/SIZE_4KB + i;
+        page_table[index].RW = 1;
+        page_table[index].US = 0;
+        page_table[index].PCD = 0;
+        page_table[index].Page_addr = index;
+        page_table[index].P = 1;
+    }
+    tlb_flush();
+}
+
+/*
+ *  gfx_remap
+ *      DESCRIPTION: map the back buffer after the text page of the user video memory
+ *                   for the owner, and hide it from everybody else.
+ *      INPUT:  pid: the process about to run.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: the caller flushes the TLB.
+ */
+void gfx_remap(int32_t pid){
+    int i;
+    int present = (gfx_owner_pid != -1 && pid == gfx_owner_pid);
+    for (i = 0; i < GFX_PAGES; i++){
+        cpu_vidmap_table()[i+1].RW = 1;
+        cpu_vidmap_table()[i+1].US = 1;
+        cpu_vidmap_table()[i+1].Page_addr = (uint32_t)gfx_back/SIZE_4KB + i;
+        cpu_vidmap_table()[i+1].P = present;
+    }
+}
+
+/*
+ *  gfx_acquire
+ *      DESCRIPTION: give the graphics mode to a process. the screen changes now if its
+ *                   terminal is displayed, or later when the user switches to it.
+ *      INPUT:  pid: the process.
+ *              tid: its terminal.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS, FAILURE when another process owns it.
+ *      SIDE EFFECT: the back buffer is mapped at VIDEO_MM + 4KB.
+ */
+int32_t gfx_acquire(int32_t pid, int32_t tid){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if (gfx_owner_pid != -1 && gfx_owner_pid != pid){
+        restore_flags(flags);
+        return FAILURE;
+    }
+    if (gfx_owner_pid == -1){
+        memset(gfx_back, 0, sizeof(gfx_back));
+        gfx_owner_pid = pid;
+        gfx_owner_tid = tid;
+    }
+    gfx_remap(pid);
+    if (tid == cur_terminal_id){
+        gfx_enter();
+    }
+    restore_flags(flags);
+    return SUCCESS;
+}
+
+/*
+ *  gfx_release
+ *      DESCRIPTION: take the graphics mode back from a halting process.
+ *      INPUT:  pid: the process.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: the screen goes back to text if it was in mode 13h.
+ */
+void gfx_release(int32_t pid){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if (gfx_owner_pid == -1 || gfx_owner_pid != pid){
+        restore_flags(flags);
+        return;
+    }
+    gfx_leave();
+    gfx_owner_pid = -1;
+    gfx_owner_tid = -1;
+    gfx_remap(pid);
+    tlb_flush();
+    restore_flags(flags);
+}
+
+/*
+ *  gfx_switch
+ *      DESCRIPTION: called when the displayed terminal changes. the screen is in
+ *                   mode 13h exactly while the terminal of the owner is shown.
+ *      INPUT:  tid: the terminal now displayed.
+ *      OUTPUT: None.
+ *      RETURN: None.
+ *      SIDE EFFECT: may change the screen mode.
+ */
+void gfx_switch(int32_t tid){
+    if (gfx_owner_pid == -1){
+        return;
+    }
+    if (tid == gfx_owner_tid){
+        gfx_enter();
+    } else{
+        gfx_leave();
+    }
+}
+
+/*
+ *  gfx_active
+ *      DESCRIPTION: tell whether the screen is in mode 13h.
+ *      INPUT: None.
+ *      OUTPUT: None.
+ *      RETURN: 1 for graphics, 0 for text.
+ *      SIDE EFFECT: None.
+ */
+int gfx_active(){
+    return gfx_on;
+}
+
+/*
+ *  gfx_clip
+ *      DESCRIPTION: clip a rectangle to the screen.
+ *      INPUT:  r: the rectangle, changed in place.
+ *      OUTPUT: None.
+ *      RETURN: 1 when something is left, 0 for an empty rectangle.
+ *      SIDE EFFECT: None.
+ */
+int gfx_clip(gfx_rect_t* r){
+    int32_t x0 = r->x, y0 = r->y;
+    int32_t x1 = x0 + r->w, y1 = y0 + r->h;
+
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > GFX_WIDTH) x1 = GFX_WIDTH;
+    if (y1 > GFX_HEIGHT) y1 = GFX_HEIGHT;
+    if (r->w <= 0 || r->h <= 0 || x0 >= x1 || y0 >= y1){
+        return 0;
+    }
+    r->x = x0;
+    r->y = y0;
+    r->w = x1 - x0;
+    r->h = y1 - y0;
+    return 1;
+}
+
+/*
+ *  gfx_flush
+ *      DESCRIPTION: copy the changed rectangles of the back buffer to the screen,
+ *                   starting at the next vertical retrace.
+ *      INPUT:  pid: the calling process.
+ *              rects: kernel copy of the rectangles.
+ *              n: number of rectangles, 0 for the whole screen.
+ *      OUTPUT: None.
+ *      RETURN: SUCCESS, FAILURE when pid does not own the graphics mode.
+ *      SIDE EFFECT: the frame buffer is written while the owner is displayed.
+ *                   otherwise the back buffer is shown when it comes back.
+ */
+int32_t gfx_flush(int32_t pid, const gfx_rect_t* rects, int32_t n){
+    int32_t i, y;
+    gfx_rect_t r;
+
+    if (gfx_owner_pid == -1 || pid != gfx_owner_pid || n < 0 || n > GFX_MAX_RECTS){
+        return FAILURE;
+    }
+    if (!gfx_on){
+        return SUCCESS;
+    }
+    wait_retrace();
+    if (n == 0){
+        memcpy((void*)GFX_ADDR, gfx_back, GFX_SIZE);
+        return SUCCESS;
+    }
+    for (i = 0; i < n; i++){
+        r = rects[i];
+        if (!gfx_clip(&r)){
+            continue;
+        }
+        for (y = r.y; y < r.y + r.h; y++){
+            memcpy((uint8_t*)GFX_ADDR + y*GFX_WIDTH + r.x, gfx_back + y*GFX_WIDTH + r.x, r.w);
+        }
+    }
+    return SUCCESS;
+}
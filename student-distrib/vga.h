@@ -0,0 +1,77 @@
+//
+// vga.h - VGA mode 13h (320x200, 256 colors) for user programs.
+//
+// A program asks for graphics through vidmap_ex. It draws into a back
+// buffer mapped in its video memory area and calls vidflush with the
+// rectangles it changed. Only those spans are copied to the screen, after
+// the vertical retrace starts, so a frame never shows half drawn.
+//
+
+#ifndef MP3_VGA_H
+#define MP3_VGA_H
+
+#include "types.h"
+
+#define GFX_WIDTH       320
+#define GFX_HEIGHT      200
+#define GFX_SIZE        (GFX_WIDTH * GFX_HEIGHT)
+#define GFX_PAGES       16                      // 4KB pages of the back buffer.
+#define GFX_ADDR        0xA0000                 // frame buffer of mode 13h.
+#define GFX_MAX_RECTS   32                      // rectangles taken by one vidflush.
+
+#define VIDMAP_TEXT     0                       // the text page of the terminal.
+#define VIDMAP_GFX      1                       // the 320x200 back buffer.
+
+// VGA registers.
+#define VGA_AC_INDEX    0x3C0
+#define VGA_AC_READ     0x3C1
+#define VGA_MISC_WRITE  0x3C2
+#define VGA_SEQ_INDEX   0x3C4
+#define VGA_SEQ_DATA    0x3C5
+#define VGA_GC_INDEX    0x3CE
+#define VGA_GC_DATA     0x3CF
+#define VGA_CRTC_INDEX  0x3D4
+#define VGA_CRTC_DATA   0x3D5
+#define VGA_INSTAT_READ 0x3DA
+
+#define VGA_NUM_SEQ     5
+#define VGA_NUM_CRTC    25
+#define VGA_NUM_GC      9
+#define VGA_NUM_AC      21
+#define VGA_NUM_REGS    (1 + VGA_NUM_SEQ + VGA_NUM_CRTC + VGA_NUM_GC + VGA_NUM_AC)
+
+#define VGA_FONT_SIZE   8192                    // 256 chars, 32 bytes each, in plane 2.
+
+// a rectangle of the back buffer that changed.
+typedef struct gfx_rect{
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+}gfx_rect_t;
+
+/* map the pages of the frame buffer for the kernel. */
+void gfx_init();
+
+/* show the back buffer only to its owner. */
+void gfx_remap(int32_t pid);
+
+/* give the graphics mode to the current process. 0, or -1 when another process owns it. */
+int32_t gfx_acquire(int32_t pid, int32_t tid);
+
+/* drop the graphics mode when its owner halts. */
+void gfx_release(int32_t pid);
+
+/* the displayed terminal changed, enter or leave the graphics mode. */
+void gfx_switch(int32_t tid);
+
+/* 1 while the screen is in mode 13h. */
+int gfx_active();
+
+/* clip a rectangle to the screen, 0 when nothing is left. */
+int gfx_clip(gfx_rect_t* r);
+
+/* copy the changed rectangles of the back buffer to the screen. */
+int32_t gfx_flush(int32_t pid, const gfx_rect_t* rects, int32_t n);
+
+#endif //MP3_VGA_H
@@ -0,0 +1,106 @@
+//
+// waitq.c - wait queues for processes that sleep on a device.
+//
+
+#include "waitq.h"
+#include "syscall.h"
+#include "tasks.h"
+
+/*
+ *  wait_queue_add
+ *      DESCRIPTION: put the current process on the wait queue.
+ *      INPUT:  wq: the wait queue.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void wait_queue_add(wait_queue_t* wq){
+    uint32_t flags;
+    int32_t pid = get_current_pid();
+    if (pid < 0 || pid >= MAX_PROCESS){
+        return;
+    }
+    cli_and_save(flags);
+    wq->pids |= (1 << pid);
+    restore_flags(flags);
+}
+
+/*
+ *  wait_queue_remove
+ *      DESCRIPTION: take the current process off the wait queue.
+ *      INPUT:  wq: the wait queue.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void wait_queue_remove(wait_queue_t* wq){
+    uint32_t flags;
+    int32_t pid = get_current_pid();
+    if (pid < 0 || pid >= MAX_PROCESS){
+        return;
+    }
+    cli_and_save(flags);
+    wq->pids &= ~(1 << pid);
+    restore_flags(flags);
+}
+
+/*
+ *  wake_up_pid
+ *      DESCRIPTION: mark a sleeping process running, so the scheduler picks it again.
+ *      INPUT:  pid: the process.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void wake_up_pid(int32_t pid){
+    if (pid < 0 || pid >= MAX_PROCESS){
+        return;
+    }
+    get_pcb(pid)->state = TASK_RUNNING;
+}
+
+/*
+ *  process_timeout
+ *      DESCRIPTION: the function of the wake timer in the pcb, the sleep timed out.
+ *      INPUT:  data: the pid.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void process_timeout(uint32_t data){
+    wake_up_pid((int32_t)data);
+}
+
+/*
+ *  wake_up
+ *      DESCRIPTION: wake every process on the wait queue. they stay on the queue
+ *                   until they find their condition true.
+ *      INPUT:  wq: the wait queue.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: None.
+ */
+void wake_up(wait_queue_t* wq){
+    uint32_t flags;
+    uint32_t pids;
+    int32_t pid;
+
+    cli_and_save(flags);
+    pids = wq->pids;
+    for (pid = 0; pids != 0; pid++, pids >>= 1){
+        if (pids & 1){
+            wake_up_pid(pid);
+        }
+    }
+    restore_flags(flags);
+}
+
+/*
+ *  set_current_state
+ *      DESCRIPTION: set the state of the current process.
+ *      INPUT:  state: TASK_RUNNING or TASK_SLEEPING.
+ *      OUTPUT/RETURN: None.
+ *      SIDE EFFECT: a sleeping process is skipped by the scheduler.
+ */
+void set_current_state(uint32_t state){
+    int32_t pid = get_current_pid();
+    if (pid < 0 || pid >= MAX_PROCESS){
+        return;
+    }
+    get_pcb(pid)->state = state;
+}
@@ -0,0 +1,62 @@
+//
+// waitq.h - wait queues for processes that sleep on a device.
+//
+// A wait queue is a bit map of the pids sleeping on it. A sleeping process
+// is skipped by the scheduler until a wake_up (or its timer, see
+// process_timeout) marks it running again.
+//
+
+#ifndef MP3_WAITQ_H
+#define MP3_WAITQ_H
+
+#include "types.h"
+#include "lib.h"
+
+#define TASK_RUNNING    0
+#define TASK_SLEEPING   1
+
+typedef struct wait_queue{
+    volatile uint32_t pids;             // bit i set when pid i is waiting.
+}wait_queue_t;
+
+/* add or remove the current process. */
+void wait_queue_add(wait_queue_t* wq);
+void wait_queue_remove(wait_queue_t* wq);
+
+/* mark every process on the queue running. safe in interrupt handlers. */
+void wake_up(wait_queue_t* wq);
+
+/* wake one process by pid. */
+void wake_up_pid(int32_t pid);
+
+/* timer function that wakes the pid in its data. */
+void process_timeout(uint32_t data);
+
+/* state of the current process. */
+void set_current_state(uint32_t state);
+
+/* give the CPU away, defined in scheduler.c. returns with interrupts on. */
+void schedule();
+
+/*
+ * sleep on the queue until the condition holds. the condition is checked
+ * with interrupts off, after the process is marked sleeping, so a wake up
+ * can not be missed.
+ */
+#define wait_event(wq, condition)               \
+do {                                            \
+    wait_queue_add(wq);                         \
+    while (1) {                                 \
+        cli();                                  \
+        set_current_state(TASK_SLEEPING);       \
+        if (condition) {                        \
+            break;                              \
+        }                                       \
+        schedule();                             \
+    }                                           \
+    set_current_state(TASK_RUNNING);            \
+    wait_queue_remove(wq);                      \
+    sti();                                      \
+} while (0)
+
+#endif //MP3_WAITQ_H
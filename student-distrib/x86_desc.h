@@ -15,6 +15,10 @@
 #define USER_DS     0x002B
 #define KERNEL_TSS  0x0030
 #define KERNEL_LDT  0x0038
+#define AP_TSS      0x0040      /* TSS of the first AP, one entry for each AP after it */
+
+/* Processors the kernel runs on, the boot CPU and the APs */
+#define NR_CPUS     4
 
 /* Size of the task state segment (TSS) */
 #define TSS_SIZE    104
@@ -123,6 +127,7 @@ extern uint32_t ldt;
 extern uint32_t tss_size;
 extern seg_desc_t tss_desc_ptr;
 extern tss_t tss;
+extern seg_desc_t ap_tss_desc_ptr[NR_CPUS-1];
 
 /* Sets runtime-settable parameters in the GDT entry for the LDT */
 #define SET_LDT_PARAMS(str, addr, lim)                          \
@@ -42,10 +42,14 @@ do_one_file (const char* s, const char* fname)
 	    for (check = line_start; check < line_end; check++) {
 		if (s[0] == data[check] && 
 		    0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
-		    ece391_fdputs (1, (uint8_t*)fname);
-		    ece391_fdputs (1, (uint8_t*)":");
-		    ece391_fdputs (1, data + line_start);
-		    ece391_fdputs (1, (uint8_t*)"\n");
+		    ece391_iovec_t match[4] = {
+			{ (void*)fname, ece391_strlen ((uint8_t*)fname) },
+			{ ":", 1 },
+			{ data + line_start, line_end - line_start },
+			{ "\n", 1 }
+		    };
+		    /* one trap for the whole match line */
+		    (void)ece391_writev (1, match, 4);
 		    break;
 		}
 	    }
@@ -5,6 +5,53 @@
 
 /* All calls return >= 0 on success or -1 on failure. */
 
+/* One segment for readv/writev; at most 16 segments per call. */
+typedef struct ece391_iovec {
+    void* iov_base;
+    int32_t iov_len;
+} ece391_iovec_t;
+
+/* One entry for poll. timeout is in ms, -1 waits forever. */
+typedef struct ece391_pollfd {
+    int32_t fd;
+    int16_t events;
+    int16_t revents;
+} ece391_pollfd_t;
+
+#define POLLIN      0x1
+#define POLLOUT     0x4
+#define POLLERR     0x8
+#define POLLNVAL    0x20
+
+/* ioctl command: arg != 0 makes read return -1 instead of waiting. */
+#define FIONBIO     0x5421
+
+/* ioctl commands of the terminal. raw mode gives every key at once, without echo. */
+#define TCGETMODE   0x5401
+#define TCSETMODE   0x5402
+#define TTY_COOKED  0
+#define TTY_RAW     1
+
+/* vidmap_ex screens. VIDMAP_GFX maps a 320x200 back buffer, one byte per pixel. */
+#define VIDMAP_TEXT 0
+#define VIDMAP_GFX  1
+#define GFX_WIDTH   320
+#define GFX_HEIGHT  200
+
+/* A changed part of the back buffer for vidflush; at most 32 per call. */
+typedef struct ece391_rect {
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+} ece391_rect_t;
+
+/* Monotonic time since boot, for gettime. */
+typedef struct ece391_timespec {
+    uint32_t tv_sec;
+    uint32_t tv_nsec;
+} ece391_timespec_t;
+
 /*  
  * Note that the system call for halt will have to make sure that only
  * the low byte of EBX (the status argument) is returned to the calling
@@ -21,6 +68,14 @@ extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
+extern int32_t ece391_readv (int32_t fd, const ece391_iovec_t* iov, int32_t iovcnt);
+extern int32_t ece391_writev (int32_t fd, const ece391_iovec_t* iov, int32_t iovcnt);
+extern int32_t ece391_ioctl (int32_t fd, int32_t cmd, int32_t arg);
+extern int32_t ece391_poll (ece391_pollfd_t* fds, int32_t nfds, int32_t timeout);
+extern int32_t ece391_vidmap_ex (uint8_t** screen_start, int32_t mode);
+extern int32_t ece391_vidflush (const ece391_rect_t* rects, int32_t n);
+extern int32_t ece391_gettime (ece391_timespec_t* ts);
+extern int32_t ece391_sleep (int32_t ms);
 
 enum signums {
 	DIV_ZERO = 0,
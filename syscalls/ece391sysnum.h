@@ -11,5 +11,13 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_READV   11
+#define SYS_WRITEV  12
+#define SYS_IOCTL   13
+#define SYS_POLL    14
+#define SYS_VIDMAP_EX 15
+#define SYS_VIDFLUSH  16
+#define SYS_GETTIME   17
+#define SYS_SLEEP     18
 
 #endif /* ECE391SYSNUM_H */